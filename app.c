@@ -22,8 +22,12 @@
 /* 
  * micro ROS includes 
  */
+#include "app_ram.h"
 #include "uros_task.h"
 #include "gui_task.h"
+#include "boot_profile.h"
+#include "http_calls.h"
+#include "supervisor.h"
 
 #define TAG "lv_app"
 
@@ -31,55 +35,142 @@
  * IPC definitions
  **********************/
 #include "app.h"
-QueueHandle_t xDataQueue; // transmits data from uros task to gui to display (IPC)
 TaskHandle_t guiTaskHandle;
 
+/* latest-state table the uros task writes and the gui reads. */
+static portMUX_TYPE servoStateLock = portMUX_INITIALIZER_UNLOCKED;
+static ServoDisplayState servoStates[kServoChannelCount];
+static uint32_t servoDirtyMask;
+static int lastServoNum = -1;
+static GuiIpcStats ipcStats;
+static volatile bool linkUp;
+static StaticTask_t guiTaskBuffer;
+static StackType_t guiStack[kGuiStackSize];
+
+void gui_ipc_post_servo_angle(int servo_num, int32_t angle)
+{
+    if (servo_num < 0 || servo_num >= kServoChannelCount) {
+        portENTER_CRITICAL(&servoStateLock);
+        ipcStats.dropped++;
+        portEXIT_CRITICAL(&servoStateLock);
+        return;
+    }
+
+    uint32_t bit = 1u << servo_num;
+
+    portENTER_CRITICAL(&servoStateLock);
+    if (servoDirtyMask & bit) {
+        ipcStats.coalesced++;
+    }
+    servoStates[servo_num].angle = angle;
+    servoStates[servo_num].updates++;
+    servoDirtyMask |= bit;
+    lastServoNum = servo_num;
+    ipcStats.posted++;
+    portEXIT_CRITICAL(&servoStateLock);
+
+    /* a notification never blocks - repeated gives just accumulate */
+    if (guiTaskHandle != NULL) {
+        xTaskNotifyGive(guiTaskHandle);
+    }
+}
+
+uint32_t gui_ipc_take_dirty(ServoDisplayState *states, int *last_servo_num)
+{
+    portENTER_CRITICAL(&servoStateLock);
+    uint32_t mask = servoDirtyMask;
+    for (int i = 0; i < kServoChannelCount; i++) {
+        if (mask & (1u << i)) {
+            states[i] = servoStates[i];
+        }
+    }
+    servoDirtyMask = 0;
+    if (last_servo_num != NULL) {
+        *last_servo_num = lastServoNum;
+    }
+    portEXIT_CRITICAL(&servoStateLock);
+
+    return mask;
+}
+
+void gui_ipc_get_stats(GuiIpcStats *stats)
+{
+    portENTER_CRITICAL(&servoStateLock);
+    *stats = ipcStats;
+    portEXIT_CRITICAL(&servoStateLock);
+}
+
+void gui_ipc_post_link_state(bool up)
+{
+    if (linkUp == up) {
+        return;
+    }
+    linkUp = up;
+    if (guiTaskHandle != NULL) {
+        xTaskNotifyGive(guiTaskHandle);
+    }
+}
+
+bool gui_ipc_link_up(void)
+{
+    return linkUp;
+}
+
+/*
+ * nvs and netif bring up, on its own task so it overlaps the display and PCA9685 set up.
+ */
+static void boot_net_task(void *arg)
+{
+    (void) arg;
+
+    http_calls_init();
+    boot_mark(BOOT_PHASE_NETWORK_READY);
+    vTaskDelete(NULL);
+}
+
 /**********************
  *   APPLICATION MAIN
  **********************/
 // void app_main() {
 void appMain(){ 
 
-    /* 
-     * creating message buffer for inter task comms
-     */ 
-    xDataQueue = xQueueCreate( kQueueMaxCount, kQueueDataSize );
-    
-    if( xDataQueue == NULL )
-    {
-        ESP_LOGI(TAG, "Couldn't allocate queue. aborting");    
-        vTaskDelete(NULL);
-    }
+    boot_profile_init();
+    boot_mark(BOOT_PHASE_APP_START);
+    supervisor_start();
 
+    BaseType_t taskCreateResult;
+    taskCreateResult = xTaskCreate(boot_net_task, "boot_net", BOOT_NET_STACK_SIZE, NULL, BOOT_NET_PRIORITY, NULL);
+    if (pdPASS != taskCreateResult) {
+        /* run it inline, slower but the same result */
+        ESP_LOGW(TAG, "network init task create failed");
+        http_calls_init();
+        boot_mark(BOOT_PHASE_NETWORK_READY);
+    }
 
     ESP_LOGI(TAG, "starting GUI Task.");
-    BaseType_t taskCreateResult;
     /* If you want to use a task to create the graphic, you NEED to create a Pinned task
      * Otherwise there can be problem such as memory corruption and so on.
      * NOTE: When not using Wi-Fi nor Bluetooth you can pin the guiTask to core 0 
-    xTaskCreatePinnedToCore( TaskFunction_t pvTaskCode,
+    xTaskCreateStaticPinnedToCore( TaskFunction_t pvTaskCode,
                                         const char * const pcName,
-                                        const uint32_t usStackDepth,
+                                        const uint32_t ulStackDepth,
                                         void * const pvParameters,
                                         UBaseType_t uxPriority,
-                                        TaskHandle_t * const pvCreatedTask,
+                                        StackType_t * const pxStackBuffer,
+                                        StaticTask_t * const pxTaskBuffer,
                                         const BaseType_t xCoreID);
     */ 
 
-    taskCreateResult = xTaskCreatePinnedToCore(
+    guiTaskHandle = xTaskCreateStaticPinnedToCore(
             guiTask, 
             "gui", 
             kGuiStackSize, 
-            (void *)&xDataQueue, 
-            0, &guiTaskHandle, 1);
-
-    if (pdPASS != taskCreateResult) {
-        ESP_LOGI(TAG, "GUI Task create failed");
-        vTaskDelete(NULL);
-    }
+            NULL, 
+            0, guiStack, &guiTaskBuffer, 1);
+    app_ram_reserve(APP_RAM_GUI, sizeof(guiTaskBuffer) + sizeof(guiStack));
 
     ESP_LOGI(TAG, "starting ROS Task.");
-    uros_start(xDataQueue);
+    uros_start();
 }
 
 
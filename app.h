@@ -1,17 +1,60 @@
 #pragma once
-/* 
+/*
  * this is the app coordination header.
- * all tasks should include this header and use to communicate 
- */ 
+ * all tasks should include this header and use to communicate
+ */
+#include <stdbool.h>
 #include <unistd.h>
 #include <std_msgs/msg/int32.h>
-#include "freertos/queue.h"
-
-#define MESSAGE_SIZE 20
-typedef struct BufferDataType {
-	char msg[MESSAGE_SIZE];
-	int32_t data;
-} BufferDataType;
-#define kQueueDataSize (sizeof(BufferDataType))
-#define kQueueMaxCount 5
-#define xBlockTime pdMS_TO_TICKS(20)
\ No newline at end of file
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/*
+ * servo state shared from the uros task to the gui (IPC).
+ * producers overwrite the latest value per channel and notify the gui task,
+ * so posting never blocks - if the gui is slow, intermediate values are coalesced.
+ */
+#define kServoChannelCount 16
+
+typedef struct ServoDisplayState {
+	int32_t angle;
+	uint32_t updates; // number of times this channel has been posted
+} ServoDisplayState;
+
+typedef struct GuiIpcStats {
+	uint32_t posted;    // updates accepted into the state table
+	uint32_t coalesced; // updates that overwrote a value the gui had not yet shown
+	uint32_t dropped;   // updates rejected (channel out of range)
+} GuiIpcStats;
+
+extern TaskHandle_t guiTaskHandle;
+
+/*
+ * @brief publish the latest angle for a servo channel to the gui. never blocks.
+ * @param servo_num - the servo channel
+ * @param angle - the angle requested
+ */
+void gui_ipc_post_servo_angle(int servo_num, int32_t angle);
+
+/*
+ * @brief take a snapshot of the channels changed since the last call and clear them.
+ * @param states - kServoChannelCount entries, only dirty channels are written
+ * @param last_servo_num - (optional) the most recently posted channel, -1 if none yet
+ * @return bitmask of the channels that changed
+ */
+uint32_t gui_ipc_take_dirty(ServoDisplayState *states, int *last_servo_num);
+
+/*
+ * @brief copy out the ipc counters
+ */
+void gui_ipc_get_stats(GuiIpcStats *stats);
+
+/*
+ * @brief publish whether the micro ros agent link is up. the gui is only woken on a change.
+ */
+void gui_ipc_post_link_state(bool up);
+
+/*
+ * @brief the last link state posted
+ */
+bool gui_ipc_link_up(void);
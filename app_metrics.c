@@ -0,0 +1,87 @@
+/*
+ * app metrics - counters and log2 latency histograms.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include "freertos/FreeRTOS.h"
+
+#include "app_metrics.h"
+
+static const char *counterNames[METRIC_COUNTER_COUNT] = {
+    [METRIC_SERVO_CMD_ROS] = "servo_commands_ros",
+    [METRIC_SERVO_CMD_HTTP] = "servo_commands_http",
+    [METRIC_SERVO_CMD_REJECTED] = "servo_commands_rejected",
+    [METRIC_SERVO_CMD_FAILED] = "servo_commands_failed",
+    [METRIC_HTTP_SERVER_REQUESTS] = "http_server_requests",
+    [METRIC_HTTP_SERVER_BAD] = "http_server_errors",
+    [METRIC_BENCH_ACKS] = "bench_acks",
+    [METRIC_BENCH_ACK_ERRORS] = "bench_ack_errors",
+    [METRIC_SERVO_CMD_REPLAY] = "servo_commands_replay",
+    [METRIC_SERVO_CMD_SEQUENCE] = "servo_commands_sequence",
+};
+
+static const char *histogramNames[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_ACTUATE_ROS_US] = "actuate_ros_us",
+    [METRIC_HIST_ACTUATE_HTTP_US] = "actuate_http_us",
+    [METRIC_HIST_HTTP_SERVOS_US] = "http_servos_request_us",
+    [METRIC_HIST_ROS_COMMAND_US] = "ros_command_us",
+};
+
+/***************************
+ * globals
+ ***************************/
+static portMUX_TYPE metricsLock = portMUX_INITIALIZER_UNLOCKED;
+static AppMetrics metrics;
+
+void metrics_count(MetricCounter counter, uint32_t n)
+{
+    portENTER_CRITICAL(&metricsLock);
+    metrics.counters[counter] += n;
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+void metrics_record_us(MetricHistogram histogram, uint32_t us)
+{
+    int bucket = us ? 32 - __builtin_clz(us) : 0;
+
+    if (bucket >= METRICS_HIST_BUCKETS) {
+        bucket = METRICS_HIST_BUCKETS - 1;
+    }
+
+    portENTER_CRITICAL(&metricsLock);
+    MetricsHistogram *h = &metrics.histograms[histogram];
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+void metrics_snapshot(AppMetrics *out)
+{
+    portENTER_CRITICAL(&metricsLock);
+    *out = metrics;
+    portEXIT_CRITICAL(&metricsLock);
+}
+
+uint32_t metrics_bucket_limit_us(int bucket)
+{
+    if (bucket >= METRICS_HIST_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return (1U << bucket) - 1;
+}
+
+const char *metrics_counter_name(MetricCounter counter)
+{
+    return counterNames[counter];
+}
+
+const char *metrics_histogram_name(MetricHistogram histogram)
+{
+    return histogramNames[histogram];
+}
@@ -0,0 +1,83 @@
+/*
+ * app metrics - named counters and latency histograms shared by every task.
+ *
+ * histograms use log2 microsecond buckets so recording is a count-leading-zeros
+ * and an increment under a spinlock - cheap enough for the actuation path.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum MetricCounter {
+    METRIC_SERVO_CMD_ROS,          // servo commands from the ros subscriptions
+    METRIC_SERVO_CMD_HTTP,         // servo commands from the http control endpoint
+    METRIC_SERVO_CMD_REJECTED,     // commands refused (channel or angle out of range)
+    METRIC_SERVO_CMD_FAILED,       // commands whose PCA9685 write failed after retries
+    METRIC_HTTP_SERVER_REQUESTS,   // requests handled by the http control server
+    METRIC_HTTP_SERVER_BAD,        // requests answered with an error
+    METRIC_BENCH_ACKS,             // bench tagged commands acknowledged
+    METRIC_BENCH_ACK_ERRORS,       // acknowledgements that failed to publish
+    METRIC_SERVO_CMD_REPLAY,       // servo commands played back by the command recorder
+    METRIC_SERVO_CMD_SEQUENCE,     // servo commands from the keyframe sequence player
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum MetricHistogram {
+    METRIC_HIST_ACTUATE_ROS_US,    // ros command to I2C write complete
+    METRIC_HIST_ACTUATE_HTTP_US,   // http command to I2C write complete
+    METRIC_HIST_HTTP_SERVOS_US,    // whole /servos request, body read to response sent
+    METRIC_HIST_ROS_COMMAND_US,    // ros callback entry to I2C write complete, logging included
+    METRIC_HIST_COUNT
+} MetricHistogram;
+
+/*
+ * bucket 0 holds 0us, bucket n holds [2^(n-1), 2^n - 1]us.
+ * the last bucket also takes everything slower, about 0.26s and up.
+ */
+#define METRICS_HIST_BUCKETS 20
+
+typedef struct MetricsHistogram {
+    uint32_t buckets[METRICS_HIST_BUCKETS];
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+} MetricsHistogram;
+
+typedef struct AppMetrics {
+    uint32_t counters[METRIC_COUNTER_COUNT];
+    MetricsHistogram histograms[METRIC_HIST_COUNT];
+} AppMetrics;
+
+/**
+ * @brief add n to a counter. safe from any task.
+ */
+void metrics_count(MetricCounter counter, uint32_t n);
+
+/**
+ * @brief record one latency sample. safe from any task.
+ */
+void metrics_record_us(MetricHistogram histogram, uint32_t us);
+
+/**
+ * @brief copy out every counter and histogram at once.
+ */
+void metrics_snapshot(AppMetrics *out);
+
+/**
+ * @brief the largest value (inclusive) that lands in the bucket. the last bucket is unbounded.
+ */
+uint32_t metrics_bucket_limit_us(int bucket);
+
+/**
+ * @brief short snake_case names, used as metric names by the http metrics endpoint.
+ */
+const char *metrics_counter_name(MetricCounter counter);
+const char *metrics_histogram_name(MetricHistogram histogram);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+/*
+ * static storage per subsystem, for the start up report.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "app_ram.h"
+
+#define TAG "ram"
+
+static const char *ownerNames[APP_RAM_OWNER_COUNT] = {
+    [APP_RAM_GUI] = "gui",
+    [APP_RAM_ROS] = "ros",
+    [APP_RAM_SERVO] = "servo",
+    [APP_RAM_HTTP] = "http",
+    [APP_RAM_RECORDER] = "recorder",
+    [APP_RAM_SEQUENCE] = "sequence",
+    [APP_RAM_TELEMETRY] = "telemetry",
+    [APP_RAM_TRACE] = "trace",
+    [APP_RAM_SUPERVISOR] = "supervisor",
+    [APP_RAM_BOOT] = "boot",
+};
+
+/***************************
+ * globals
+ ***************************/
+static portMUX_TYPE ramLock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t reserved[APP_RAM_OWNER_COUNT];
+
+void app_ram_reserve(AppRamOwner owner, size_t bytes)
+{
+    if (owner >= APP_RAM_OWNER_COUNT) {
+        return;
+    }
+    portENTER_CRITICAL(&ramLock);
+    reserved[owner] += bytes;
+    portEXIT_CRITICAL(&ramLock);
+}
+
+uint32_t app_ram_reserved(AppRamOwner owner)
+{
+    uint32_t bytes;
+
+    if (owner >= APP_RAM_OWNER_COUNT) {
+        return 0;
+    }
+    portENTER_CRITICAL(&ramLock);
+    bytes = reserved[owner];
+    portEXIT_CRITICAL(&ramLock);
+    return bytes;
+}
+
+const char *app_ram_owner_name(AppRamOwner owner)
+{
+    return owner < APP_RAM_OWNER_COUNT ? ownerNames[owner] : "?";
+}
+
+void app_ram_report(void)
+{
+    uint32_t total = 0;
+
+    ESP_LOGI(TAG, "static storage by subsystem:");
+    for (int o = 0; o < APP_RAM_OWNER_COUNT; o++) {
+        uint32_t bytes = app_ram_reserved(o);
+
+        if (bytes != 0) {
+            ESP_LOGI(TAG, "  %-12s %7u", ownerNames[o], bytes);
+            total += bytes;
+        }
+    }
+    ESP_LOGI(TAG, "  %-12s %7u", "total", total);
+    /* a largest block well below the free total means the heap is fragmenting */
+    ESP_LOGI(TAG, "heap: %u free, %u lowest free, %u largest free block",
+             esp_get_free_heap_size(), esp_get_minimum_free_heap_size(),
+             heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
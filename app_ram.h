@@ -0,0 +1,55 @@
+/*
+ * app ram - what each subsystem reserved at start up.
+ *
+ * long lived tasks, queues, locks and buffers are statically allocated with sizes
+ * fixed at build time, so the memory map is the same on every boot and the heap only
+ * serves the libraries (lwip, wi-fi, esp_http_client, esp_http_server). each
+ * subsystem records its static storage here as it starts; app_ram_report logs it
+ * beside the heap figures, and /metrics serves both.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum AppRamOwner {
+    APP_RAM_GUI,         // gui task, lvgl draw buffers, display frame and glyph buffers
+    APP_RAM_ROS,         // micro-ROS support, executor and the rcl allocator arena
+    APP_RAM_SERVO,       // servo command lock and position tables
+    APP_RAM_HTTP,        // http control page and upload buffers, http worker task and queue
+    APP_RAM_RECORDER,    // command recorder task and flash write buffers
+    APP_RAM_SEQUENCE,    // sequence player task and sequence buffers
+    APP_RAM_TELEMETRY,   // telemetry task, sample ring and batch buffer
+    APP_RAM_TRACE,       // trace ring
+    APP_RAM_SUPERVISOR,  // supervisor task and task tables
+    APP_RAM_BOOT,        // boot profile event group
+    APP_RAM_OWNER_COUNT
+} AppRamOwner;
+
+/**
+ * @brief record static storage a subsystem owns. call once per object, when it starts.
+ */
+void app_ram_reserve(AppRamOwner owner, size_t bytes);
+
+/**
+ * @brief bytes a subsystem has recorded.
+ */
+uint32_t app_ram_reserved(AppRamOwner owner);
+
+/**
+ * @brief subsystem name for logs and metrics.
+ */
+const char *app_ram_owner_name(AppRamOwner owner);
+
+/**
+ * @brief log the static storage per subsystem and the heap: free, lowest free and largest free block.
+ */
+void app_ram_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+/*
+ * boot phase timestamps and the event group tasks wait on each other with.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "app_ram.h"
+#include "boot_profile.h"
+
+#define TAG "boot"
+
+static const char *phaseNames[BOOT_PHASE_COUNT] = {
+    [BOOT_PHASE_APP_START] = "app_start",
+    [BOOT_PHASE_I2C_READY] = "i2c_ready",
+    [BOOT_PHASE_DISPLAY_READY] = "display_ready",
+    [BOOT_PHASE_NETWORK_READY] = "network_ready",
+    [BOOT_PHASE_SERVO_READY] = "servo_ready",
+    [BOOT_PHASE_SERVERS_READY] = "servers_ready",
+    [BOOT_PHASE_AGENT_CONNECTED] = "agent_connected",
+    [BOOT_PHASE_ROS_READY] = "ros_ready",
+    [BOOT_PHASE_FIRST_COMMAND] = "first_command",
+};
+
+/***************************
+ * globals
+ ***************************/
+static EventGroupHandle_t phaseEvents;
+static StaticEventGroup_t phaseEventsBuffer;
+static portMUX_TYPE phaseLock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t phaseMs[BOOT_PHASE_COUNT];
+static volatile uint32_t markedMask;
+
+void boot_profile_init(void)
+{
+    if (phaseEvents == NULL) {
+        phaseEvents = xEventGroupCreateStatic(&phaseEventsBuffer);
+        app_ram_reserve(APP_RAM_BOOT, sizeof(phaseEventsBuffer));
+    }
+}
+
+void boot_mark(BootPhase phase)
+{
+    uint32_t bit = 1U << phase;
+
+    /* the first command is marked from the actuation path, keep the repeat cheap */
+    if (phase >= BOOT_PHASE_COUNT || (markedMask & bit)) {
+        return;
+    }
+
+    uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+    bool first = false;
+
+    portENTER_CRITICAL(&phaseLock);
+    if (!(markedMask & bit)) {
+        phaseMs[phase] = ms;
+        markedMask |= bit;
+        first = true;
+    }
+    portEXIT_CRITICAL(&phaseLock);
+
+    if (first && phaseEvents != NULL) {
+        xEventGroupSetBits(phaseEvents, bit);
+    }
+}
+
+bool boot_wait(BootPhase phase, uint32_t timeout_ms)
+{
+    uint32_t bit = 1U << phase;
+
+    if (markedMask & bit) {
+        return true;
+    }
+    if (phaseEvents == NULL) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(phaseEvents, bit, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & bit) != 0;
+}
+
+uint32_t boot_phase_ms(BootPhase phase)
+{
+    uint32_t ms;
+
+    if (phase >= BOOT_PHASE_COUNT) {
+        return 0;
+    }
+    portENTER_CRITICAL(&phaseLock);
+    ms = phaseMs[phase];
+    portEXIT_CRITICAL(&phaseLock);
+    return ms;
+}
+
+const char *boot_phase_name(BootPhase phase)
+{
+    return phase < BOOT_PHASE_COUNT ? phaseNames[phase] : "?";
+}
+
+void boot_report(void)
+{
+    uint32_t previous = 0;
+
+    ESP_LOGI(TAG, "boot phases, ms since start up:");
+    for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+        uint32_t ms = boot_phase_ms(p);
+
+        if (!(markedMask & (1U << p))) {
+            ESP_LOGI(TAG, "  %-16s pending", phaseNames[p]);
+            continue;
+        }
+        /* phases overlap, so a gap can be 0 - it finished before the one listed above it */
+        ESP_LOGI(TAG, "  %-16s %6u  (+%u)", phaseNames[p], ms, ms > previous ? ms - previous : 0);
+        if (ms > previous) {
+            previous = ms;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * boot profile - when each start up phase finished, and the waits between them.
+ *
+ * phases are marked by whichever task completes them; a task that needs another's
+ * phase waits for it with boot_wait rather than a fixed delay, so independent
+ * start up work (display, network, PCA9685) runs side by side. times are
+ * milliseconds of esp_timer, which starts just before app_main - the second stage
+ * bootloader before that is not included.
+ *
+ * the table is logged when the agent first connects and served as boot_phase_ms
+ * on /metrics, first servo command included.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_I2C_WAIT_MS 2000    // longest wait for the display driver to install the i2c master
+#define BOOT_NET_WAIT_MS 5000    // nvs and netif not up after this is logged, then waited for again
+#define BOOT_NET_STACK_SIZE (4 * 1024)    // nvs_flash_init is stack hungry
+#define BOOT_NET_PRIORITY 4
+
+typedef enum BootPhase {
+    BOOT_PHASE_APP_START,       // appMain entered
+    BOOT_PHASE_I2C_READY,       // display driver installed the i2c master
+    BOOT_PHASE_DISPLAY_READY,   // lvgl set up and the dashboard created
+    BOOT_PHASE_NETWORK_READY,   // nvs and netif initialised
+    BOOT_PHASE_SERVO_READY,     // PCA9685 reset, frequency set, channels configured
+    BOOT_PHASE_SERVERS_READY,   // http control and the sequence player started
+    BOOT_PHASE_AGENT_CONNECTED, // rclc_support_init returned
+    BOOT_PHASE_ROS_READY,       // subscriptions and executor created
+    BOOT_PHASE_FIRST_COMMAND,   // first servo command written to the PCA9685
+    BOOT_PHASE_COUNT
+} BootPhase;
+
+/**
+ * @brief set up the event group phases are signalled on. first thing in appMain.
+ */
+void boot_profile_init(void);
+
+/**
+ * @brief record that a phase has finished and wake anything waiting for it.
+ * only the first mark of a phase counts, later ones return at once.
+ */
+void boot_mark(BootPhase phase);
+
+/**
+ * @brief wait for another task to finish a phase.
+ *
+ * @return true once marked, false on timeout
+ */
+bool boot_wait(BootPhase phase, uint32_t timeout_ms);
+
+/**
+ * @brief milliseconds since start up the phase was marked at, 0 if not reached yet.
+ */
+uint32_t boot_phase_ms(BootPhase phase);
+
+/**
+ * @brief phase name for logs and metrics.
+ */
+const char *boot_phase_name(BootPhase phase);
+
+/**
+ * @brief log every phase with its time and the gap since the previous one.
+ */
+void boot_report(void);
+
+#ifdef __cplusplus
+}
+#endif
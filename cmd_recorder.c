@@ -0,0 +1,433 @@
+/*
+ * command recorder and replay.
+ *
+ * servo_command appends into one of two RAM buffers under a spinlock. the recorder
+ * task swaps them when the active one fills or CMD_RECORDER_FLUSH_MS passes, and
+ * programs the full one into the current sector, opening (erasing) the next sector
+ * of the ring when it runs out. flash erase and program stall both cores' cache,
+ * so it is kept to one task at the lowest priority and done in as few operations as the
+ * buffering allows.
+ *
+ * replay runs on the same task, so a replay never races the writer for the flash.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "app_ram.h"
+#include "cmd_recorder.h"
+
+#define TAG "cmd_recorder"
+
+#define NOTIFY_FLUSH (1U << 0)
+#define NOTIFY_REPLAY (1U << 1)
+#define NOTIFY_STOP (1U << 2)
+
+#define RECORD_END 0xFFFFFFFF // t_ms of erased flash
+
+/***************************
+ * globals
+ ***************************/
+static const esp_partition_t *partition;
+static uint32_t sectorCount;
+static TaskHandle_t recorderTask;
+static StaticTask_t recorderTaskBuffer;
+static StackType_t recorderStack[CMD_RECORDER_STACK_SIZE];
+
+/* RAM buffers, filled by cmd_recorder_append, swapped and emptied by the task */
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static CmdRecord pending[2][CMD_RECORDER_FLUSH_RECORDS];
+static uint32_t pendingCount[2];
+static int activeBuf;
+static CmdRecorderStats stats;
+
+static volatile bool replayStop;
+static uint32_t replaySpeed;
+
+/* writer position, only touched by the recorder task after start */
+static uint32_t curSector;
+static uint32_t curOffset = CMD_RECORDER_SECTOR_SIZE; // full, so the first write opens a sector
+static uint32_t nextSeq;
+static uint32_t session;
+static bool haveLog;
+
+void cmd_recorder_append(ServoCommandSource source, uint8_t channel, ServoUnit unit, int32_t value)
+{
+    if (recorderTask == NULL || source == SERVO_SOURCE_REPLAY) {
+        return;
+    }
+
+    /* anything further out than 19 bits is out of range in every unit, and still is once clamped */
+    if (value > CMD_RECORD_VALUE_MAX) {
+        value = CMD_RECORD_VALUE_MAX;
+    } else if (value < -CMD_RECORD_VALUE_MAX) {
+        value = -CMD_RECORD_VALUE_MAX;
+    }
+    CmdRecord rec = {
+        .t_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .channel = channel,
+        .flags = CMD_RECORD_FLAGS(source, unit, value),
+        .value = (int16_t)(value & 0xFFFF),
+    };
+    bool full = false;
+
+    portENTER_CRITICAL(&lock);
+    if (stats.replaying) {
+        portEXIT_CRITICAL(&lock);
+        return;
+    }
+    uint32_t n = pendingCount[activeBuf];
+    if (n < CMD_RECORDER_FLUSH_RECORDS) {
+        pending[activeBuf][n] = rec;
+        pendingCount[activeBuf] = n + 1;
+        full = (n + 1 == CMD_RECORDER_FLUSH_RECORDS);
+        stats.recorded++;
+    } else {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (full) {
+        xTaskNotify(recorderTask, NOTIFY_FLUSH, eSetBits);
+    }
+}
+
+static uint32_t sector_address(uint32_t sector)
+{
+    return sector * CMD_RECORDER_SECTOR_SIZE;
+}
+
+static esp_err_t read_header(uint32_t sector, CmdLogSector *header)
+{
+    esp_err_t err = esp_partition_read(partition, sector_address(sector), header, sizeof(*header));
+
+    if (err == ESP_OK && header->magic != CMD_LOG_MAGIC) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return err;
+}
+
+static esp_err_t open_next_sector(void)
+{
+    uint32_t sector = (curSector + 1) % sectorCount;
+    CmdLogSector header = {
+        .magic = CMD_LOG_MAGIC,
+        .seq = nextSeq,
+        .session = session,
+    };
+
+    esp_err_t err = esp_partition_erase_range(partition, sector_address(sector), CMD_RECORDER_SECTOR_SIZE);
+    if (err == ESP_OK) {
+        err = esp_partition_write(partition, sector_address(sector), &header, sizeof(header));
+    }
+
+    curSector = sector;
+    nextSeq++;
+    curOffset = err == ESP_OK ? sizeof(header) : CMD_RECORDER_SECTOR_SIZE;
+    haveLog = haveLog || err == ESP_OK;
+
+    portENTER_CRITICAL(&lock);
+    stats.erases++;
+    stats.writes++;
+    stats.bytes_written += sizeof(header);
+    portEXIT_CRITICAL(&lock);
+
+    return err;
+}
+
+static void write_records(const CmdRecord *recs, uint32_t count)
+{
+    while (count > 0) {
+        if (curOffset >= CMD_RECORDER_SECTOR_SIZE) {
+            esp_err_t err = open_next_sector();
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "sector %u: %s, dropping %u records", curSector, esp_err_to_name(err), count);
+                portENTER_CRITICAL(&lock);
+                stats.dropped += count;
+                portEXIT_CRITICAL(&lock);
+                return;
+            }
+        }
+
+        uint32_t room = (CMD_RECORDER_SECTOR_SIZE - curOffset) / sizeof(CmdRecord);
+        uint32_t n = count < room ? count : room;
+        uint32_t len = n * sizeof(CmdRecord);
+
+        esp_err_t err = esp_partition_write(partition, sector_address(curSector) + curOffset, recs, len);
+        if (err != ESP_OK) {
+            /* leave the rest of this sector alone, the next write starts a fresh one */
+            ESP_LOGE(TAG, "write at sector %u: %s", curSector, esp_err_to_name(err));
+            curOffset = CMD_RECORDER_SECTOR_SIZE;
+            portENTER_CRITICAL(&lock);
+            stats.dropped += n;
+            portEXIT_CRITICAL(&lock);
+        } else {
+            curOffset += len;
+            portENTER_CRITICAL(&lock);
+            stats.writes++;
+            stats.bytes_written += len;
+            portEXIT_CRITICAL(&lock);
+        }
+        recs += n;
+        count -= n;
+    }
+}
+
+/*
+ * swap the buffers and write the one that was filling.
+ * @return true if anything was written
+ */
+static bool flush_one(void)
+{
+    portENTER_CRITICAL(&lock);
+    int buf = activeBuf;
+    uint32_t count = pendingCount[buf];
+    if (count > 0) {
+        activeBuf ^= 1;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (count == 0) {
+        return false;
+    }
+
+    write_records(pending[buf], count);
+
+    portENTER_CRITICAL(&lock);
+    pendingCount[buf] = 0;
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+/*
+ * the first sector of the newest session: walk back from the newest sector
+ * while the sequence numbers are consecutive and the session matches.
+ */
+static uint32_t session_first_sector(const CmdLogSector *newest)
+{
+    uint32_t first = curSector;
+
+    for (uint32_t back = 1; back < sectorCount; back++) {
+        uint32_t sector = (curSector + sectorCount - back) % sectorCount;
+        CmdLogSector header;
+
+        if (read_header(sector, &header) != ESP_OK || header.session != newest->session
+            || header.seq != newest->seq - back) {
+            break;
+        }
+        first = sector;
+    }
+    return first;
+}
+
+/*
+ * sleep until a record is due. a stop notification ends the wait at once, and recording
+ * from other sources keeps being flushed however long the gap in the session is.
+ * returns false if the replay was stopped.
+ */
+static bool wait_until(int64_t due_us)
+{
+    for (;;) {
+        if (replayStop) {
+            return false;
+        }
+
+        int64_t wait_us = due_us - esp_timer_get_time();
+        TickType_t ticks = pdMS_TO_TICKS(wait_us / 1000);
+
+        /* less than a tick early at worst, and due times are absolute so it never accumulates */
+        if (wait_us <= 0 || ticks == 0) {
+            return true;
+        }
+        if (ticks > pdMS_TO_TICKS(CMD_RECORDER_FLUSH_MS)) {
+            ticks = pdMS_TO_TICKS(CMD_RECORDER_FLUSH_MS);
+        }
+        xTaskNotifyWait(0, NOTIFY_FLUSH | NOTIFY_STOP, NULL, ticks);
+        while (flush_one()) {
+        }
+    }
+}
+
+static void replay_newest(uint32_t speed)
+{
+    CmdRecord recs[CMD_RECORDER_FLUSH_RECORDS];
+    CmdLogSector newest;
+    bool started = false;
+    uint32_t t0 = 0;
+    int64_t start_us = 0;
+    uint32_t replayed = 0;
+    uint32_t errors = 0;
+
+    if (!haveLog || read_header(curSector, &newest) != ESP_OK) {
+        ESP_LOGW(TAG, "nothing recorded to replay");
+        return;
+    }
+
+    uint32_t sector = session_first_sector(&newest);
+    ESP_LOGI(TAG, "replaying session %08x from sector %u, speed %u", newest.session, sector, speed);
+
+    for (;;) {
+        bool sectorEnd = false;
+
+        for (uint32_t off = sizeof(CmdLogSector); off < CMD_RECORDER_SECTOR_SIZE && !sectorEnd; off += sizeof(recs)) {
+            uint32_t len = CMD_RECORDER_SECTOR_SIZE - off < sizeof(recs) ? CMD_RECORDER_SECTOR_SIZE - off : sizeof(recs);
+
+            if (esp_partition_read(partition, sector_address(sector) + off, recs, len) != ESP_OK) {
+                break;
+            }
+            for (uint32_t i = 0; i < len / sizeof(CmdRecord); i++) {
+                const CmdRecord *rec = &recs[i];
+
+                if (rec->t_ms == RECORD_END) {
+                    sectorEnd = true;
+                    break;
+                }
+                if (!started) {
+                    t0 = rec->t_ms;
+                    start_us = esp_timer_get_time();
+                    started = true;
+                }
+                if (speed > 0 && !wait_until(start_us + (int64_t)(rec->t_ms - t0) * 1000 / speed)) {
+                    goto done;
+                }
+                if (replayStop) {
+                    goto done;
+                }
+
+                if (servo_command_set_position(SERVO_SOURCE_REPLAY, rec->channel, CMD_RECORD_UNIT(rec->flags),
+                                               CMD_RECORD_VALUE(rec)) != ESP_OK) {
+                    errors++;
+                }
+                replayed++;
+            }
+        }
+
+        if (sector == curSector) {
+            break;
+        }
+        sector = (sector + 1) % sectorCount;
+    }
+
+done:
+    ESP_LOGI(TAG, "replayed %u commands, %u errors%s", replayed, errors, replayStop ? ", stopped" : "");
+    portENTER_CRITICAL(&lock);
+    stats.replayed += replayed;
+    stats.replay_errors += errors;
+    portEXIT_CRITICAL(&lock);
+}
+
+static void cmd_recorder_task(void *arg)
+{
+    for (;;) {
+        uint32_t bits = 0;
+
+        xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(CMD_RECORDER_FLUSH_MS));
+
+        while (flush_one()) {
+        }
+
+        if (bits & NOTIFY_REPLAY) {
+            replay_newest(replaySpeed);
+            portENTER_CRITICAL(&lock);
+            stats.replaying = false;
+            portEXIT_CRITICAL(&lock);
+        }
+    }
+}
+
+esp_err_t cmd_recorder_start(void)
+{
+    if (recorderTask != NULL) {
+        return ESP_OK;
+    }
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         CMD_RECORDER_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "no \"%s\" partition, commands are not recorded", CMD_RECORDER_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sectorCount = partition->size / CMD_RECORDER_SECTOR_SIZE;
+
+    /* carry on after the newest sector so the ring wears evenly across boots */
+    curSector = sectorCount - 1;
+    for (uint32_t sector = 0; sector < sectorCount; sector++) {
+        CmdLogSector header;
+
+        if (read_header(sector, &header) != ESP_OK) {
+            continue;
+        }
+        if (!haveLog || (int32_t)(header.seq - nextSeq) >= 0) {
+            curSector = sector;
+            nextSeq = header.seq + 1;
+            haveLog = true;
+        }
+    }
+    session = esp_random();
+
+    recorderTask = xTaskCreateStatic(cmd_recorder_task, "cmd_recorder", CMD_RECORDER_STACK_SIZE,
+                                     NULL, CMD_RECORDER_PRIORITY, recorderStack, &recorderTaskBuffer);
+    app_ram_reserve(APP_RAM_RECORDER, sizeof(recorderTaskBuffer) + sizeof(recorderStack) + sizeof(pending));
+
+    ESP_LOGI(TAG, "%u sectors at 0x%x, next seq %u, session %08x",
+             sectorCount, partition->address, nextSeq, session);
+    return ESP_OK;
+}
+
+esp_err_t cmd_recorder_replay(uint32_t speed)
+{
+    if (recorderTask == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&lock);
+    bool busy = stats.replaying;
+    stats.replaying = true;
+    portEXIT_CRITICAL(&lock);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    replaySpeed = speed;
+    replayStop = false;
+    xTaskNotify(recorderTask, NOTIFY_REPLAY, eSetBits);
+    return ESP_OK;
+}
+
+void cmd_recorder_replay_stop(void)
+{
+    replayStop = true;
+    if (recorderTask != NULL) {
+        xTaskNotify(recorderTask, NOTIFY_STOP, eSetBits);
+    }
+}
+
+esp_err_t cmd_recorder_read(uint32_t offset, void *buf, uint32_t len)
+{
+    if (partition == NULL || offset + len > partition->size) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_partition_read(partition, offset, buf, len);
+}
+
+uint32_t cmd_recorder_size(void)
+{
+    return recorderTask != NULL ? partition->size : 0;
+}
+
+void cmd_recorder_get_stats(CmdRecorderStats *out)
+{
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
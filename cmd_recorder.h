@@ -0,0 +1,126 @@
+/*
+ * cmd_recorder - every servo command appended to a log in a raw flash partition,
+ * and replayed back through servo_command with the original or accelerated timing.
+ *
+ * the partition is a ring of 4KB sectors. each sector starts with a CmdLogSector
+ * header and is followed by 8 byte CmdRecord entries up to the end of the sector; erased
+ * flash (t_ms 0xFFFFFFFF) ends the records. commands are gathered in RAM and appended
+ * CMD_RECORDER_FLUSH_RECORDS at a time, or every CMD_RECORDER_FLUSH_MS, into the
+ * erased part of the current sector - every byte is programmed once and every sector
+ * erased once per lap of the ring. nothing is erased until the first command of a boot.
+ *
+ * needs a data partition in the partition table, e.g.
+ *   cmdlog, data, 0x40, , 256K
+ * without one recording is disabled with an error at start.
+ *
+ * GET /cmdlog on the http control server returns the raw partition;
+ * tools/cmdlog.py decodes it and can replay a session against the http endpoint.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "servo_command.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// uncomment to record servo commands to flash
+// #define CMD_RECORDER 1
+
+#define CMD_RECORDER_PARTITION_LABEL "cmdlog"
+#define CMD_RECORDER_SECTOR_SIZE 4096
+#define CMD_RECORDER_FLUSH_RECORDS 64   // 512 bytes per flash write
+#define CMD_RECORDER_FLUSH_MS 1000      // a partial buffer is written after this long
+#define CMD_RECORDER_STACK_SIZE (3 * 1024)
+#define CMD_RECORDER_PRIORITY 1
+
+#define CMD_LOG_MAGIC 0x324C4D43        // "CML2"
+
+/*
+ * CmdRecord.flags: bits 0-2 the ServoCommandSource, bits 3-4 the ServoUnit, bits 5-7 bits 16-18
+ * of the value. with `value` below that is a 19 bit signed value, enough for milli-degrees.
+ */
+#define CMD_RECORD_VALUE_MAX ((1 << 18) - 1)
+#define CMD_RECORD_SOURCE(flags) ((flags) & 0x07)
+#define CMD_RECORD_UNIT(flags) (((flags) >> 3) & 0x03)
+#define CMD_RECORD_FLAGS(source, unit, value) (((source) & 0x07) | (((unit) & 0x03) << 3) | ((((value) >> 16) & 0x07) << 5))
+#define CMD_RECORD_VALUE(rec) ((int32_t)(((uint32_t)(rec)->flags >> 5) << 29 | (uint32_t)(uint16_t)(rec)->value << 13) >> 13)
+
+typedef struct CmdLogSector {
+    uint32_t magic;
+    uint32_t seq;      // increases by one for every sector opened, across boots
+    uint32_t session;  // random per boot, records of one boot share it
+    uint32_t reserved;
+} CmdLogSector;
+
+typedef struct CmdRecord {
+    uint32_t t_ms;     // milliseconds since boot
+    uint8_t channel;
+    uint8_t flags;
+    int16_t value;     // low 16 bits, see CMD_RECORD_VALUE
+} CmdRecord;
+
+typedef struct CmdRecorderStats {
+    uint32_t recorded;       // commands accepted into the RAM buffer
+    uint32_t dropped;        // commands lost because both buffers were waiting for flash
+    uint32_t writes;         // flash program operations
+    uint32_t bytes_written;  // bytes programmed, headers included
+    uint32_t erases;         // sectors erased
+    uint32_t replayed;       // commands applied by replay
+    uint32_t replay_errors;  // replayed commands servo_command refused or failed
+    bool replaying;
+} CmdRecorderStats;
+
+/**
+ * @brief find the partition, pick up the sequence after the newest sector and start the writer task.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_NOT_FOUND without a cmdlog partition, ESP_ERR_NO_MEM
+ */
+esp_err_t cmd_recorder_start(void);
+
+/**
+ * @brief queue one command for the log. called by servo_command with the actuation lock held.
+ * never blocks and never touches flash; replayed commands and commands during a replay are not recorded.
+ */
+void cmd_recorder_append(ServoCommandSource source, uint8_t channel, ServoUnit unit, int32_t value);
+
+/**
+ * @brief write out what is buffered and replay the newest session on the writer task.
+ *
+ * @param speed - 1 for the recorded timing, N for N times faster, 0 for back to back
+ * @return
+ *     - ESP_OK, ESP_ERR_INVALID_STATE if not started or a replay is already running
+ */
+esp_err_t cmd_recorder_replay(uint32_t speed);
+
+/**
+ * @brief stop a running replay after the current command, even mid way through a gap.
+ */
+void cmd_recorder_replay_stop(void);
+
+/**
+ * @brief read raw partition bytes, e.g. to serve the log over http.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_INVALID_STATE if not started, or the esp_partition_read error
+ */
+esp_err_t cmd_recorder_read(uint32_t offset, void *buf, uint32_t len);
+
+/**
+ * @brief size of the log partition in bytes, 0 if recording is not running.
+ */
+uint32_t cmd_recorder_size(void);
+
+/**
+ * @brief copy out the counters. safe to call from any task.
+ */
+void cmd_recorder_get_stats(CmdRecorderStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
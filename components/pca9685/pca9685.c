@@ -49,7 +49,7 @@ esp_err_t resetPCA9685(void)
     i2c_master_write_byte(cmd, MODE1, ACK_CHECK_EN);   // 0x0 = "Mode register 1"
     i2c_master_write_byte(cmd, 0x80, ACK_CHECK_EN);    // 0x80 = "Reset"
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000/portTICK_PERIOD_MS);
+    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, PCA9685_I2C_DEADLINE_TICKS(3));
     i2c_cmd_link_delete(cmd);
     
     vTaskDelay(50 / portTICK_RATE_MS);
@@ -79,7 +79,7 @@ esp_err_t generic_write_i2c_register_two_words(uint8_t regaddr, uint16_t valueOn
     i2c_master_write_byte(cmd, valueOff & 0xff, ACK_VAL);
     i2c_master_write_byte(cmd, valueOff >> 8, NACK_VAL);
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000/portTICK_PERIOD_MS);
+    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, PCA9685_I2C_DEADLINE_TICKS(6));
     i2c_cmd_link_delete(cmd);
 
     return ret;
@@ -104,7 +104,7 @@ esp_err_t generic_write_i2c_register_word(uint8_t regaddr, uint16_t value)
     i2c_master_write_byte(cmd, value & 0xff, ACK_VAL);
     i2c_master_write_byte(cmd, value >> 8, NACK_VAL);
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000/portTICK_PERIOD_MS);
+    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, PCA9685_I2C_DEADLINE_TICKS(4));
     i2c_cmd_link_delete(cmd);
 
     return ret;
@@ -128,7 +128,7 @@ esp_err_t generic_write_i2c_register(uint8_t regaddr, uint8_t value)
     i2c_master_write_byte(cmd, regaddr, ACK_CHECK_EN);
     i2c_master_write_byte(cmd, value, NACK_VAL);
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000/portTICK_PERIOD_MS);
+    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, PCA9685_I2C_DEADLINE_TICKS(3));
     i2c_cmd_link_delete(cmd);
 
     return ret;
@@ -152,7 +152,7 @@ esp_err_t generic_read_two_i2c_register(uint8_t regaddr, uint8_t* valueA, uint8_
     i2c_master_write_byte(cmd, (PCA9685_ADDR << 1) | I2C_MASTER_WRITE, ACK_CHECK_EN);
     i2c_master_write_byte(cmd, regaddr, ACK_CHECK_EN);
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000 / portTICK_RATE_MS);
+    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, PCA9685_I2C_DEADLINE_TICKS(2));
     i2c_cmd_link_delete(cmd);
     if (ret != ESP_OK) {
         return ret;
@@ -163,7 +163,7 @@ esp_err_t generic_read_two_i2c_register(uint8_t regaddr, uint8_t* valueA, uint8_
     i2c_master_read_byte(cmd, valueA, ACK_VAL);
     i2c_master_read_byte(cmd, valueB, NACK_VAL);
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000 / portTICK_RATE_MS);
+    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, PCA9685_I2C_DEADLINE_TICKS(3));
     i2c_cmd_link_delete(cmd);
     
     return ret;
@@ -195,6 +195,25 @@ esp_err_t generic_read_i2c_register_word(uint8_t regaddr, uint16_t* value)
 }
 
 
+/**
+ * @brief      The prescaler value setFrequencyPCA9685 writes for a frequency
+ *
+ * @param[in]  freq  The frequency
+ *
+ * @return     round(osc / (4096 * freq)) - 1, limited to the 3 .. 255 the chip accepts
+ */
+uint8_t prescaleForFrequency(uint16_t freq)
+{
+    // calculation on page 25 of datasheet
+    uint32_t steps_hz = 4096 * (uint32_t) (freq ? freq : 1);
+    uint32_t prescale = ((uint32_t) CLOCK_FREQ + steps_hz / 2) / steps_hz;
+
+    if (prescale < 4) {
+        return 3;
+    }
+    return prescale > 256 ? 255 : prescale - 1;
+}
+
 /**
  * @brief      Sets the frequency of PCA9685 PWM
  *
@@ -213,9 +232,7 @@ esp_err_t setFrequencyPCA9685(uint16_t freq)
     }
 
     // Set prescaler
-    // calculation on page 25 of datasheet
-    // uint8_t prescale_val = round((CLOCK_FREQ / 4096 / (0.9*freq)) - 1+0.5);
-    uint8_t prescale_val = round((CLOCK_FREQ / 4096 / freq)) - 1+0.5;
+    uint8_t prescale_val = prescaleForFrequency(freq);
     ret = generic_write_i2c_register(PRE_SCALE, prescale_val);
     if (ret != ESP_OK) { 
         return ret;
@@ -275,6 +292,40 @@ esp_err_t setPWM(uint8_t num, uint16_t on, uint16_t off)
     return ret;
 }
 
+/**
+ * @brief      Sets the pwm of consecutive pins in one transaction
+ *
+ * the LEDn registers are contiguous and MODE1 auto increment is enabled by
+ * setFrequencyPCA9685, so the on/off words of every pin follow one register address.
+ *
+ * @param[in]  first  The first pin number
+ * @param[in]  count  Number of pins
+ * @param[in]  on     On time per pin
+ * @param[in]  off    Off time per pin
+ * 
+ * @return     result of command
+ */
+esp_err_t setPWMRange(uint8_t first, uint8_t count, const uint16_t* on, const uint16_t* off)
+{
+    esp_err_t ret;
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (PCA9685_ADDR << 1) | I2C_MASTER_WRITE, ACK_CHECK_EN);
+    i2c_master_write_byte(cmd, (LED0_ON_L + LED_MULTIPLYER * first) & 0xff, ACK_CHECK_EN);
+    for (uint8_t i = 0; i < count; i++) {
+        i2c_master_write_byte(cmd, on[i] & 0xff, ACK_CHECK_EN);
+        i2c_master_write_byte(cmd, on[i] >> 8, ACK_CHECK_EN);
+        i2c_master_write_byte(cmd, off[i] & 0xff, ACK_CHECK_EN);
+        i2c_master_write_byte(cmd, off[i] >> 8, ACK_CHECK_EN);
+    }
+    i2c_master_stop(cmd);
+    ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, PCA9685_I2C_DEADLINE_TICKS(2 + 4 * count));
+    i2c_cmd_link_delete(cmd);
+
+    return ret;
+}
+
 /**
  * @brief      Gets the pwm of a pin detail
  * 
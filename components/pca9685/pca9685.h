@@ -48,11 +48,24 @@
 #define PRE_SCALE       0xFE    /*!< prescaler for output frequency */
 #define CLOCK_FREQ      25000000.0  /*!< 25MHz default osc clock */
 
+#define PCA9685_I2C_BUS_HZ  100000  /*!< slowest bus clock assumed when sizing deadlines */
+#define PCA9685_I2C_WAIT_MS 20      /*!< allowance for waiting on the bus, e.g. behind a display flush */
+
+/*!< on-wire time of `bytes` bytes, address included, at 9 clocks a byte, in whole milliseconds rounded up */
+#define PCA9685_I2C_WIRE_MS(bytes) \
+    (((bytes) * 9UL * 1000000UL / PCA9685_I2C_BUS_HZ + 999) / 1000)
+
+/*!< deadline for a transaction of `bytes` bytes: its wire time plus the wait allowance */
+#define PCA9685_I2C_DEADLINE_TICKS(bytes) \
+    (pdMS_TO_TICKS(PCA9685_I2C_WIRE_MS(bytes) + PCA9685_I2C_WAIT_MS) + 1)
+
 extern void set_pca9685_adress(uint8_t addr);
 extern esp_err_t resetPCA9685(void);
+extern uint8_t prescaleForFrequency(uint16_t freq);
 extern esp_err_t setFrequencyPCA9685(uint16_t freq);
 extern esp_err_t turnAllOff(void);
 extern esp_err_t setPWM(uint8_t num, uint16_t on, uint16_t off);
+extern esp_err_t setPWMRange(uint8_t first, uint8_t count, const uint16_t* on, const uint16_t* off);
 extern esp_err_t getPWMDetail(uint8_t num, uint8_t* dataReadOn0, uint8_t* dataReadOn1, uint8_t* dataReadOff0, uint8_t* dataReadOff1);
 // extern esp_err_t getPWM(uint8_t num, uint16_t* dataReadOn, uint16_t* dataReadOff);
 // extern esp_err_t getPWM(uint8_t num);
@@ -0,0 +1,86 @@
+/*
+ * gui benchmark - synthetic servo events, per frame cost report and a frame snapshot.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include "gui_benchmark.h"
+
+#ifdef GUI_BENCHMARK
+
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "app.h"
+#include "gui_task.h"
+#include "oled_ssd1306.h"
+
+#define TAG "gui_bench"
+
+/*
+ * every tick, move each channel one step along a triangle sweep with a per channel
+ * phase - every bar changes every tick, the worst case for the dashboard.
+ */
+static void gui_benchmark_task(void *pvParameter)
+{
+    GuiStats gui0, gui1;
+    OledFlushStats flush0, flush1;
+    GuiIpcStats ipc0, ipc1;
+    uint32_t step = 0;
+
+    (void) pvParameter;
+
+    ESP_LOGI(TAG, "driving %d channels for %d seconds", kServoChannelCount, GUI_BENCHMARK_SECONDS);
+    gui_get_stats(&gui0);
+    oled_get_flush_stats(&flush0);
+    gui_ipc_get_stats(&ipc0);
+
+    int64_t start = esp_timer_get_time();
+    while (esp_timer_get_time() - start < (int64_t) GUI_BENCHMARK_SECONDS * 1000000) {
+        for (int ch = 0; ch < kServoChannelCount; ch++) {
+            int32_t pos = (step + ch * 23) % 360;
+            gui_ipc_post_servo_angle(ch, pos < 180 ? pos : 360 - pos);
+        }
+        step++;
+        vTaskDelay(1);
+    }
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    gui_get_stats(&gui1);
+    oled_get_flush_stats(&flush1);
+    gui_ipc_get_stats(&ipc1);
+
+    uint32_t frames = gui1.frames - gui0.frames;
+    uint32_t flushes = flush1.frames - flush0.frames;
+    uint32_t busy = (uint32_t)(gui1.busy_us - gui0.busy_us);
+    uint32_t bytes = flush1.bytes - flush0.bytes;
+
+    ESP_LOGI(TAG, "events: %u posted, %u coalesced in %ums",
+        ipc1.posted - ipc0.posted, ipc1.coalesced - ipc0.coalesced, elapsed_ms);
+    ESP_LOGI(TAG, "frames: %u (%u fps), render avg %uus/frame, max %uus",
+        frames, frames * 1000 / elapsed_ms, frames ? busy / frames : 0, gui1.max_frame_us);
+    ESP_LOGI(TAG, "flush: %u bytes, %u windows, avg %u bytes/frame (full frame %u)",
+        bytes, flush1.windows - flush0.windows, flushes ? bytes / flushes : 0, OLED_FRAME_BYTES);
+
+    if (pdTRUE == xSemaphoreTake(xGuiSemaphore, portMAX_DELAY)) {
+        printf("\n%s\n", GUI_BENCHMARK_PBM_BEGIN);
+        oled_write_pbm(stdout);
+        printf("\n%s\n", GUI_BENCHMARK_PBM_END);
+        xSemaphoreGive(xGuiSemaphore);
+    }
+
+    vTaskDelete(NULL);
+}
+
+void gui_benchmark_start(void)
+{
+    xTaskCreate(gui_benchmark_task, "gui_bench", GUI_BENCHMARK_STACK_SIZE, NULL, 1, NULL);
+}
+
+#endif /* GUI_BENCHMARK */
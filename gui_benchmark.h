@@ -0,0 +1,24 @@
+/*
+ * gui benchmark - drives synthetic servo events through the same ipc path the
+ * uros task uses, then reports render time and flush volume per frame and dumps
+ * a PBM snapshot of the final frame over serial. cut it out of the capture and
+ * compare it with a golden image with tools/gui_snapshot.py.
+ *
+ * combine with OLED_HEADLESS (oled_ssd1306.h) to run without a panel attached.
+ */
+#pragma once
+
+// uncomment to run the benchmark once the gui is up.
+// #define GUI_BENCHMARK 1
+
+#define GUI_BENCHMARK_SECONDS 10
+#define GUI_BENCHMARK_STACK_SIZE 3072
+
+/* markers around the snapshot so it can be cut out of a serial capture - tools/gui_snapshot.py looks for them */
+#define GUI_BENCHMARK_PBM_BEGIN "----- PBM BEGIN -----"
+#define GUI_BENCHMARK_PBM_END "----- PBM END -----"
+
+/**
+ * @brief start the benchmark task. call from the gui task once the dashboard exists.
+ */
+void gui_benchmark_start(void);
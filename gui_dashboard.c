@@ -0,0 +1,155 @@
+/*
+ * gui dashboard - per channel bars, link status and command rate.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "gui_dashboard.h"
+#include "oled_ssd1306.h"
+#include "oled_fields.h"
+
+#define TAG "dashboard"
+
+#define DASH_STATUS_Y 0
+#define DASH_STATUS_H 16
+#define DASH_BARS_Y 16
+#define DASH_BARS_H 32
+#define DASH_VALUE_Y 48
+#define DASH_CHANNEL_COL 48  // glyph field for the channel number
+#define DASH_CHANNEL_CHARS 2
+#define DASH_ANGLE_CHARS 4   // glyph field for the angle, right aligned on the panel
+#define DASH_BAR_PITCH (OLED_WIDTH / kServoChannelCount)
+#define DASH_BAR_W (DASH_BAR_PITCH - 2)
+#define DASH_BAR_MAX_DEGREE 180
+#define DASH_STATUS_PERIOD_MS 1000 // how often the command rate is recalculated
+#define DASH_TEXT_SIZE 24
+
+/***************************
+ * globals
+ ***************************/
+static lv_obj_t *statusLabel;
+static lv_obj_t *valueLabel;
+static lv_obj_t *bars[kServoChannelCount];
+static int16_t barValue[kServoChannelCount];
+
+static int channelField = -1;
+static int angleField = -1;
+
+static char statusText[DASH_TEXT_SIZE];
+static char valueText[DASH_TEXT_SIZE];
+static bool shownLinkUp;
+static uint32_t commandRate;
+
+/*
+ * set a label's text only if it differs - lv_label_set_text always invalidates.
+ */
+static void set_label_if_changed(lv_obj_t *label, char *current, const char *text)
+{
+    if (strncmp(current, text, DASH_TEXT_SIZE) == 0) {
+        return;
+    }
+    strncpy(current, text, DASH_TEXT_SIZE - 1);
+    current[DASH_TEXT_SIZE - 1] = '\0';
+    lv_label_set_text(label, current);
+}
+
+static void update_status(void)
+{
+    char text[DASH_TEXT_SIZE];
+
+    shownLinkUp = gui_ipc_link_up();
+    snprintf(text, sizeof(text), "ROS %s %u/s", shownLinkUp ? "up" : "down", commandRate);
+    set_label_if_changed(statusLabel, statusText, text);
+}
+
+/*
+ * lvgl task - recalculates the command rate from the ipc counters once a period.
+ */
+static void status_task(lv_task_t *task)
+{
+    static uint32_t lastPosted;
+    static uint32_t lastTick;
+    GuiIpcStats stats;
+
+    (void) task;
+
+    gui_ipc_get_stats(&stats);
+    uint32_t elapsed = lv_tick_elaps(lastTick);
+    if (elapsed > 0) {
+        commandRate = (stats.posted - lastPosted) * 1000 / elapsed;
+    }
+    lastPosted = stats.posted;
+    lastTick = lv_tick_get();
+
+    update_status();
+}
+
+void dashboard_create(lv_obj_t *scr)
+{
+    ESP_LOGI(TAG, "creating dashboard for %d channels.", kServoChannelCount);
+
+    /* a fixed box over pages 0-1, so a longer or shorter status only redraws those pages */
+    statusLabel = lv_label_create(scr, NULL);
+    lv_label_set_long_mode(statusLabel, LV_LABEL_LONG_CROP);
+    lv_obj_set_size(statusLabel, OLED_WIDTH, DASH_STATUS_H);
+    lv_obj_set_pos(statusLabel, 0, DASH_STATUS_Y);
+
+    for (int i = 0; i < kServoChannelCount; i++) {
+        bars[i] = lv_bar_create(scr, NULL);
+        lv_obj_set_size(bars[i], DASH_BAR_W, DASH_BARS_H);
+        lv_obj_set_pos(bars[i], i * DASH_BAR_PITCH + 1, DASH_BARS_Y);
+        lv_bar_set_range(bars[i], 0, DASH_BAR_MAX_DEGREE);
+        lv_bar_set_value(bars[i], 0, LV_ANIM_OFF);
+        barValue[i] = 0;
+    }
+
+    /* only the static caption is an lvgl label - the numbers are glyph fields
+     * so a new value is a few byte copies rather than a label relayout */
+    valueLabel = lv_label_create(scr, NULL);
+    lv_obj_set_pos(valueLabel, 0, DASH_VALUE_Y);
+    set_label_if_changed(valueLabel, valueText, "Servo");
+
+    uint8_t cell = oled_glyphs_init(lv_obj_get_style_text_font(valueLabel, LV_LABEL_PART_MAIN));
+    channelField = oled_field_create(DASH_VALUE_Y / 8, DASH_CHANNEL_COL, DASH_CHANNEL_CHARS);
+    angleField = oled_field_create(DASH_VALUE_Y / 8, OLED_WIDTH - DASH_ANGLE_CHARS * cell, DASH_ANGLE_CHARS);
+    oled_field_set_text(channelField, "--");
+    oled_field_set_text(angleField, "--");
+
+    update_status();
+    lv_task_create(status_task, DASH_STATUS_PERIOD_MS, LV_TASK_PRIO_LOW, NULL);
+}
+
+void dashboard_apply(const ServoDisplayState *states, uint32_t dirty_mask, int last_servo_num)
+{
+    for (int i = 0; i < kServoChannelCount; i++) {
+        if (!(dirty_mask & (1u << i))) {
+            continue;
+        }
+
+        int32_t angle = states[i].angle;
+        if (angle < 0) {
+            angle = 0;
+        } else if (angle > DASH_BAR_MAX_DEGREE) {
+            angle = DASH_BAR_MAX_DEGREE;
+        }
+        if (angle != barValue[i]) {
+            barValue[i] = angle;
+            lv_bar_set_value(bars[i], angle, LV_ANIM_OFF);
+        }
+    }
+
+    if (last_servo_num >= 0 && (dirty_mask & (1u << last_servo_num))) {
+        oled_field_set_int(channelField, last_servo_num);
+        oled_field_set_int(angleField, states[last_servo_num].angle);
+    }
+
+    if (shownLinkUp != gui_ipc_link_up()) {
+        update_status();
+    }
+}
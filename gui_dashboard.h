@@ -0,0 +1,35 @@
+/*
+ * gui dashboard - the servo overview shown on the monochrome display.
+ * all functions must be called from the gui task with xGuiSemaphore held.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+#include "app.h"
+
+/**
+ * @brief build the dashboard widgets on the given screen.
+ *
+ * layout, aligned to the 8 pixel pages so a change only dirties its own pages:
+ *   pages 0-1  link status and command rate
+ *   pages 2-5  one bar per servo channel
+ *   pages 6-7  the most recently commanded channel and its value, as glyph fields
+ */
+void dashboard_create(lv_obj_t *scr);
+
+/**
+ * @brief push changed servo state into the widgets. only widgets whose value
+ * differs from what is on screen are touched, so only they get invalidated.
+ *
+ * @param states - kServoChannelCount entries, valid where dirty_mask is set
+ * @param dirty_mask - channels that changed since the last call
+ * @param last_servo_num - the most recently commanded channel, -1 if none
+ */
+void dashboard_apply(const ServoDisplayState *states, uint32_t dirty_mask, int last_servo_num);
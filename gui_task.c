@@ -16,7 +16,9 @@
 #include "freertos/semphr.h"
 #include "freertos/queue.h"
 #include "esp_system.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 
 /* Littlevgl specific */
@@ -28,6 +30,13 @@
 
 #include "lvgl_helpers.h"
 #include "app.h"
+#include "app_ram.h"
+#include "boot_profile.h"
+#include "oled_ssd1306.h"
+#include "gui_dashboard.h"
+#include "gui_benchmark.h"
+#include "supervisor.h"
+#include "trace.h"
 
 #ifndef CONFIG_LV_TFT_DISPLAY_MONOCHROME
     #error "Only doing monochrome display."
@@ -37,48 +46,80 @@
  *      DEFINES
  *********************/
 #define TAG "gui"
-#define LV_TICK_PERIOD_MS 1
+#define GUI_MAX_FPS 25                                       // cap on display refreshes per second
+#define GUI_MIN_FRAME_TICKS (pdMS_TO_TICKS(1000 / GUI_MAX_FPS))
+#define GUI_IDLE_WAIT_TICKS pdMS_TO_TICKS(1000)              // longest sleep when lvgl has nothing scheduled
+#define GUI_STATS_PERIOD_US (10 * 1000 * 1000)               // how often fps / frame cost is logged
+#define GUI_STALL_MS 5000                                    // supervisor stall time, well past the idle wait
+
+// uncomment to time full screen redraws at start up. build with OLED_NATIVE_1BPP 0 and 1 to compare.
+// #define GUI_RENDER_BENCHMARK 1
+#define GUI_RENDER_BENCHMARK_ROUNDS 50
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 #include "gui_task.h"
-static void lv_tick_task(void *arg);
+static void lv_tick_update(void);
 static void create_demo_application(void);
-static void display_msg(char *msg);
+static void gui_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p);
+static TickType_t ticks_until(TickType_t now, TickType_t due);
+static void apply_servo_state(void);
+static void render_frame(bool refresh);
+static void log_gui_stats(void);
+#ifdef GUI_RENDER_BENCHMARK
+static void run_render_benchmark(void);
+#endif
 
 /* Creates a semaphore to handle concurrent call to lvgl stuff
  * If you wish to call *any* lvgl function from other threads/tasks
  * you should lock on the very same semaphore! */
 SemaphoreHandle_t xGuiSemaphore;
-QueueHandle_t xDataQueue;
-lv_obj_t * label1;
+static StaticSemaphore_t guiSemaphoreBuffer;
+
+/* lvgl draw buffers, fixed at build time */
+#if OLED_NATIVE_1BPP
+/* oled_flush packs it with 32 bit loads */
+static lv_color_t buf1[OLED_DRAW_BUF_PX] __attribute__((aligned(4)));
+#else
+DMA_ATTR static lv_color_t buf1[DISP_BUF_SIZE];
+#ifndef CONFIG_LV_TFT_DISPLAY_MONOCHROME
+DMA_ATTR static lv_color_t buf2[DISP_BUF_SIZE];
+#endif
+#endif
+
+/* frame counters - written by the gui task, read by anyone via gui_get_stats() */
+static portMUX_TYPE guiStatsLock = portMUX_INITIALIZER_UNLOCKED;
+static GuiStats guiStats;
+static uint32_t lvglNextRunMs;
+static int64_t lastTickUs; // esp_timer time lvgl's tick was last advanced to
 
 void guiTask(void *pvParameter) {
-    xGuiSemaphore = xSemaphoreCreateMutex();
+    xGuiSemaphore = xSemaphoreCreateMutexStatic(&guiSemaphoreBuffer);
 
-    xDataQueue = *((QueueHandle_t *) pvParameter);
+    (void) pvParameter;
 
     lv_init();
 
     ESP_LOGI(TAG, "initialiasing driver.");
     /* Initialize SPI or I2C bus used by the drivers */
     lvgl_driver_init();
+    boot_mark(BOOT_PHASE_I2C_READY);
 
 
-    lv_color_t* buf1 = heap_caps_malloc(DISP_BUF_SIZE * sizeof(lv_color_t), MALLOC_CAP_DMA);
-    assert(buf1 != NULL);
-
+#if OLED_NATIVE_1BPP
+    /* lvgl renders natively at one lv_color_t byte per pixel with its own fill and
+     * blend loops, oled_flush packs the result into pages. no per pixel callback. */
+    uint32_t size_in_px = OLED_DRAW_BUF_PX;
+    lv_color_t *second = NULL;
+#else
     /* Use double buffered when not working with monochrome displays */
 #ifndef CONFIG_LV_TFT_DISPLAY_MONOCHROME
-    lv_color_t* buf2 = heap_caps_malloc(DISP_BUF_SIZE * sizeof(lv_color_t), MALLOC_CAP_DMA);
-    assert(buf2 != NULL);
+    lv_color_t *second = buf2;
 #else
-    static lv_color_t *buf2 = NULL;
+    lv_color_t *second = NULL;
 #endif
 
-    static lv_disp_buf_t disp_buf;
-
     uint32_t size_in_px = DISP_BUF_SIZE;
 
 #if defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_IL3820         \
@@ -89,14 +130,22 @@ void guiTask(void *pvParameter) {
     /* Actual size in pixels, not bytes. */
     size_in_px *= 8;
 #endif
+#endif /* OLED_NATIVE_1BPP */
+
+    static lv_disp_buf_t disp_buf;
 
     /* Initialize the working buffer depending on the selected display.
-     * NOTE: buf2 == NULL when using monochrome displays. */
-    lv_disp_buf_init(&disp_buf, buf1, buf2, size_in_px);
+     * NOTE: no second buffer when using monochrome displays. */
+    lv_disp_buf_init(&disp_buf, buf1, second, size_in_px);
+    app_ram_reserve(APP_RAM_GUI, sizeof(guiSemaphoreBuffer) + sizeof(buf1) + sizeof(disp_buf)
+                    + (second != NULL ? sizeof(buf1) : 0));
+#if OLED_NATIVE_1BPP
+    app_ram_reserve(APP_RAM_GUI, 2 * OLED_FRAME_BYTES); // oled_ssd1306 drawn and shown frames
+#endif
 
     lv_disp_drv_t disp_drv;
     lv_disp_drv_init(&disp_drv);
-    disp_drv.flush_cb = disp_driver_flush;
+    disp_drv.flush_cb = gui_flush_cb;
 
 #if defined CONFIG_DISPLAY_ORIENTATION_PORTRAIT || defined CONFIG_DISPLAY_ORIENTATION_PORTRAIT_INVERTED
     disp_drv.rotated = 1;
@@ -104,10 +153,14 @@ void guiTask(void *pvParameter) {
 
     /* When using a monochrome display we need to register the callbacks:
      * - rounder_cb
-     * - set_px_cb */
+     * - set_px_cb
+     * these are our own so areas stay partial and only changed pages are flushed.
+     * the native 1bpp path needs no set_px_cb at all. */
 #ifdef CONFIG_LV_TFT_DISPLAY_MONOCHROME
-    disp_drv.rounder_cb = disp_driver_rounder;
-    disp_drv.set_px_cb = disp_driver_set_px;
+    disp_drv.rounder_cb = oled_rounder;
+#if !OLED_NATIVE_1BPP
+    disp_drv.set_px_cb = oled_set_px;
+#endif
 #endif
 
     disp_drv.buffer = &disp_buf;
@@ -122,86 +175,241 @@ void guiTask(void *pvParameter) {
     lv_indev_drv_register(&indev_drv);
 #endif
 
-    ESP_LOGI(TAG, "setting up UI timer callback.");
-    /* Create and start a periodic timer interrupt to call lv_tick_inc */
-    const esp_timer_create_args_t periodic_timer_args = {
-        .callback = &lv_tick_task,
-        .name = "periodic_gui"
-    };
-    esp_timer_handle_t periodic_timer;
-    ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, LV_TICK_PERIOD_MS * 1000));
-
+    /* no periodic tick timer - lvgl's clock is advanced on demand by lv_tick_update() */
+    lastTickUs = esp_timer_get_time();
 
     ESP_LOGI(TAG, "creating demo app.");
     /* Create the demo application */
     create_demo_application();
+    boot_mark(BOOT_PHASE_DISPLAY_READY);
+
+    /* the refresh task would otherwise wake us every LV_DISP_DEF_REFR_PERIOD
+     * whether anything changed or not - we refresh explicitly when dirty instead */
+    lv_task_set_prio(lv_disp_get_default()->refr_task, LV_TASK_PRIO_OFF);
+
+#ifdef GUI_RENDER_BENCHMARK
+    run_render_benchmark();
+#endif
+#ifdef GUI_BENCHMARK
+    gui_benchmark_start();
+#endif
 
     ESP_LOGI(TAG, "starting task loop.");
+    int supervisorSlot = supervisor_register(GUI_STALL_MS);
+    TickType_t lvglDue = xTaskGetTickCount();
+    TickType_t lastFrame = lvglDue - GUI_MIN_FRAME_TICKS;
+    bool dirty = true;
     while (1) {
-        /* Delay 1 tick (assumes FreeRTOS tick is 10ms */
-        vTaskDelay(pdMS_TO_TICKS(10));
-
-        BufferDataType rxData;
-        BaseType_t queueResult;
-        
-        /* check if there's a message to display */
-        queueResult = xQueueReceive( 
-                xDataQueue,
-                ( void * ) &rxData,
-                xBlockTime );
-
-        if(pdPASS == queueResult)
-        {
-            ESP_LOGI(TAG, "got data, changing label.");
-            display_msg(rxData.msg);
+        supervisor_feed(supervisorSlot);
+
+        /* a single wait covers both new servo state and the next lvgl deadline.
+         * while dirty, the frame rate cap can shorten the wait. */
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = ticks_until(now, lvglDue);
+        if (dirty) {
+            TickType_t frameWait = ticks_until(now, lastFrame + GUI_MIN_FRAME_TICKS);
+            if (frameWait < wait) {
+                wait = frameWait;
+            }
+        }
+
+        if (wait > 0) {
+            if (ulTaskNotifyTake(pdTRUE, wait) > 0) {
+                dirty = true;
+            }
+            continue;
+        }
+
+        bool refresh = false;
+        now = xTaskGetTickCount();
+        if (dirty && ticks_until(now, lastFrame + GUI_MIN_FRAME_TICKS) == 0) {
+            /* consume any notification that raced in, its state is picked up now */
+            ulTaskNotifyTake(pdTRUE, 0);
+            refresh = true;
+            dirty = false;
+            lastFrame = now;
+        }
+
+        render_frame(refresh);
+
+        if (lvglNextRunMs == LV_NO_TASK_READY || pdMS_TO_TICKS(lvglNextRunMs) > GUI_IDLE_WAIT_TICKS) {
+            lvglDue = now + GUI_IDLE_WAIT_TICKS;
+        } else {
+            lvglDue = now + pdMS_TO_TICKS(lvglNextRunMs);
         }
 
-        /* Try to take the semaphore, call lvgl related function on success */
-        if (pdTRUE == xSemaphoreTake(xGuiSemaphore, portMAX_DELAY)) {
-            lv_task_handler();
-            xSemaphoreGive(xGuiSemaphore);
-       }
+        log_gui_stats();
     }
 
     ESP_LOGI(TAG, "Task has exited - very strange.");
 
     /* A task should NEVER return */
-    free(buf1);
-#ifndef CONFIG_LV_TFT_DISPLAY_MONOCHROME
-    free(buf2);
-#endif
     vTaskDelete(NULL);
 }
 
-static void display_msg(char *msg)
+void gui_get_stats(GuiStats *stats)
+{
+    portENTER_CRITICAL(&guiStatsLock);
+    *stats = guiStats;
+    portEXIT_CRITICAL(&guiStatsLock);
+}
+
+static TickType_t ticks_until(TickType_t now, TickType_t due)
+{
+    int32_t diff = (int32_t)(due - now);
+    return diff > 0 ? (TickType_t)diff : 0;
+}
+
+/*
+ * pull changed servo state from the ipc table into the dashboard.
+ * only widgets whose value changed are invalidated.
+ */
+static void apply_servo_state(void)
+{
+    ServoDisplayState states[kServoChannelCount];
+    int servo_num;
+
+    uint32_t dirty = gui_ipc_take_dirty(states, &servo_num);
+    dashboard_apply(states, dirty, servo_num);
+}
+
+/*
+ * run lvgl once: timers always, and a screen refresh when new state arrived.
+ * the cpu time spent is accounted against the frame.
+ */
+static void render_frame(bool refresh)
 {
-    /*Modify the Label's text*/
-    lv_label_set_text(label1, msg);
+    if (pdTRUE != xSemaphoreTake(xGuiSemaphore, portMAX_DELAY)) {
+        return;
+    }
+
+    TRACE_BEGIN(TRACE_SPAN_GUI_LOCK);
+    int64_t start = esp_timer_get_time();
+    uint32_t framesBefore = guiStats.frames;
+
+    lv_tick_update();
+    if (refresh) {
+        apply_servo_state();
+    }
+    TRACE_BEGIN(TRACE_SPAN_LVGL);
+    lvglNextRunMs = lv_task_handler();
+    /* anything invalidated by state changes or lvgl animations is drawn here */
+    lv_refr_now(NULL);
+    TRACE_END(TRACE_SPAN_LVGL);
+    /* glyph fields changed without any lvgl redraw still need sending */
+    bool fieldsOnly = oled_commit();
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    TRACE_END(TRACE_SPAN_GUI_LOCK);
+    xSemaphoreGive(xGuiSemaphore);
+
+    portENTER_CRITICAL(&guiStatsLock);
+    guiStats.wakeups++;
+    if (fieldsOnly) {
+        guiStats.frames++;
+    }
+    if (guiStats.frames != framesBefore) {
+        guiStats.busy_us += elapsed;
+        if (elapsed > guiStats.max_frame_us) {
+            guiStats.max_frame_us = elapsed;
+        }
+    } else {
+        guiStats.idle_us += elapsed;
+    }
+    portEXIT_CRITICAL(&guiStatsLock);
+}
+
+static void log_gui_stats(void)
+{
+    static int64_t lastLog;
+    static GuiStats lastStats;
+    static OledFlushStats lastFlush;
+
+    int64_t now = esp_timer_get_time();
+    if (now - lastLog < GUI_STATS_PERIOD_US) {
+        return;
+    }
+
+    GuiStats stats;
+    gui_get_stats(&stats);
+
+    uint32_t frames = stats.frames - lastStats.frames;
+    uint32_t busy = (uint32_t)(stats.busy_us - lastStats.busy_us);
+    uint32_t period_ms = (uint32_t)((now - lastLog) / 1000);
+
+    ESP_LOGI(TAG, "%u frames in %ums (%u.%u fps), avg %uus/frame, max %uus, %u wakeups",
+        frames, period_ms,
+        frames * 1000 / period_ms, (frames * 10000 / period_ms) % 10,
+        frames ? busy / frames : 0, stats.max_frame_us,
+        stats.wakeups - lastStats.wakeups);
+
+    /* a 1ms periodic tick would have dispatched once per millisecond of the period */
+    ESP_LOGI(TAG, "lvgl tick: %u on demand updates, a periodic timer would have dispatched %u",
+        stats.tick_updates - lastStats.tick_updates, period_ms);
+
+    /* bus usage - a full frame would be OLED_FRAME_BYTES plus addressing */
+    OledFlushStats flush;
+    oled_get_flush_stats(&flush);
+    uint32_t flushFrames = flush.frames - lastFlush.frames;
+    ESP_LOGI(TAG, "flushed %u bytes in %u windows, avg %u bytes/frame (full frame %u), max %u, i2c errors %u",
+        flush.bytes - lastFlush.bytes, flush.windows - lastFlush.windows,
+        flushFrames ? (flush.bytes - lastFlush.bytes) / flushFrames : 0, OLED_FRAME_BYTES,
+        flush.max_frame_bytes, flush.errors);
+
+    lastStats = stats;
+    lastFlush = flush;
+    lastLog = now;
+}
+
+#ifdef GUI_RENDER_BENCHMARK
+/*
+ * redraw the whole screen repeatedly and report the average render cost.
+ * the content does not change, so after the first round nothing goes over I2C
+ * and the time is lvgl drawing plus packing and comparing pages.
+ */
+static void run_render_benchmark(void)
+{
+    lv_refr_now(NULL);
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < GUI_RENDER_BENCHMARK_ROUNDS; i++) {
+        lv_tick_update();
+        lv_obj_invalidate(lv_scr_act());
+        lv_refr_now(NULL);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "render benchmark (%s): %d full redraws, avg %uus",
+        OLED_NATIVE_1BPP ? "native 1bpp" : "set_px",
+        GUI_RENDER_BENCHMARK_ROUNDS, (uint32_t)(elapsed / GUI_RENDER_BENCHMARK_ROUNDS));
+}
+#endif
+
+/*
+ * counts flushes so a frame is only recorded when pixels actually went to the panel.
+ */
+static void gui_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p)
+{
+    if (lv_disp_flush_is_last(drv)) {
+        portENTER_CRITICAL(&guiStatsLock);
+        guiStats.frames++;
+        portEXIT_CRITICAL(&guiStatsLock);
+    }
+    oled_flush(drv, area, color_p);
 }
 
 static void create_demo_application(void)
 {
-    /* When using a monochrome display we only show "Hello World" centered on the
-     * screen */
+    /* When using a monochrome display we show the servo dashboard */
 #if defined CONFIG_LV_TFT_DISPLAY_MONOCHROME || \
     defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_ST7735S
 
-    ESP_LOGI(TAG, "Monochrome screen - doign simple message.");
-    /* use a pretty small demo for monochrome displays */
+    ESP_LOGI(TAG, "Monochrome screen - doing servo dashboard.");
     /* Get the current screen  */
     lv_obj_t * scr = lv_disp_get_scr_act(NULL);
 
-    /*Create a Label on the currently active screen*/
-    label1 =  lv_label_create(scr, NULL);
-
-    display_msg("Hello\nROS");
-
-    /* Align the Label to the center
-     * NULL means align on parent (which is the screen now)
-     * 0, 0 at the end means an x, y offset after alignment*/
-    lv_obj_align(label1, NULL, LV_ALIGN_CENTER, 0, 0);
-    ESP_LOGI(TAG, "Finished simple message.");
+    dashboard_create(scr);
+    ESP_LOGI(TAG, "Finished dashboard.");
 #else
     /* Otherwise we show the selected demo */
 
@@ -220,8 +428,23 @@ static void create_demo_application(void)
 #endif
 }
 
-static void lv_tick_task(void *arg) {
-    (void) arg;
+/*
+ * advance lvgl's clock by the time elapsed since the last call.
+ * lvgl only reads its tick while this task is running it, so bringing it up to
+ * date before each use replaces the 1 kHz esp_timer callback entirely.
+ */
+static void lv_tick_update(void)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t elapsed_ms = (uint32_t)((now - lastTickUs) / 1000);
 
-    lv_tick_inc(LV_TICK_PERIOD_MS);
+    if (elapsed_ms > 0) {
+        lv_tick_inc(elapsed_ms);
+        /* only consume whole milliseconds so the remainder is not lost */
+        lastTickUs += (int64_t) elapsed_ms * 1000;
+
+        portENTER_CRITICAL(&guiStatsLock);
+        guiStats.tick_updates++;
+        portEXIT_CRITICAL(&guiStatsLock);
+    }
 }
@@ -1,8 +1,32 @@
 /*
  * gui task - defines public interface for gui task to be started
  */
+#pragma once
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
  // how much memory for the guiTask stack. 
 #define kGuiStackSize (4096*2)
 
+/*
+ * frame accounting for the gui loop, see gui_get_stats()
+ */
+typedef struct GuiStats {
+    uint32_t frames;       // refreshes that flushed pixels to the panel
+    uint32_t wakeups;      // times the loop ran lvgl
+    uint64_t busy_us;      // cpu time spent producing frames
+    uint64_t idle_us;      // cpu time spent in lvgl when nothing was redrawn
+    uint32_t max_frame_us; // worst single frame
+    uint32_t tick_updates; // times lvgl's tick was advanced on demand
+} GuiStats;
+
+/* held around every lvgl call - take it before touching lvgl from another task */
+extern SemaphoreHandle_t xGuiSemaphore;
+
 void guiTask(void *pvParameter);
+
+/*
+ * @brief copy out the gui frame counters. safe to call from any task.
+ */
+void gui_get_stats(GuiStats *stats);
@@ -0,0 +1,123 @@
+/*
+ * host fake - esp_timer, esp_system, heap caps and logging.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef FAKE_RTOS_THREADS
+/* the tasks are threads (fake_rtos_threads.c), so time is the host's, from start up */
+static int64_t startUs;
+
+static int64_t monotonic_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+__attribute__((constructor)) static void start_clock(void)
+{
+    startUs = monotonic_us();
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return monotonic_us() - startUs;
+}
+
+/* a busy wait on the board, a sleep here */
+void fake_time_advance_us(int64_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+
+    nanosleep(&ts, NULL);
+}
+#else
+static int64_t nowUs;
+
+int64_t esp_timer_get_time(void)
+{
+    return nowUs;
+}
+
+void fake_time_advance_us(int64_t us)
+{
+    nowUs += us;
+}
+#endif
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+void host_log(char level, const char *tag, const char *fmt, ...)
+{
+    static int verbose = -1;
+    va_list args;
+
+    if (verbose < 0) {
+        verbose = getenv("HOST_TEST_VERBOSE") != NULL;
+    }
+    if (!verbose) {
+        return;
+    }
+    fprintf(stderr, "%c (%s) ", level, tag);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 200 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 180 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void) caps;
+    return 100 * 1024;
+}
+
+uint32_t esp_random(void)
+{
+    return (uint32_t) rand();
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "esp_restart called\n");
+    abort();
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * host fake - FreeRTOS tasks, notifications and mutexes for a single threaded test.
+ */
+#include <stddef.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define FAKE_TASKS 16
+#define TICK_US (1000000 / configTICK_RATE_HZ)
+
+typedef struct Notified {
+    TaskHandle_t task;
+    uint32_t value;
+} Notified;
+
+static Notified notified[FAKE_TASKS];
+static int dynamicTasks;
+static StaticTask_t dynamicTcbs[FAKE_TASKS];
+
+static Notified *find(TaskHandle_t task)
+{
+    for (int i = 0; i < FAKE_TASKS; i++) {
+        if (notified[i].task == task) {
+            return &notified[i];
+        }
+    }
+    for (int i = 0; i < FAKE_TASKS; i++) {
+        if (notified[i].task == NULL) {
+            notified[i].task = task;
+            return &notified[i];
+        }
+    }
+    return NULL;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t code, const char *name, uint32_t stack_depth, void *arg,
+                               UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb)
+{
+    (void) code;
+    (void) name;
+    (void) stack_depth;
+    (void) arg;
+    (void) priority;
+    (void) stack;
+    return tcb;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t code, const char *name, uint32_t stack_depth,
+                                           void *arg, UBaseType_t priority, StackType_t *stack,
+                                           StaticTask_t *tcb, BaseType_t core)
+{
+    (void) core;
+    return xTaskCreateStatic(code, name, stack_depth, arg, priority, stack, tcb);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created)
+{
+    if (dynamicTasks == FAKE_TASKS) {
+        return pdFAIL;
+    }
+    TaskHandle_t task = xTaskCreateStatic(code, name, stack_depth, arg, priority, NULL,
+                                          &dynamicTcbs[dynamicTasks++]);
+    if (created != NULL) {
+        *created = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void) task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    fake_time_advance_us((int64_t) ticks * TICK_US);
+}
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    *previous += increment;
+    if ((int32_t)(*previous - now) > 0) {
+        vTaskDelay(*previous - now);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / TICK_US);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    static StaticTask_t testTask;
+    return &testTask;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    Notified *n = find(task);
+
+    if (n == NULL) {
+        return pdFAIL;
+    }
+    switch (action) {
+    case eSetBits:
+        n->value |= value;
+        break;
+    case eIncrement:
+        n->value++;
+        break;
+    case eSetValueWithOverwrite:
+    case eSetValueWithoutOverwrite:
+        n->value = value;
+        break;
+    default:
+        break;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait)
+{
+    Notified *n = find(xTaskGetCurrentTaskHandle());
+
+    n->value &= ~clear_on_entry;
+    if (n->value == 0) {
+        /* nothing else can run to notify, so the whole wait passes */
+        if (wait != portMAX_DELAY) {
+            vTaskDelay(wait);
+        }
+        if (value != NULL) {
+            *value = 0;
+        }
+        return pdFALSE;
+    }
+    if (value != NULL) {
+        *value = n->value;
+    }
+    n->value &= ~clear_on_exit;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait)
+{
+    Notified *n = find(xTaskGetCurrentTaskHandle());
+    uint32_t value = n->value;
+
+    if (value == 0) {
+        if (wait != portMAX_DELAY) {
+            vTaskDelay(wait);
+        }
+        return 0;
+    }
+    n->value = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+uint32_t fake_task_notified(TaskHandle_t task)
+{
+    Notified *n = find(task);
+    return n != NULL ? n->value : 0;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    return buffer;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    static StaticSemaphore_t buffers[FAKE_TASKS];
+    static int used;
+    return used < FAKE_TASKS ? &buffers[used++] : NULL;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    (void) sem;
+    (void) wait;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    (void) sem;
+    return pdTRUE;
+}
@@ -0,0 +1,74 @@
+/*
+ * host fake - gpio levels and a slave that holds a line low for a number of clocks.
+ */
+#include "driver/gpio.h"
+#include "esp32/rom/ets_sys.h"
+#include "esp_timer.h"
+
+#define PINS 40
+
+static uint32_t level[PINS];
+static int falling[PINS];
+static gpio_num_t heldPin = -1;
+static gpio_num_t heldClock = -1;
+static int heldClocks;
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void) mode;
+    return gpio_num >= 0 && gpio_num < PINS ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    if (gpio_num < 0 || gpio_num >= PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (pull == GPIO_PULLUP_ONLY) {
+        level[gpio_num] = 1; // an idle bus line
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t value)
+{
+    if (gpio_num < 0 || gpio_num >= PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (level[gpio_num] && !value) {
+        falling[gpio_num]++;
+        if (gpio_num == heldClock && heldClocks > 0) {
+            heldClocks--;
+        }
+    }
+    level[gpio_num] = value != 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num == heldPin && heldClocks > 0) {
+        return 0;
+    }
+    return gpio_num >= 0 && gpio_num < PINS ? (int) level[gpio_num] : 0;
+}
+
+void fake_gpio_hold_low(gpio_num_t pin, gpio_num_t clock, int clocks)
+{
+    heldPin = pin;
+    heldClock = clock;
+    heldClocks = clocks;
+    for (int i = 0; i < PINS; i++) {
+        falling[i] = 0;
+    }
+}
+
+int fake_gpio_falling_edges(gpio_num_t pin)
+{
+    return pin >= 0 && pin < PINS ? falling[pin] : 0;
+}
+
+void ets_delay_us(uint32_t us)
+{
+    fake_time_advance_us(us);
+}
@@ -0,0 +1,211 @@
+/*
+ * host fake - I2C master command links, recorded instead of sent.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "fake_i2c.h"
+
+typedef struct Link {
+    uint8_t bytes[FAKE_I2C_MAX_BYTES];
+    size_t len;
+} Link;
+
+/* transactions are serialised as the driver's command mutex does, for the threaded app build */
+static pthread_mutex_t busLock = PTHREAD_MUTEX_INITIALIZER;
+static FakeI2cTransaction log_[FAKE_I2C_LOG];
+static int count;
+static int failCount;
+static esp_err_t failWith;
+static FakeI2cDriver driver;
+
+static void put(i2c_cmd_handle_t cmd, uint8_t byte)
+{
+    Link *link = cmd;
+
+    if (link->len < FAKE_I2C_MAX_BYTES) {
+        link->bytes[link->len] = byte;
+    }
+    link->len++;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    return calloc(1, sizeof(Link));
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd)
+{
+    free(cmd);
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd)
+{
+    (void) cmd;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd)
+{
+    (void) cmd;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en)
+{
+    (void) ack_en;
+    put(cmd, data);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t *data, size_t len, bool ack_en)
+{
+    (void) ack_en;
+    for (size_t i = 0; i < len; i++) {
+        put(cmd, data[i]);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t *data, i2c_ack_type_t ack)
+{
+    (void) cmd;
+    (void) ack;
+    *data = 0;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, i2c_ack_type_t ack)
+{
+    (void) cmd;
+    (void) ack;
+    memset(data, 0, len);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks_to_wait)
+{
+    const Link *link = cmd;
+
+    (void) port;
+    pthread_mutex_lock(&busLock);
+    FakeI2cTransaction *t = &log_[count % FAKE_I2C_LOG];
+    memcpy(t->bytes, link->bytes, sizeof(t->bytes));
+    t->len = link->len;
+    t->ticks = ticks_to_wait;
+    t->result = ESP_OK;
+    if (failCount > 0) {
+        failCount--;
+        t->result = failWith;
+    }
+    count++;
+    esp_err_t result = t->result;
+    pthread_mutex_unlock(&busLock);
+    return result;
+}
+
+void fake_i2c_reset(void)
+{
+    pthread_mutex_lock(&busLock);
+    count = 0;
+    failCount = 0;
+    pthread_mutex_unlock(&busLock);
+}
+
+void fake_i2c_fail_next(int n, esp_err_t err)
+{
+    pthread_mutex_lock(&busLock);
+    failCount = n;
+    failWith = err;
+    pthread_mutex_unlock(&busLock);
+}
+
+int fake_i2c_count(void)
+{
+    pthread_mutex_lock(&busLock);
+    int n = count;
+    pthread_mutex_unlock(&busLock);
+    return n;
+}
+
+const FakeI2cTransaction *fake_i2c_get(int index)
+{
+    if (index < 0 || index >= count || index < count - FAKE_I2C_LOG) {
+        return NULL;
+    }
+    return &log_[index % FAKE_I2C_LOG];
+}
+
+FakeI2cDriver *fake_i2c_driver(void)
+{
+    return &driver;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *conf)
+{
+    (void) port;
+    if (conf->mode != I2C_MODE_MASTER || conf->master.clk_speed == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    driver.clk_speed = conf->master.clk_speed;
+    driver.high = driver.low = 80000000 / conf->master.clk_speed / 2;
+    driver.start_setup = driver.start_hold = driver.high;
+    driver.stop_setup = driver.stop_hold = driver.high;
+    driver.sample = driver.hold = driver.high / 2;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags)
+{
+    (void) port;
+    (void) mode;
+    (void) slv_rx_buf_len;
+    (void) slv_tx_buf_len;
+    (void) intr_alloc_flags;
+    if (driver.installed) {
+        return ESP_FAIL;
+    }
+    driver.installed = true;
+    driver.installs++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t port)
+{
+    (void) port;
+    if (!driver.installed) {
+        return ESP_FAIL;
+    }
+    driver.installed = false;
+    return ESP_OK;
+}
+
+#define TIMING_PAIR(name, a, b) \
+    esp_err_t i2c_set_##name(i2c_port_t port, int first, int second) \
+    { \
+        (void) port; \
+        if (!driver.installed) { \
+            return ESP_ERR_INVALID_STATE; \
+        } \
+        driver.a = first; \
+        driver.b = second; \
+        return ESP_OK; \
+    } \
+    esp_err_t i2c_get_##name(i2c_port_t port, int *first, int *second) \
+    { \
+        (void) port; \
+        if (!driver.installed) { \
+            return ESP_ERR_INVALID_STATE; \
+        } \
+        *first = driver.a; \
+        *second = driver.b; \
+        return ESP_OK; \
+    }
+
+TIMING_PAIR(period, high, low)
+TIMING_PAIR(start_timing, start_setup, start_hold)
+TIMING_PAIR(stop_timing, stop_setup, stop_hold)
+TIMING_PAIR(data_timing, sample, hold)
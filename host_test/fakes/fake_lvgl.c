@@ -0,0 +1,675 @@
+/*
+ * host fake - lvgl 7 for a 1 bit display, see lvgl.h.
+ *
+ * invalidation and refresh follow lvgl: invalid areas are clipped to the screen, put
+ * through the driver's rounder, dropped when inside one already kept, joined when the
+ * join is smaller than the pair, and each is drawn into the draw buffer and handed to
+ * flush_cb, the last of the refresh flagged by lv_disp_flush_is_last.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "lvgl.h"
+
+#define FAKE_LV_OBJS 48
+#define FAKE_LV_TASKS 8
+#define FAKE_LV_TEXT 32
+
+#define FONT_FIRST 0x20
+#define FONT_LAST 0x7e
+#define FONT_W 5
+#define FONT_H 7
+
+typedef enum ObjType {
+    OBJ_SCREEN,
+    OBJ_LABEL,
+    OBJ_BAR,
+} ObjType;
+
+struct _lv_obj_t {
+    ObjType type;
+    lv_obj_t *parent;
+    lv_area_t coords;
+    /* label */
+    char text[FAKE_LV_TEXT];
+    lv_label_long_mode_t long_mode;
+    /* bar */
+    int16_t min;
+    int16_t max;
+    int16_t value;
+};
+
+struct _lv_task_t {
+    lv_task_cb_t cb;
+    uint32_t period;
+    uint32_t last_run;
+    lv_task_prio_t prio;
+    void *user_data;
+};
+
+/***************************
+ * globals
+ ***************************/
+static lv_obj_t objs[FAKE_LV_OBJS];
+static int objCount;
+static lv_task_t tasks[FAKE_LV_TASKS];
+static int taskCount;
+static uint32_t tick;
+
+static lv_disp_t disp;
+static bool registered;
+static lv_area_t invAreas[LV_INV_BUF_SIZE];
+static bool invJoined[LV_INV_BUF_SIZE];
+static int invCount;
+static bool flushingLast = true;   // outside a refresh every flush is the last
+static FakeLvRefresh lastRefresh;
+
+/* the area being drawn, one lv_color_t per pixel */
+static lv_color_t canvas[LV_VER_RES_MAX * LV_HOR_RES_MAX];
+static lv_area_t canvasArea;
+
+/* a 5x7 font, columns lsb at the top */
+static const uint8_t font5x7[FONT_LAST - FONT_FIRST + 1][FONT_W] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5f, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7f, 0x14, 0x7f, 0x14}, {0x24, 0x2a, 0x7f, 0x2a, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1c, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1c, 0x00}, {0x14, 0x08, 0x3e, 0x08, 0x14}, {0x08, 0x08, 0x3e, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3e, 0x51, 0x49, 0x45, 0x3e}, {0x00, 0x42, 0x7f, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4b, 0x31}, {0x18, 0x14, 0x12, 0x7f, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3c, 0x4a, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1e}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3e},
+    {0x7e, 0x11, 0x11, 0x11, 0x7e}, {0x7f, 0x49, 0x49, 0x49, 0x36}, {0x3e, 0x41, 0x41, 0x41, 0x22},
+    {0x7f, 0x41, 0x41, 0x22, 0x1c}, {0x7f, 0x49, 0x49, 0x49, 0x41}, {0x7f, 0x09, 0x09, 0x09, 0x01},
+    {0x3e, 0x41, 0x49, 0x49, 0x7a}, {0x7f, 0x08, 0x08, 0x08, 0x7f}, {0x00, 0x41, 0x7f, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3f, 0x01}, {0x7f, 0x08, 0x14, 0x22, 0x41}, {0x7f, 0x40, 0x40, 0x40, 0x40},
+    {0x7f, 0x02, 0x0c, 0x02, 0x7f}, {0x7f, 0x04, 0x08, 0x10, 0x7f}, {0x3e, 0x41, 0x41, 0x41, 0x3e},
+    {0x7f, 0x09, 0x09, 0x09, 0x06}, {0x3e, 0x41, 0x51, 0x21, 0x5e}, {0x7f, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7f, 0x01, 0x01}, {0x3f, 0x40, 0x40, 0x40, 0x3f},
+    {0x1f, 0x20, 0x40, 0x20, 0x1f}, {0x3f, 0x40, 0x38, 0x40, 0x3f}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7f, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7f, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7f, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7f},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7e, 0x09, 0x01, 0x02}, {0x0c, 0x52, 0x52, 0x52, 0x3e},
+    {0x7f, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7d, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3d, 0x00},
+    {0x7f, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7f, 0x40, 0x00}, {0x7c, 0x04, 0x18, 0x04, 0x78},
+    {0x7c, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7c, 0x14, 0x14, 0x14, 0x08},
+    {0x08, 0x14, 0x14, 0x18, 0x7c}, {0x7c, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3f, 0x44, 0x40, 0x20}, {0x3c, 0x40, 0x40, 0x20, 0x7c}, {0x1c, 0x20, 0x40, 0x20, 0x1c},
+    {0x3c, 0x40, 0x30, 0x40, 0x3c}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0c, 0x50, 0x50, 0x50, 0x3c},
+    {0x44, 0x64, 0x54, 0x4c, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7f, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x10, 0x08, 0x08, 0x10, 0x08},
+};
+
+/* the same glyphs as lvgl bitmaps: rows of 1 bit pixels, msb first, not padded */
+static uint8_t fontBitmaps[FONT_LAST - FONT_FIRST + 1][(FONT_W * FONT_H + 7) / 8];
+
+static bool font_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t next);
+static const uint8_t *font_bitmap(const lv_font_t *font, uint32_t letter);
+
+static const lv_font_t font = {
+    .get_glyph_dsc = font_dsc,
+    .get_glyph_bitmap = font_bitmap,
+    .line_height = 9,
+    .base_line = 1,
+};
+
+static bool font_dsc(const lv_font_t *f, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t next)
+{
+    (void) f;
+    (void) next;
+
+    if (letter < FONT_FIRST || letter > FONT_LAST) {
+        return false;
+    }
+    dsc->adv_w = FONT_W + 1;
+    dsc->box_w = letter == ' ' ? 0 : FONT_W;
+    dsc->box_h = letter == ' ' ? 0 : FONT_H;
+    dsc->ofs_x = 0;
+    dsc->ofs_y = 0;
+    dsc->bpp = 1;
+    return true;
+}
+
+static const uint8_t *font_bitmap(const lv_font_t *f, uint32_t letter)
+{
+    (void) f;
+    return letter >= FONT_FIRST && letter <= FONT_LAST ? fontBitmaps[letter - FONT_FIRST] : NULL;
+}
+
+static void font_init(void)
+{
+    memset(fontBitmaps, 0, sizeof(fontBitmaps));
+    for (int g = 0; g <= FONT_LAST - FONT_FIRST; g++) {
+        for (int y = 0; y < FONT_H; y++) {
+            for (int x = 0; x < FONT_W; x++) {
+                int bit = y * FONT_W + x;
+                if (font5x7[g][x] & (1U << y)) {
+                    fontBitmaps[g][bit >> 3] |= 0x80 >> (bit & 0x7);
+                }
+            }
+        }
+    }
+}
+
+bool lv_font_get_glyph_dsc(const lv_font_t *f, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t next)
+{
+    return f->get_glyph_dsc(f, dsc, letter, next);
+}
+
+const uint8_t *lv_font_get_glyph_bitmap(const lv_font_t *f, uint32_t letter)
+{
+    return f->get_glyph_bitmap(f, letter);
+}
+
+/*
+ * areas
+ */
+static bool area_intersect(lv_area_t *out, const lv_area_t *a, const lv_area_t *b)
+{
+    out->x1 = a->x1 > b->x1 ? a->x1 : b->x1;
+    out->y1 = a->y1 > b->y1 ? a->y1 : b->y1;
+    out->x2 = a->x2 < b->x2 ? a->x2 : b->x2;
+    out->y2 = a->y2 < b->y2 ? a->y2 : b->y2;
+    return out->x1 <= out->x2 && out->y1 <= out->y2;
+}
+
+static bool area_is_in(const lv_area_t *in, const lv_area_t *holder)
+{
+    return in->x1 >= holder->x1 && in->y1 >= holder->y1 && in->x2 <= holder->x2 && in->y2 <= holder->y2;
+}
+
+/* overlapping or touching */
+static bool area_is_on(const lv_area_t *a, const lv_area_t *b)
+{
+    return !(a->x1 > b->x2 + 1 || b->x1 > a->x2 + 1 || a->y1 > b->y2 + 1 || b->y1 > a->y2 + 1);
+}
+
+static uint32_t area_size(const lv_area_t *a)
+{
+    return (uint32_t) lv_area_get_width(a) * lv_area_get_height(a);
+}
+
+static void area_join(lv_area_t *out, const lv_area_t *a, const lv_area_t *b)
+{
+    out->x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+    out->y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+    out->x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+    out->y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+}
+
+static lv_area_t screen_area(void)
+{
+    lv_area_t a = { 0, 0, disp.driver.hor_res - 1, disp.driver.ver_res - 1 };
+    return a;
+}
+
+static void inv_area(const lv_area_t *area)
+{
+    lv_area_t screen = screen_area();
+    lv_area_t com;
+
+    if (!registered || !area_intersect(&com, area, &screen)) {
+        return;
+    }
+    if (disp.driver.rounder_cb != NULL) {
+        disp.driver.rounder_cb(&disp.driver, &com);
+    }
+    for (int i = 0; i < invCount; i++) {
+        if (area_is_in(&com, &invAreas[i])) {
+            return;
+        }
+    }
+    if (invCount < LV_INV_BUF_SIZE) {
+        invAreas[invCount++] = com;
+    } else {
+        invCount = 1;
+        invAreas[0] = screen;
+    }
+}
+
+/*
+ * drawing into the canvas
+ */
+static void set_px(int x, int y, lv_color_t color, const lv_area_t *clip)
+{
+    if (x < clip->x1 || x > clip->x2 || y < clip->y1 || y > clip->y2) {
+        return;
+    }
+    canvas[(y - canvasArea.y1) * lv_area_get_width(&canvasArea) + (x - canvasArea.x1)] = color;
+}
+
+static void fill(int x1, int y1, int x2, int y2, const lv_area_t *clip)
+{
+    for (int y = y1; y <= y2; y++) {
+        for (int x = x1; x <= x2; x++) {
+            set_px(x, y, LV_COLOR_BLACK, clip);
+        }
+    }
+}
+
+static int text_width(const char *text)
+{
+    lv_font_glyph_dsc_t dsc;
+    int w = 0;
+
+    for (const char *c = text; *c != '\0'; c++) {
+        if (lv_font_get_glyph_dsc(&font, &dsc, (uint8_t) *c, 0)) {
+            w += dsc.adv_w;
+        }
+    }
+    return w;
+}
+
+static void draw_label(const lv_obj_t *obj, const lv_area_t *clip)
+{
+    lv_font_glyph_dsc_t dsc;
+    int x = obj->coords.x1;
+
+    for (const char *c = obj->text; *c != '\0'; c++) {
+        uint32_t letter = (uint8_t) *c;
+        if (!lv_font_get_glyph_dsc(&font, &dsc, letter, 0)) {
+            continue;
+        }
+        const uint8_t *bmp = lv_font_get_glyph_bitmap(&font, letter);
+        int top = obj->coords.y1 + (font.line_height - font.base_line) - dsc.box_h - dsc.ofs_y;
+
+        for (int gy = 0; gy < dsc.box_h; gy++) {
+            for (int gx = 0; gx < dsc.box_w; gx++) {
+                int bit = gy * dsc.box_w + gx;
+                if (bmp[bit >> 3] & (0x80 >> (bit & 0x7))) {
+                    set_px(x + dsc.ofs_x + gx, top + gy, LV_COLOR_BLACK, clip);
+                }
+            }
+        }
+        x += dsc.adv_w;
+    }
+}
+
+/* an outline, and the indicator inset by one pixel of space, filled from the bottom or the left */
+static void draw_bar(const lv_obj_t *obj, const lv_area_t *clip)
+{
+    const lv_area_t *c = &obj->coords;
+    int w = lv_area_get_width(c);
+    int h = lv_area_get_height(c);
+    int range = obj->max - obj->min;
+
+    fill(c->x1, c->y1, c->x2, c->y1, clip);
+    fill(c->x1, c->y2, c->x2, c->y2, clip);
+    fill(c->x1, c->y1, c->x1, c->y2, clip);
+    fill(c->x2, c->y1, c->x2, c->y2, clip);
+    if (range <= 0 || obj->value <= obj->min) {
+        return;
+    }
+    if (h >= w) {
+        int len = (obj->value - obj->min) * (h - 4) / range;
+        fill(c->x1 + 2, c->y2 - 1 - len, c->x2 - 2, c->y2 - 2, clip);
+    } else {
+        int len = (obj->value - obj->min) * (w - 4) / range;
+        fill(c->x1 + 2, c->y1 + 2, c->x1 + 1 + len, c->y2 - 2, clip);
+    }
+}
+
+static void draw_area(const lv_area_t *area)
+{
+    canvasArea = *area;
+    for (int i = 0; i < area_size(area); i++) {
+        canvas[i] = LV_COLOR_WHITE;
+    }
+    for (int i = 0; i < objCount; i++) {
+        const lv_obj_t *obj = &objs[i];
+        lv_area_t clip;
+
+        if (obj->parent != disp.act_scr || !area_intersect(&clip, &obj->coords, area)) {
+            continue;
+        }
+        if (obj->type == OBJ_LABEL) {
+            draw_label(obj, &clip);
+        } else if (obj->type == OBJ_BAR) {
+            draw_bar(obj, &clip);
+        }
+    }
+}
+
+/* hand the canvas to the driver, natively or through set_px_cb */
+static void flush_area(const lv_area_t *area, bool last)
+{
+    lv_disp_drv_t *drv = &disp.driver;
+    lv_color_t *buf = drv->buffer->buf1;
+    int w = lv_area_get_width(area);
+
+    if (drv->set_px_cb != NULL) {
+        memset(buf, 0, drv->buffer->size);
+        for (int y = area->y1; y <= area->y2; y++) {
+            for (int x = area->x1; x <= area->x2; x++) {
+                drv->set_px_cb(drv, (uint8_t *) buf, w, x - area->x1, y - area->y1,
+                               canvas[(y - area->y1) * w + (x - area->x1)], LV_OPA_COVER);
+            }
+        }
+    } else {
+        memcpy(buf, canvas, area_size(area) * sizeof(lv_color_t));
+    }
+    flushingLast = last;
+    lastRefresh.flushes++;
+    lastRefresh.pixels += area_size(area);
+    drv->flush_cb(drv, area, buf);
+    flushingLast = true;
+}
+
+/* an area larger than the draw buffer goes in bands of whole rows, like lvgl */
+static void refresh_area(const lv_area_t *area, bool last)
+{
+    int w = lv_area_get_width(area);
+    int rows = disp.driver.buffer->size / w;
+    lv_area_t band = *area;
+
+    if (rows > lv_area_get_height(area)) {
+        rows = lv_area_get_height(area);
+    }
+    while (band.y1 <= area->y2) {
+        band.y2 = band.y1 + rows - 1;
+        if (band.y2 > area->y2) {
+            band.y2 = area->y2;
+        }
+        if (disp.driver.rounder_cb != NULL) {
+            disp.driver.rounder_cb(&disp.driver, &band);
+        }
+        draw_area(&band);
+        flush_area(&band, last && band.y2 >= area->y2);
+        band.y1 = band.y2 + 1;
+    }
+}
+
+void lv_refr_now(lv_disp_t *d)
+{
+    int lastArea = -1;
+
+    (void) d;
+    memset(&lastRefresh, 0, sizeof(lastRefresh));
+    if (!registered || invCount == 0) {
+        return;
+    }
+
+    memset(invJoined, 0, sizeof(invJoined));
+    for (int in = 0; in < invCount; in++) {
+        if (invJoined[in]) {
+            continue;
+        }
+        for (int from = 0; from < invCount; from++) {
+            lv_area_t joined;
+
+            if (invJoined[from] || from == in || !area_is_on(&invAreas[in], &invAreas[from])) {
+                continue;
+            }
+            area_join(&joined, &invAreas[in], &invAreas[from]);
+            if (area_size(&joined) < area_size(&invAreas[in]) + area_size(&invAreas[from])) {
+                invAreas[in] = joined;
+                invJoined[from] = true;
+            }
+        }
+    }
+    for (int i = 0; i < invCount; i++) {
+        if (!invJoined[i]) {
+            lastArea = i;
+        }
+    }
+    for (int i = 0; i <= lastArea; i++) {
+        if (!invJoined[i]) {
+            lastRefresh.areas++;
+            refresh_area(&invAreas[i], i == lastArea);
+        }
+    }
+    invCount = 0;
+}
+
+void fake_lv_last_refresh(FakeLvRefresh *out)
+{
+    *out = lastRefresh;
+}
+
+bool lv_disp_flush_is_last(lv_disp_drv_t *disp_drv)
+{
+    (void) disp_drv;
+    return flushingLast;
+}
+
+void lv_disp_flush_ready(lv_disp_drv_t *disp_drv)
+{
+    (void) disp_drv;
+}
+
+/*
+ * display and objects
+ */
+static void refr_task(lv_task_t *task)
+{
+    lv_refr_now(task->user_data);
+}
+
+static lv_obj_t *obj_create(ObjType type, lv_obj_t *parent)
+{
+    if (objCount == FAKE_LV_OBJS) {
+        fprintf(stderr, "fake lvgl: out of objects\n");
+        return NULL;
+    }
+    lv_obj_t *obj = &objs[objCount++];
+    memset(obj, 0, sizeof(*obj));
+    obj->type = type;
+    obj->parent = parent;
+    return obj;
+}
+
+void lv_init(void)
+{
+    memset(objs, 0, sizeof(objs));
+    objCount = 0;
+    memset(tasks, 0, sizeof(tasks));
+    taskCount = 0;
+    memset(&disp, 0, sizeof(disp));
+    registered = false;
+    invCount = 0;
+    tick = 0;
+    font_init();
+}
+
+void lv_disp_buf_init(lv_disp_buf_t *disp_buf, void *buf1, void *buf2, uint32_t size_in_px_cnt)
+{
+    disp_buf->buf1 = buf1;
+    disp_buf->buf2 = buf2;
+    disp_buf->size = size_in_px_cnt;
+}
+
+void lv_disp_drv_init(lv_disp_drv_t *driver)
+{
+    memset(driver, 0, sizeof(*driver));
+    driver->hor_res = LV_HOR_RES_MAX;
+    driver->ver_res = LV_VER_RES_MAX;
+}
+
+lv_disp_t *lv_disp_drv_register(lv_disp_drv_t *driver)
+{
+    disp.driver = *driver;
+    registered = true;
+    disp.act_scr = obj_create(OBJ_SCREEN, NULL);
+    disp.act_scr->coords = screen_area();
+    disp.refr_task = lv_task_create(refr_task, LV_DISP_DEF_REFR_PERIOD, LV_TASK_PRIO_MID, &disp);
+    inv_area(&disp.act_scr->coords);
+    return &disp;
+}
+
+lv_disp_t *lv_disp_get_default(void)
+{
+    return registered ? &disp : NULL;
+}
+
+lv_obj_t *lv_disp_get_scr_act(lv_disp_t *d)
+{
+    (void) d;
+    return disp.act_scr;
+}
+
+lv_obj_t *lv_scr_act(void)
+{
+    return disp.act_scr;
+}
+
+void lv_obj_invalidate(const lv_obj_t *obj)
+{
+    inv_area(&obj->coords);
+}
+
+void lv_obj_set_pos(lv_obj_t *obj, lv_coord_t x, lv_coord_t y)
+{
+    lv_coord_t w = lv_area_get_width(&obj->coords);
+    lv_coord_t h = lv_area_get_height(&obj->coords);
+
+    lv_obj_invalidate(obj);
+    obj->coords.x1 = x;
+    obj->coords.y1 = y;
+    obj->coords.x2 = x + w - 1;
+    obj->coords.y2 = y + h - 1;
+    lv_obj_invalidate(obj);
+}
+
+void lv_obj_set_size(lv_obj_t *obj, lv_coord_t w, lv_coord_t h)
+{
+    lv_obj_invalidate(obj);
+    obj->coords.x2 = obj->coords.x1 + w - 1;
+    obj->coords.y2 = obj->coords.y1 + h - 1;
+    lv_obj_invalidate(obj);
+}
+
+const lv_font_t *lv_obj_get_style_text_font(const lv_obj_t *obj, uint8_t part)
+{
+    (void) obj;
+    (void) part;
+    return &font;
+}
+
+lv_obj_t *lv_label_create(lv_obj_t *par, const lv_obj_t *copy)
+{
+    (void) copy;
+    lv_obj_t *label = obj_create(OBJ_LABEL, par);
+    if (label != NULL) {
+        label->long_mode = LV_LABEL_LONG_EXPAND;
+        lv_label_set_text(label, "Text");
+    }
+    return label;
+}
+
+void lv_label_set_text(lv_obj_t *label, const char *text)
+{
+    lv_obj_invalidate(label);
+    snprintf(label->text, sizeof(label->text), "%s", text);
+    if (label->long_mode == LV_LABEL_LONG_EXPAND) {
+        lv_obj_set_size(label, text_width(label->text), font.line_height);
+    }
+    lv_obj_invalidate(label);
+}
+
+void lv_label_set_long_mode(lv_obj_t *label, lv_label_long_mode_t long_mode)
+{
+    label->long_mode = long_mode;
+}
+
+lv_obj_t *lv_bar_create(lv_obj_t *par, const lv_obj_t *copy)
+{
+    (void) copy;
+    lv_obj_t *bar = obj_create(OBJ_BAR, par);
+    if (bar != NULL) {
+        bar->max = 100;
+        lv_obj_set_size(bar, 200, 20);
+    }
+    return bar;
+}
+
+void lv_bar_set_range(lv_obj_t *bar, int16_t min, int16_t max)
+{
+    bar->min = min;
+    bar->max = max;
+    if (bar->value < min) {
+        bar->value = min;
+    } else if (bar->value > max) {
+        bar->value = max;
+    }
+    lv_obj_invalidate(bar);
+}
+
+void lv_bar_set_value(lv_obj_t *bar, int16_t value, lv_anim_enable_t anim)
+{
+    (void) anim;
+    if (value < bar->min) {
+        value = bar->min;
+    } else if (value > bar->max) {
+        value = bar->max;
+    }
+    if (bar->value != value) {
+        bar->value = value;
+        lv_obj_invalidate(bar);
+    }
+}
+
+/*
+ * tasks and the tick
+ */
+lv_task_t *lv_task_create(lv_task_cb_t task_xcb, uint32_t period, lv_task_prio_t prio, void *user_data)
+{
+    if (taskCount == FAKE_LV_TASKS) {
+        fprintf(stderr, "fake lvgl: out of tasks\n");
+        return NULL;
+    }
+    lv_task_t *task = &tasks[taskCount++];
+    task->cb = task_xcb;
+    task->period = period;
+    task->last_run = tick;
+    task->prio = prio;
+    task->user_data = user_data;
+    return task;
+}
+
+void lv_task_set_prio(lv_task_t *task, lv_task_prio_t prio)
+{
+    task->prio = prio;
+}
+
+uint32_t lv_task_handler(void)
+{
+    uint32_t next = LV_NO_TASK_READY;
+
+    for (int prio = LV_TASK_PRIO_HIGHEST; prio > LV_TASK_PRIO_OFF; prio--) {
+        for (int i = 0; i < taskCount; i++) {
+            if (tasks[i].prio == prio && lv_tick_elaps(tasks[i].last_run) >= tasks[i].period) {
+                tasks[i].last_run = tick;
+                tasks[i].cb(&tasks[i]);
+            }
+        }
+    }
+    for (int i = 0; i < taskCount; i++) {
+        if (tasks[i].prio != LV_TASK_PRIO_OFF) {
+            uint32_t elapsed = lv_tick_elaps(tasks[i].last_run);
+            uint32_t left = elapsed >= tasks[i].period ? 0 : tasks[i].period - elapsed;
+            if (left < next) {
+                next = left;
+            }
+        }
+    }
+    return next;
+}
+
+void lv_tick_inc(uint32_t tick_period)
+{
+    tick += tick_period;
+}
+
+uint32_t lv_tick_get(void)
+{
+    return tick;
+}
+
+uint32_t lv_tick_elaps(uint32_t prev_tick)
+{
+    return tick - prev_tick;
+}
@@ -0,0 +1,24 @@
+/*
+ * host fake - lvgl_driver_init, the I2C master set up the display driver does.
+ */
+#include "driver/i2c.h"
+#include "lvgl_helpers.h"
+
+#include "i2c_bus.h"
+
+#define DISPLAY_I2C_CLOCK_HZ 400000
+
+void lvgl_driver_init(void)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_BUS_SDA_PIN,
+        .scl_io_num = I2C_BUS_SCL_PIN,
+        .sda_pullup_en = true,
+        .scl_pullup_en = true,
+        .master.clk_speed = DISPLAY_I2C_CLOCK_HZ,
+    };
+
+    i2c_param_config(I2C_BUS_PORT, &conf);
+    i2c_driver_install(I2C_BUS_PORT, conf.mode, 0, 0, 0);
+}
@@ -0,0 +1,101 @@
+/*
+ * host fake - NVS blobs in RAM.
+ */
+#include <string.h>
+
+#include "nvs.h"
+
+#define FAKE_NVS_KEYS 16
+#define FAKE_NVS_KEY_LEN 16
+#define FAKE_NVS_BLOB 4096
+
+typedef struct Entry {
+    char key[FAKE_NVS_KEY_LEN];
+    uint8_t blob[FAKE_NVS_BLOB];
+    size_t len;
+} Entry;
+
+static Entry entries[FAKE_NVS_KEYS];
+
+static Entry *find(const char *key)
+{
+    for (int i = 0; i < FAKE_NVS_KEYS; i++) {
+        if (entries[i].key[0] != '\0' && strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    (void) name;
+    (void) mode;
+    *handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    Entry *e = find(key);
+
+    (void) handle;
+    if (strlen(key) >= FAKE_NVS_KEY_LEN || length > FAKE_NVS_BLOB) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; e == NULL && i < FAKE_NVS_KEYS; i++) {
+        if (entries[i].key[0] == '\0') {
+            e = &entries[i];
+            strcpy(e->key, key);
+        }
+    }
+    if (e == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(e->blob, value, length);
+    e->len = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length)
+{
+    Entry *e = find(key);
+
+    (void) handle;
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out, e->blob, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    Entry *e = find(key);
+
+    (void) handle;
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    e->key[0] = '\0';
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void) handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void) handle;
+}
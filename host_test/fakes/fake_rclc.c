@@ -0,0 +1,303 @@
+/*
+ * host fake - rclc support, entities and executor over a scripted transport: the test
+ * sends messages with fake_rclc_receive() and reads what the app published. needs the
+ * threaded FreeRTOS fake, spin_some blocks the calling task until a handle is ready.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "fake_rclc.h"
+#include "rclc/executor.h"
+#include "std_msgs/msg/int32.h"
+
+typedef struct Message {
+    const rcl_subscription_t *subscription;
+    int32_t data;
+} Message;
+
+typedef struct Published {
+    const rcl_publisher_t *publisher;
+    uint32_t count;
+    int32_t last;
+} Published;
+
+/***************************
+ * globals
+ ***************************/
+static pthread_mutex_t transportLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t transportChanged;     // on CLOCK_MONOTONIC
+static pthread_once_t transportOnce = PTHREAD_ONCE_INIT;
+static const rcl_subscription_t *subscriptions[FAKE_RCLC_MAX_ENTITIES];
+static int subscriptionCount;
+static Published published[FAKE_RCLC_MAX_ENTITIES];
+static int publishedCount;
+static Message queue[FAKE_RCLC_QUEUE];
+static int queued;
+static int failSpins;
+
+static void transport_init(void)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&transportChanged, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static struct timespec to_timespec(int64_t ns)
+{
+    struct timespec ts = { .tv_sec = ns / 1000000000, .tv_nsec = ns % 1000000000 };
+    return ts;
+}
+
+/* with transportLock held: the oldest message for `subscription`, taken off the queue */
+static bool take_message(const rcl_subscription_t *subscription, int32_t *data)
+{
+    for (int i = 0; i < queued; i++) {
+        if (queue[i].subscription == subscription) {
+            *data = queue[i].data;
+            memmove(&queue[i], &queue[i + 1], (queued - i - 1) * sizeof(queue[0]));
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+rcl_ret_t rclc_support_init(rclc_support_t *support, int argc, char const *const *argv,
+                            rcl_allocator_t *allocator)
+{
+    (void) argc;
+    (void) argv;
+    pthread_once(&transportOnce, transport_init);
+    support->context.valid = true;
+    support->allocator = allocator;
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rclc_node_init_default(rcl_node_t *node, const char *name, const char *namespace_,
+                                 rclc_support_t *support)
+{
+    (void) namespace_;
+    if (!support->context.valid) {
+        return RCL_RET_ERROR;
+    }
+    node->name = name;
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rclc_subscription_init_default(rcl_subscription_t *subscription, const rcl_node_t *node,
+                                         const rosidl_message_type_support_t *type_support,
+                                         const char *topic_name)
+{
+    rcl_ret_t ret = RCL_RET_ERROR;
+
+    (void) node;
+    (void) type_support;
+    subscription->topic = topic_name;
+    pthread_mutex_lock(&transportLock);
+    if (subscriptionCount < FAKE_RCLC_MAX_ENTITIES) {
+        subscriptions[subscriptionCount++] = subscription;
+        ret = RCL_RET_OK;
+    }
+    pthread_mutex_unlock(&transportLock);
+    return ret;
+}
+
+rcl_ret_t rclc_publisher_init_default(rcl_publisher_t *publisher, const rcl_node_t *node,
+                                      const rosidl_message_type_support_t *type_support,
+                                      const char *topic_name)
+{
+    rcl_ret_t ret = RCL_RET_ERROR;
+
+    (void) node;
+    (void) type_support;
+    publisher->topic = topic_name;
+    pthread_mutex_lock(&transportLock);
+    if (publishedCount < FAKE_RCLC_MAX_ENTITIES) {
+        published[publishedCount++].publisher = publisher;
+        ret = RCL_RET_OK;
+    }
+    pthread_mutex_unlock(&transportLock);
+    return ret;
+}
+
+rcl_ret_t rclc_timer_init_default(rcl_timer_t *timer, rclc_support_t *support, const uint64_t timeout_ns,
+                                  const rcl_timer_callback_t callback)
+{
+    (void) support;
+    timer->period_ns = (int64_t) timeout_ns;
+    timer->last_call_ns = now_ns();
+    timer->callback = callback;
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rcl_publish(const rcl_publisher_t *publisher, const void *ros_message, void *allocation)
+{
+    const std_msgs__msg__Int32 *msg = ros_message;
+    rcl_ret_t ret = RCL_RET_ERROR;
+
+    (void) allocation;
+    pthread_mutex_lock(&transportLock);
+    for (int i = 0; i < publishedCount; i++) {
+        if (published[i].publisher == publisher) {
+            published[i].count++;
+            published[i].last = msg->data;
+            ret = RCL_RET_OK;
+        }
+    }
+    pthread_mutex_unlock(&transportLock);
+    return ret;
+}
+
+rcl_ret_t rcl_subscription_fini(rcl_subscription_t *subscription, rcl_node_t *node)
+{
+    (void) subscription;
+    (void) node;
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rcl_node_fini(rcl_node_t *node)
+{
+    (void) node;
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rclc_executor_init(rclc_executor_t *executor, rcl_context_t *context, const size_t number_of_handles,
+                             const rcl_allocator_t *allocator)
+{
+    (void) allocator;
+    if (!context->valid || number_of_handles == 0 || number_of_handles > FAKE_RCLC_MAX_HANDLES) {
+        return RCL_RET_ERROR;
+    }
+    memset(executor, 0, sizeof(*executor));
+    executor->max_handles = number_of_handles;
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rclc_executor_add_subscription(rclc_executor_t *executor, rcl_subscription_t *subscription, void *msg,
+                                         rclc_subscription_callback_t callback,
+                                         rclc_executor_handle_invocation_t invocation)
+{
+    if (executor->count == executor->max_handles) {
+        return RCL_RET_ERROR;
+    }
+    executor->handles[executor->count++] = (rclc_executor_handle_t) {
+        .subscription = subscription,
+        .msg = msg,
+        .callback = callback,
+        .invocation = invocation,
+    };
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rclc_executor_add_timer(rclc_executor_t *executor, rcl_timer_t *timer)
+{
+    if (executor->count == executor->max_handles) {
+        return RCL_RET_ERROR;
+    }
+    executor->handles[executor->count++] = (rclc_executor_handle_t) { .timer = timer };
+    return RCL_RET_OK;
+}
+
+rcl_ret_t rclc_executor_spin_some(rclc_executor_t *executor, const uint64_t timeout_ns)
+{
+    int64_t until = now_ns() + (int64_t) timeout_ns;
+    bool ran = false;
+
+    pthread_mutex_lock(&transportLock);
+    if (failSpins > 0) {
+        failSpins--;
+        pthread_mutex_unlock(&transportLock);
+        return RCL_RET_ERROR;
+    }
+    for (;;) {
+        int64_t wake = until;
+
+        /* callbacks run without the lock, they publish */
+        for (size_t i = 0; i < executor->count; i++) {
+            rclc_executor_handle_t *h = &executor->handles[i];
+            int32_t data;
+
+            if (h->subscription != NULL && take_message(h->subscription, &data)) {
+                ((std_msgs__msg__Int32 *) h->msg)->data = data;
+                pthread_mutex_unlock(&transportLock);
+                h->callback(h->msg);
+                pthread_mutex_lock(&transportLock);
+                ran = true;
+            } else if (h->timer != NULL) {
+                int64_t now = now_ns();
+                int64_t due = h->timer->last_call_ns + h->timer->period_ns;
+
+                if (now >= due) {
+                    int64_t since = now - h->timer->last_call_ns;
+                    h->timer->last_call_ns = now;
+                    pthread_mutex_unlock(&transportLock);
+                    h->timer->callback(h->timer, since);
+                    pthread_mutex_lock(&transportLock);
+                    ran = true;
+                } else if (due < wake) {
+                    wake = due;
+                }
+            }
+        }
+        if (ran || now_ns() >= until) {
+            break;
+        }
+        struct timespec ts = to_timespec(wake);
+        pthread_cond_timedwait(&transportChanged, &transportLock, &ts);
+    }
+    pthread_mutex_unlock(&transportLock);
+    return ran ? RCL_RET_OK : RCL_RET_TIMEOUT;
+}
+
+bool fake_rclc_receive(const char *topic, int32_t data)
+{
+    bool sent = false;
+
+    pthread_once(&transportOnce, transport_init);
+    pthread_mutex_lock(&transportLock);
+    for (int i = 0; i < subscriptionCount && !sent; i++) {
+        if (strcmp(subscriptions[i]->topic, topic) == 0 && queued < FAKE_RCLC_QUEUE) {
+            queue[queued++] = (Message) { .subscription = subscriptions[i], .data = data };
+            sent = true;
+        }
+    }
+    pthread_cond_broadcast(&transportChanged);
+    pthread_mutex_unlock(&transportLock);
+    return sent;
+}
+
+void fake_rclc_fail_spins(int count)
+{
+    pthread_mutex_lock(&transportLock);
+    failSpins = count;
+    pthread_mutex_unlock(&transportLock);
+}
+
+uint32_t fake_rclc_published(const char *topic, int32_t *last)
+{
+    uint32_t count = 0;
+
+    pthread_mutex_lock(&transportLock);
+    for (int i = 0; i < publishedCount; i++) {
+        if (strcmp(published[i].publisher->topic, topic) == 0) {
+            count = published[i].count;
+            if (last != NULL) {
+                *last = published[i].last;
+            }
+        }
+    }
+    pthread_mutex_unlock(&transportLock);
+    return count;
+}
@@ -0,0 +1,354 @@
+/*
+ * host fake - FreeRTOS tasks, notifications, mutexes and event groups on pthreads, for
+ * the whole app in one process (host_app.c). each task is a detached thread, delays and
+ * waits sleep on the host's monotonic clock, and critical sections share one lock.
+ * priorities and core pinning are ignored.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define FAKE_TASKS 16
+#define FAKE_SEMAPHORES 16
+#define TICK_US (1000000 / configTICK_RATE_HZ)
+
+typedef struct FakeTask {
+    pthread_t thread;
+    TaskFunction_t code;
+    void *arg;
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t notified;
+} FakeTask;
+
+typedef struct FakeEventGroup {
+    EventBits_t bits;
+} FakeEventGroup;
+
+_Static_assert(sizeof(FakeEventGroup) <= sizeof(StaticEventGroup_t), "event group does not fit its buffer");
+
+/***************************
+ * globals
+ ***************************/
+static pthread_mutex_t criticalLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static pthread_mutex_t rtosLock = PTHREAD_MUTEX_INITIALIZER;    // notifications and event groups
+static pthread_cond_t rtosChanged;                              // on CLOCK_MONOTONIC, see wait_locked()
+static pthread_once_t rtosOnce = PTHREAD_ONCE_INIT;
+static FakeTask tasks[FAKE_TASKS];
+static int taskCount;
+static pthread_mutex_t semaphores[FAKE_SEMAPHORES];
+static int semaphoreCount;
+static __thread FakeTask *current;
+
+static void rtos_init(void)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&rtosChanged, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static struct timespec deadline(TickType_t wait)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t) ts.tv_nsec + (uint64_t) wait * TICK_US * 1000;
+    ts.tv_sec += ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+}
+
+/* with rtosLock held: sleep until something changes or `until`, false once it has passed */
+static bool wait_locked(TickType_t wait, const struct timespec *until)
+{
+    if (wait == 0) {
+        return false;
+    }
+    if (wait == portMAX_DELAY) {
+        pthread_cond_wait(&rtosChanged, &rtosLock);
+        return true;
+    }
+    return pthread_cond_timedwait(&rtosChanged, &rtosLock, until) != ETIMEDOUT;
+}
+
+static FakeTask *new_task(const char *name)
+{
+    FakeTask *task = NULL;
+
+    pthread_mutex_lock(&rtosLock);
+    if (taskCount < FAKE_TASKS) {
+        task = &tasks[taskCount++];
+        snprintf(task->name, sizeof(task->name), "%s", name);
+    }
+    pthread_mutex_unlock(&rtosLock);
+    return task;
+}
+
+static void *run_task(void *arg)
+{
+    current = arg;
+    current->code(current->arg);
+    return NULL;
+}
+
+void fake_rtos_enter_critical(void)
+{
+    pthread_mutex_lock(&criticalLock);
+}
+
+void fake_rtos_exit_critical(void)
+{
+    pthread_mutex_unlock(&criticalLock);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t code, const char *name, uint32_t stack_depth, void *arg,
+                               UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb)
+{
+    FakeTask *task = new_task(name);
+    pthread_attr_t attr;
+
+    (void) stack_depth;
+    (void) priority;
+    (void) stack;
+    (void) tcb;
+    pthread_once(&rtosOnce, rtos_init);
+    if (task == NULL) {
+        return NULL;
+    }
+    task->code = code;
+    task->arg = arg;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&task->thread, &attr, run_task, task);
+    pthread_attr_destroy(&attr);
+    return err == 0 ? task : NULL;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t code, const char *name, uint32_t stack_depth,
+                                           void *arg, UBaseType_t priority, StackType_t *stack,
+                                           StaticTask_t *tcb, BaseType_t core)
+{
+    (void) core;
+    return xTaskCreateStatic(code, name, stack_depth, arg, priority, stack, tcb);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created)
+{
+    TaskHandle_t task = xTaskCreateStatic(code, name, stack_depth, arg, priority, NULL, NULL);
+
+    if (created != NULL) {
+        *created = task;
+    }
+    return task != NULL ? pdPASS : pdFAIL;
+}
+
+/* only a task deleting itself, as the app's tasks do */
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == current) {
+        pthread_exit(NULL);
+    }
+    fprintf(stderr, "vTaskDelete of another task is not faked\n");
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec until = deadline(ticks);
+
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+    }
+}
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    *previous += increment;
+    if ((int32_t)(*previous - now) > 0) {
+        vTaskDelay(*previous - now);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / TICK_US);
+}
+
+/* a thread the fake did not start, main, is given a task on first use */
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (current == NULL) {
+        pthread_once(&rtosOnce, rtos_init);
+        current = new_task("main");
+    }
+    return current;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action)
+{
+    FakeTask *task = handle;
+
+    pthread_once(&rtosOnce, rtos_init);
+    pthread_mutex_lock(&rtosLock);
+    switch (action) {
+    case eSetBits:
+        task->notified |= value;
+        break;
+    case eIncrement:
+        task->notified++;
+        break;
+    case eSetValueWithOverwrite:
+    case eSetValueWithoutOverwrite:
+        task->notified = value;
+        break;
+    default:
+        break;
+    }
+    pthread_cond_broadcast(&rtosChanged);
+    pthread_mutex_unlock(&rtosLock);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait)
+{
+    FakeTask *task = xTaskGetCurrentTaskHandle();
+    struct timespec until = deadline(wait);
+    BaseType_t got = pdFALSE;
+
+    pthread_mutex_lock(&rtosLock);
+    task->notified &= ~clear_on_entry;
+    while (task->notified == 0 && wait_locked(wait, &until)) {
+    }
+    if (value != NULL) {
+        *value = task->notified;
+    }
+    if (task->notified != 0) {
+        task->notified &= ~clear_on_exit;
+        got = pdTRUE;
+    }
+    pthread_mutex_unlock(&rtosLock);
+    return got;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait)
+{
+    FakeTask *task = xTaskGetCurrentTaskHandle();
+    struct timespec until = deadline(wait);
+
+    pthread_mutex_lock(&rtosLock);
+    while (task->notified == 0 && wait_locked(wait, &until)) {
+    }
+    uint32_t value = task->notified;
+    if (value != 0) {
+        task->notified = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&rtosLock);
+    return value;
+}
+
+uint32_t fake_task_notified(TaskHandle_t handle)
+{
+    FakeTask *task = handle;
+
+    pthread_mutex_lock(&rtosLock);
+    uint32_t value = task->notified;
+    pthread_mutex_unlock(&rtosLock);
+    return value;
+}
+
+/* a pool of plain mutexes, the buffer is not used */
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    pthread_mutex_t *sem = NULL;
+
+    (void) buffer;
+    pthread_mutex_lock(&rtosLock);
+    if (semaphoreCount < FAKE_SEMAPHORES) {
+        sem = &semaphores[semaphoreCount++];
+        pthread_mutex_init(sem, NULL);
+    }
+    pthread_mutex_unlock(&rtosLock);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateMutexStatic(NULL);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    struct timespec until = deadline(wait);
+
+    if (wait == portMAX_DELAY) {
+        return pthread_mutex_lock(sem) == 0 ? pdTRUE : pdFALSE;
+    }
+    if (wait == 0) {
+        return pthread_mutex_trylock(sem) == 0 ? pdTRUE : pdFALSE;
+    }
+    return pthread_mutex_clocklock(sem, CLOCK_MONOTONIC, &until) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pthread_mutex_unlock(sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *buffer)
+{
+    FakeEventGroup *group = (FakeEventGroup *) buffer;
+
+    pthread_once(&rtosOnce, rtos_init);
+    group->bits = 0;
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t handle, EventBits_t bits)
+{
+    FakeEventGroup *group = handle;
+
+    pthread_mutex_lock(&rtosLock);
+    group->bits |= bits;
+    EventBits_t now = group->bits;
+    pthread_cond_broadcast(&rtosChanged);
+    pthread_mutex_unlock(&rtosLock);
+    return now;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t handle, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t wait)
+{
+    FakeEventGroup *group = handle;
+    struct timespec until = deadline(wait);
+
+    pthread_mutex_lock(&rtosLock);
+    for (;;) {
+        EventBits_t set = group->bits & bits;
+        if ((wait_for_all ? set == bits : set != 0) || !wait_locked(wait, &until)) {
+            break;
+        }
+    }
+    EventBits_t now = group->bits;
+    if (clear_on_exit && (wait_for_all ? (now & bits) == bits : (now & bits) != 0)) {
+        group->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&rtosLock);
+    return now;
+}
@@ -0,0 +1,8 @@
+/*
+ * host fake - esp32/rom/ets_sys.h. a busy wait advances the fake clock.
+ */
+#pragma once
+
+#include <stdint.h>
+
+void ets_delay_us(uint32_t us);
@@ -0,0 +1,7 @@
+/*
+ * host fake - esp_attr.h.
+ */
+#pragma once
+
+#define DMA_ATTR
+#define IRAM_ATTR
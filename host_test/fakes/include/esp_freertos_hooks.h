@@ -0,0 +1,6 @@
+/*
+ * host fake - esp_freertos_hooks.h. included by the tasks, nothing registers a hook.
+ */
+#pragma once
+
+#include "esp_err.h"
@@ -0,0 +1,12 @@
+/*
+ * host fake - esp_heap_caps.h.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+
+size_t heap_caps_get_largest_free_block(uint32_t caps);
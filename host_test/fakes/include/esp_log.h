@@ -0,0 +1,12 @@
+/*
+ * host fake - esp_log.h. logs go to stderr when HOST_TEST_VERBOSE is set in the environment.
+ */
+#pragma once
+
+void host_log(char level, const char *tag, const char *fmt, ...);
+
+#define ESP_LOGE(tag, ...) host_log('E', tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) host_log('W', tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) host_log('I', tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) host_log('D', tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) host_log('V', tag, __VA_ARGS__)
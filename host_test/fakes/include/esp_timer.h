@@ -0,0 +1,11 @@
+/*
+ * host fake - esp_timer.h. time only moves when a test or vTaskDelay advances it.
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+/* test control */
+void fake_time_advance_us(int64_t us);
@@ -0,0 +1,57 @@
+/*
+ * host fake - what went over the I2C bus. each i2c_master_cmd_begin is one
+ * transaction holding every byte written in order, address bytes included.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#define FAKE_I2C_MAX_BYTES 160
+#define FAKE_I2C_LOG 256
+
+typedef struct FakeI2cTransaction {
+    uint8_t bytes[FAKE_I2C_MAX_BYTES];
+    size_t len;
+    TickType_t ticks;   // deadline the driver gave
+    esp_err_t result;   // what the fake returned
+} FakeI2cTransaction;
+
+/**
+ * @brief forget every transaction and pending failure.
+ */
+void fake_i2c_reset(void);
+
+/**
+ * @brief make the next `count` transactions fail with `err`.
+ */
+void fake_i2c_fail_next(int count, esp_err_t err);
+
+/**
+ * @brief transactions since the last reset.
+ */
+int fake_i2c_count(void);
+
+/**
+ * @brief one transaction, 0 the oldest. the log keeps the last FAKE_I2C_LOG.
+ */
+const FakeI2cTransaction *fake_i2c_get(int index);
+
+/*
+ * the installed master driver. i2c_param_config and i2c_driver_install set the period
+ * from the clock the way the real driver does (80MHz APB, high and low halves), and the
+ * timing getters and setters read and write these fields.
+ */
+typedef struct FakeI2cDriver {
+    bool installed;
+    uint32_t clk_speed;    // last i2c_param_config clock
+    int high, low;
+    int start_setup, start_hold;
+    int stop_setup, stop_hold;
+    int sample, hold;
+    int installs;
+} FakeI2cDriver;
+
+FakeI2cDriver *fake_i2c_driver(void);
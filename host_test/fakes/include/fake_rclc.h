@@ -0,0 +1,26 @@
+/*
+ * host fake - the micro-ROS agent's side of the transport in fake_rclc.c.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FAKE_RCLC_QUEUE 16           // messages waiting for the executor
+#define FAKE_RCLC_MAX_ENTITIES 4     // subscriptions, and publishers
+
+/**
+ * @brief send an Int32 on `topic`, taken by the executor's next spin. false when nothing
+ * subscribes to the topic yet or the queue is full.
+ */
+bool fake_rclc_receive(const char *topic, int32_t data);
+
+/**
+ * @brief make the next `count` spins fail, as they do once the agent has gone.
+ */
+void fake_rclc_fail_spins(int count);
+
+/**
+ * @brief messages published on `topic` since start up, and the last one's data.
+ */
+uint32_t fake_rclc_published(const char *topic, int32_t *last);
@@ -0,0 +1,49 @@
+/*
+ * host fake - FreeRTOS.h. a tick is 10ms. single threaded, critical sections are no-ops,
+ * unless built with FAKE_RTOS_THREADS (fake_rtos_threads.c), where tasks are threads and
+ * a critical section holds one lock shared by every task, as interrupts off would.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t; // bytes, as in ESP-IDF
+
+typedef struct { int owner; } portMUX_TYPE;
+typedef struct { uint8_t opaque[96]; } StaticTask_t;
+typedef struct { uint8_t opaque[80]; } StaticSemaphore_t;
+typedef struct { uint8_t opaque[80]; } StaticQueue_t;
+typedef struct { uint8_t opaque[32]; } StaticEventGroup_t;
+
+#define configTICK_RATE_HZ 100
+#define configMAX_TASK_NAME_LEN 16
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define portNUM_PROCESSORS 2
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#ifdef FAKE_RTOS_THREADS
+void fake_rtos_enter_critical(void);
+void fake_rtos_exit_critical(void);
+#define portENTER_CRITICAL(mux) ((void)(mux), fake_rtos_enter_critical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), fake_rtos_exit_critical())
+#else
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#endif
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+
+BaseType_t xPortGetCoreID(void);
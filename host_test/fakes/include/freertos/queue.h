@@ -0,0 +1,8 @@
+/*
+ * host fake - queue.h. only the types, nothing under test uses a queue.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *QueueHandle_t;
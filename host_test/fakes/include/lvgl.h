@@ -0,0 +1,166 @@
+/*
+ * host fake - a miniature lvgl 7 for a 1 bit colour depth: screens, labels and bars,
+ * invalidation and refresh through the registered display driver, tasks and the tick.
+ *
+ * enough to run the dashboard and the display driver as they run on the board. widgets
+ * are drawn plainly (labels in a built in 5x7 font, bars as an outline and a fill), so
+ * a frame has the board's layout and invalidated areas but not its exact glyphs.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int16_t lv_coord_t;
+typedef uint8_t lv_opa_t;
+
+#define LV_OPA_TRANSP 0
+#define LV_OPA_COVER 255
+
+#define LV_HOR_RES_MAX 128
+#define LV_VER_RES_MAX 64
+#define LV_INV_BUF_SIZE 32            // invalid areas kept before the whole screen is redrawn
+#define LV_DISP_DEF_REFR_PERIOD 30
+#define LV_NO_TASK_READY 0xFFFFFFFF
+
+/* 1 is white, an unlit pixel */
+typedef union {
+    uint8_t full;
+} lv_color_t;
+
+#define LV_COLOR_WHITE ((lv_color_t) { .full = 1 })
+#define LV_COLOR_BLACK ((lv_color_t) { .full = 0 })
+
+typedef struct {
+    lv_coord_t x1;
+    lv_coord_t y1;
+    lv_coord_t x2;
+    lv_coord_t y2;
+} lv_area_t;
+
+typedef struct _lv_obj_t lv_obj_t;
+typedef struct _lv_task_t lv_task_t;
+typedef void (*lv_task_cb_t)(lv_task_t *);
+
+typedef enum {
+    LV_TASK_PRIO_OFF = 0,
+    LV_TASK_PRIO_LOWEST,
+    LV_TASK_PRIO_LOW,
+    LV_TASK_PRIO_MID,
+    LV_TASK_PRIO_HIGH,
+    LV_TASK_PRIO_HIGHEST,
+} lv_task_prio_t;
+
+typedef enum {
+    LV_ANIM_OFF,
+    LV_ANIM_ON,
+} lv_anim_enable_t;
+
+typedef enum {
+    LV_LABEL_LONG_EXPAND,   // the object is sized to the text
+    LV_LABEL_LONG_BREAK,
+    LV_LABEL_LONG_DOT,
+    LV_LABEL_LONG_SROLL,
+    LV_LABEL_LONG_SROLL_CIRC,
+    LV_LABEL_LONG_CROP,     // the object keeps its size, the text is clipped to it
+} lv_label_long_mode_t;
+
+#define LV_LABEL_PART_MAIN 0
+
+typedef struct {
+    uint16_t adv_w;
+    uint16_t box_w;
+    uint16_t box_h;
+    int16_t ofs_x;
+    int16_t ofs_y;
+    uint8_t bpp;
+} lv_font_glyph_dsc_t;
+
+typedef struct _lv_font_struct {
+    bool (*get_glyph_dsc)(const struct _lv_font_struct *, lv_font_glyph_dsc_t *, uint32_t letter, uint32_t next);
+    const uint8_t *(*get_glyph_bitmap)(const struct _lv_font_struct *, uint32_t letter);
+    lv_coord_t line_height;
+    lv_coord_t base_line;
+} lv_font_t;
+
+typedef struct {
+    lv_color_t *buf1;
+    lv_color_t *buf2;
+    uint32_t size;   // pixels
+} lv_disp_buf_t;
+
+typedef struct _disp_drv_t {
+    lv_coord_t hor_res;
+    lv_coord_t ver_res;
+    lv_disp_buf_t *buffer;
+    uint32_t rotated : 1;
+    void (*flush_cb)(struct _disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+    void (*rounder_cb)(struct _disp_drv_t *disp_drv, lv_area_t *area);
+    void (*set_px_cb)(struct _disp_drv_t *disp_drv, uint8_t *buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y,
+                      lv_color_t color, lv_opa_t opa);
+    void *user_data;
+} lv_disp_drv_t;
+
+typedef struct _disp_t {
+    lv_disp_drv_t driver;
+    lv_task_t *refr_task;
+    lv_obj_t *act_scr;
+} lv_disp_t;
+
+static inline lv_coord_t lv_area_get_width(const lv_area_t *area)
+{
+    return (lv_coord_t)(area->x2 - area->x1 + 1);
+}
+
+static inline lv_coord_t lv_area_get_height(const lv_area_t *area)
+{
+    return (lv_coord_t)(area->y2 - area->y1 + 1);
+}
+
+void lv_init(void);
+
+/* display */
+void lv_disp_buf_init(lv_disp_buf_t *disp_buf, void *buf1, void *buf2, uint32_t size_in_px_cnt);
+void lv_disp_drv_init(lv_disp_drv_t *driver);
+lv_disp_t *lv_disp_drv_register(lv_disp_drv_t *driver);
+lv_disp_t *lv_disp_get_default(void);
+lv_obj_t *lv_disp_get_scr_act(lv_disp_t *disp);
+lv_obj_t *lv_scr_act(void);
+bool lv_disp_flush_is_last(lv_disp_drv_t *disp_drv);
+void lv_disp_flush_ready(lv_disp_drv_t *disp_drv);
+void lv_refr_now(lv_disp_t *disp);
+
+/* objects */
+void lv_obj_set_pos(lv_obj_t *obj, lv_coord_t x, lv_coord_t y);
+void lv_obj_set_size(lv_obj_t *obj, lv_coord_t w, lv_coord_t h);
+void lv_obj_invalidate(const lv_obj_t *obj);
+const lv_font_t *lv_obj_get_style_text_font(const lv_obj_t *obj, uint8_t part);
+
+lv_obj_t *lv_label_create(lv_obj_t *par, const lv_obj_t *copy);
+void lv_label_set_text(lv_obj_t *label, const char *text);
+void lv_label_set_long_mode(lv_obj_t *label, lv_label_long_mode_t long_mode);
+
+lv_obj_t *lv_bar_create(lv_obj_t *par, const lv_obj_t *copy);
+void lv_bar_set_range(lv_obj_t *bar, int16_t min, int16_t max);
+void lv_bar_set_value(lv_obj_t *bar, int16_t value, lv_anim_enable_t anim);
+
+/* fonts */
+bool lv_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t next);
+const uint8_t *lv_font_get_glyph_bitmap(const lv_font_t *font, uint32_t letter);
+
+/* tasks and the tick */
+lv_task_t *lv_task_create(lv_task_cb_t task_xcb, uint32_t period, lv_task_prio_t prio, void *user_data);
+void lv_task_set_prio(lv_task_t *task, lv_task_prio_t prio);
+uint32_t lv_task_handler(void);
+void lv_tick_inc(uint32_t tick_period);
+uint32_t lv_tick_get(void);
+uint32_t lv_tick_elaps(uint32_t prev_tick);
+
+/* test control: areas redrawn and flush calls made by the last lv_refr_now */
+typedef struct FakeLvRefresh {
+    int areas;
+    int flushes;
+    uint32_t pixels;
+} FakeLvRefresh;
+
+void fake_lv_last_refresh(FakeLvRefresh *out);
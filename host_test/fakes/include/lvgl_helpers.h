@@ -0,0 +1,15 @@
+/*
+ * host fake - lvgl_helpers.h from lvgl_esp32_drivers, for an SSD1306 on I2C.
+ */
+#pragma once
+
+#include "lvgl.h"
+
+/* bytes, one bit per pixel - gui_task.c makes it pixels */
+#define DISP_BUF_SIZE (LV_HOR_RES_MAX * LV_VER_RES_MAX / 8)
+
+/**
+ * @brief install the I2C master at the display's clock, as the driver does. the panel's
+ * own init commands are not sent.
+ */
+void lvgl_driver_init(void);
@@ -0,0 +1,16 @@
+/*
+ * host fake - rcl/allocator.h, the allocator struct as rcutils declares it.
+ */
+#pragma once
+
+#include <stddef.h>
+
+typedef struct rcutils_allocator_s {
+    void *(*allocate)(size_t size, void *state);
+    void (*deallocate)(void *pointer, void *state);
+    void *(*reallocate)(void *pointer, size_t size, void *state);
+    void *(*zero_allocate)(size_t number_of_elements, size_t size_of_element, void *state);
+    void *state;
+} rcutils_allocator_t;
+
+typedef rcutils_allocator_t rcl_allocator_t;
@@ -0,0 +1,6 @@
+/*
+ * host fake - rcl/error_handling.h. the fake keeps no error state.
+ */
+#pragma once
+
+#define rcl_reset_error() ((void) 0)
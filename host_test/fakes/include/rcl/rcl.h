@@ -0,0 +1,55 @@
+/*
+ * host fake - rcl/rcl.h. the handles the app passes by address to rclc, the return codes
+ * and the type support macro the real headers bring in. fake_rclc.c is the transport.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rcl/allocator.h"
+
+typedef int32_t rcl_ret_t;
+
+#define RCL_RET_OK 0
+#define RCL_RET_ERROR 1
+#define RCL_RET_TIMEOUT 2
+
+#define RCL_MS_TO_NS(ms) ((int64_t)(ms) * 1000000LL)
+
+typedef struct rosidl_message_type_support_t {
+    const char *name;
+} rosidl_message_type_support_t;
+
+#define ROSIDL_GET_MSG_TYPE_SUPPORT(pkg, subfolder, type) \
+    (&(const rosidl_message_type_support_t) { #pkg "/" #subfolder "/" #type })
+
+typedef struct rcl_context_t {
+    bool valid;
+} rcl_context_t;
+
+typedef struct rcl_node_t {
+    const char *name;
+} rcl_node_t;
+
+typedef struct rcl_subscription_t {
+    const char *topic;
+} rcl_subscription_t;
+
+typedef struct rcl_publisher_t {
+    const char *topic;
+} rcl_publisher_t;
+
+typedef struct rcl_timer_t rcl_timer_t;
+typedef void (*rcl_timer_callback_t)(rcl_timer_t *timer, int64_t last_call_time);
+
+struct rcl_timer_t {
+    int64_t period_ns;
+    int64_t last_call_ns;      // host monotonic clock
+    rcl_timer_callback_t callback;
+};
+
+/* every topic in the app carries a std_msgs Int32 */
+rcl_ret_t rcl_publish(const rcl_publisher_t *publisher, const void *ros_message, void *allocation);
+rcl_ret_t rcl_subscription_fini(rcl_subscription_t *subscription, rcl_node_t *node);
+rcl_ret_t rcl_node_fini(rcl_node_t *node);
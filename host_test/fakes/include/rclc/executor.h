@@ -0,0 +1,40 @@
+/*
+ * host fake - rclc/executor.h. spin_some runs each handle that is ready once, waiting up
+ * to the timeout for one to become ready, like rclc's. messages come from fake_rclc.h.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#include "rclc/rclc.h"
+
+#define FAKE_RCLC_MAX_HANDLES 4
+
+typedef void (*rclc_subscription_callback_t)(const void *msg);
+
+typedef enum {
+    ON_NEW_DATA,
+    ALWAYS,
+} rclc_executor_handle_invocation_t;
+
+typedef struct rclc_executor_handle_t {
+    rcl_subscription_t *subscription;   // NULL for a timer
+    rcl_timer_t *timer;
+    void *msg;
+    rclc_subscription_callback_t callback;
+    rclc_executor_handle_invocation_t invocation;
+} rclc_executor_handle_t;
+
+typedef struct rclc_executor_t {
+    rclc_executor_handle_t handles[FAKE_RCLC_MAX_HANDLES];
+    size_t max_handles;
+    size_t count;
+} rclc_executor_t;
+
+rcl_ret_t rclc_executor_init(rclc_executor_t *executor, rcl_context_t *context, const size_t number_of_handles,
+                             const rcl_allocator_t *allocator);
+rcl_ret_t rclc_executor_add_subscription(rclc_executor_t *executor, rcl_subscription_t *subscription, void *msg,
+                                         rclc_subscription_callback_t callback,
+                                         rclc_executor_handle_invocation_t invocation);
+rcl_ret_t rclc_executor_add_timer(rclc_executor_t *executor, rcl_timer_t *timer);
+rcl_ret_t rclc_executor_spin_some(rclc_executor_t *executor, const uint64_t timeout_ns);
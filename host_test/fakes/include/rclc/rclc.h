@@ -0,0 +1,26 @@
+/*
+ * host fake - rclc/rclc.h. support, node, entity and timer set up always succeed.
+ */
+#pragma once
+
+#include "rcl/rcl.h"
+
+#define RCLC_UNUSED(x) (void)(x)
+
+typedef struct rclc_support_t {
+    rcl_context_t context;
+    rcl_allocator_t *allocator;
+} rclc_support_t;
+
+rcl_ret_t rclc_support_init(rclc_support_t *support, int argc, char const *const *argv,
+                            rcl_allocator_t *allocator);
+rcl_ret_t rclc_node_init_default(rcl_node_t *node, const char *name, const char *namespace_,
+                                 rclc_support_t *support);
+rcl_ret_t rclc_subscription_init_default(rcl_subscription_t *subscription, const rcl_node_t *node,
+                                         const rosidl_message_type_support_t *type_support,
+                                         const char *topic_name);
+rcl_ret_t rclc_publisher_init_default(rcl_publisher_t *publisher, const rcl_node_t *node,
+                                      const rosidl_message_type_support_t *type_support,
+                                      const char *topic_name);
+rcl_ret_t rclc_timer_init_default(rcl_timer_t *timer, rclc_support_t *support, const uint64_t timeout_ns,
+                                  const rcl_timer_callback_t callback);
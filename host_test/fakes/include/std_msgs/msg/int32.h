@@ -0,0 +1,10 @@
+/*
+ * host fake - std_msgs/msg/int32.h.
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef struct std_msgs__msg__Int32 {
+    int32_t data;
+} std_msgs__msg__Int32;
@@ -0,0 +1,278 @@
+/*
+ * host app - app.c, gui_task.c and uros_task.c built into one process, their tasks running
+ * as threads on fakes/fake_rtos_threads.c. appMain is started the way the micro-ROS
+ * component starts it, then this file plays the agent through fakes/fake_rclc.c: servo
+ * messages go in on the subscribed topics, and the PCA9685 writes, the dashboard on the
+ * fake panel, the boot phases and the link state are checked as they come out.
+ *
+ * stubbed: the network bring up (http_calls_init), the http worker, and the supervisor,
+ * which needs the task watchdog and per task stack and run time figures the host has no
+ * stand in for.
+ *
+ *   host_app           HOST_TEST_VERBOSE=1 host_app for every task's log
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "host_test.h"
+
+#include "app.h"
+#include "boot_profile.h"
+#include "fake_i2c.h"
+#include "fake_rclc.h"
+#include "gui_task.h"
+#include "http_calls.h"
+#include "http_worker.h"
+#include "oled_ssd1306.h"
+#include "pca9685.h"
+#include "servo_pca9685.h"
+#include "supervisor.h"
+
+#define WAIT_MS 2000                 // longest wait for anything the tasks do
+#define PCA9685_WRITE (0x40 << 1)    // uros_task.c's I2C_ADDRESS
+#define SERVO0_TOPIC "/servo0/int32_subscriber"
+#define SERVO1_TOPIC "/servo1/int32_subscriber"
+#define PUBLISH_TOPIC "freertos_int32_publisher"
+#define PBM_MAX 10000
+
+void appMain();
+
+static char pbm[PBM_MAX];   // the panel at the last snapshot
+static char statusBefore[PBM_MAX];
+
+void http_calls_init(void)
+{
+}
+
+/* do_http_call is built without HTTP_HEARTBEAT too, it is never called */
+esp_err_t http_worker_submit(const char *url, esp_http_client_method_t method,
+                             const char *post_data, int post_len,
+                             http_data_cb_t on_data, http_done_cb_t on_done, void *arg)
+{
+    (void) url;
+    (void) method;
+    (void) post_data;
+    (void) post_len;
+    (void) on_data;
+    (void) on_done;
+    (void) arg;
+    return ESP_FAIL;
+}
+
+esp_err_t supervisor_start(void)
+{
+    return ESP_OK;
+}
+
+int supervisor_register(uint32_t stall_ms)
+{
+    (void) stall_ms;
+    return 0;
+}
+
+void supervisor_feed(int slot)
+{
+    (void) slot;
+}
+
+void supervisor_get_stats(SupervisorStats *out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+/* micro_ros_espidf_component's app_main runs appMain on a task of its own */
+static void uros_task(void *arg)
+{
+    (void) arg;
+    appMain();
+}
+
+/* poll `done` every tick until it holds or WAIT_MS has passed */
+static bool wait_for(bool (*done)(void))
+{
+    for (int waited = 0; waited < WAIT_MS; waited += portTICK_PERIOD_MS) {
+        if (done()) {
+            return true;
+        }
+        vTaskDelay(1);
+    }
+    return done();
+}
+
+/* the last write of channel `ch`'s PWM registers since the bus log was reset */
+static const FakeI2cTransaction *pwm_write(int ch)
+{
+    const FakeI2cTransaction *found = NULL;
+
+    for (int i = 0; i < fake_i2c_count(); i++) {
+        const FakeI2cTransaction *t = fake_i2c_get(i);
+        if (t != NULL && t->len == 6 && t->bytes[0] == PCA9685_WRITE && t->bytes[1] == LED0_ON_L + 4 * ch) {
+            found = t;
+        }
+    }
+    return found;
+}
+
+static bool display_written(void)
+{
+    OledFlushStats flush;
+
+    oled_get_flush_stats(&flush);
+    return flush.frames > 0 && flush.errors == 0;
+}
+
+static void snapshot(void)
+{
+    FILE *f = tmpfile();
+
+    xSemaphoreTake(xGuiSemaphore, portMAX_DELAY);
+    oled_write_pbm(f);
+    xSemaphoreGive(xGuiSemaphore);
+    rewind(f);
+    size_t len = fread(pbm, 1, sizeof(pbm) - 1, f);
+    pbm[len] = '\0';
+    fclose(f);
+}
+
+static char pixel(int x, int y)
+{
+    return pbm[strlen("P1\n128 64\n") + y * (OLED_WIDTH + 1) + x];
+}
+
+static bool ros_ready(void)
+{
+    return boot_wait(BOOT_PHASE_ROS_READY, 0);
+}
+
+static bool servos_written(void)
+{
+    return pwm_write(0) != NULL && pwm_write(1) != NULL;
+}
+
+/* channel 0's bar half full, channel 1's full - see test_oled_snapshot.c for the layout */
+static bool bars_shown(void)
+{
+    snapshot();
+    return pixel(0 * 8 + 3, 16 + 29) == '1' && pixel(0 * 8 + 3, 16 + 2) == '0'
+        && pixel(1 * 8 + 3, 16 + 2) == '1';
+}
+
+static bool timer_published(void)
+{
+    return fake_rclc_published(PUBLISH_TOPIC, NULL) > 0;
+}
+
+/* the status text, rows 0-7 of the panel, differs from statusBefore */
+static bool status_redrawn(void)
+{
+    size_t header = strlen("P1\n128 64\n");
+
+    snapshot();
+    return memcmp(pbm + header, statusBefore + header, 8 * (OLED_WIDTH + 1)) != 0;
+}
+
+static bool link_down(void)
+{
+    return !gui_ipc_link_up();
+}
+
+static bool link_up(void)
+{
+    return gui_ipc_link_up();
+}
+
+static void test_boots_to_the_executor(void)
+{
+    CHECK(wait_for(ros_ready));
+    for (BootPhase p = 0; p < BOOT_PHASE_FIRST_COMMAND; p++) {
+        if (!boot_wait(p, 0)) {
+            fprintf(stderr, "boot phase %s not marked\n", boot_phase_name(p));
+            CHECK(boot_wait(p, 0));
+        }
+    }
+    CHECK(!boot_wait(BOOT_PHASE_FIRST_COMMAND, 0));
+    CHECK(gui_ipc_link_up());
+    /* the display driver brought up the I2C master the PCA9685 set up waited for */
+    CHECK(fake_i2c_driver()->installed);
+}
+
+static void test_first_frame_reaches_the_panel(void)
+{
+    CHECK(wait_for(display_written));
+}
+
+static void test_servo_messages_reach_the_pca9685(void)
+{
+    uint16_t ticks0, ticks1;
+
+    fake_i2c_reset();
+    CHECK(fake_rclc_receive(SERVO0_TOPIC, 90));
+    CHECK(fake_rclc_receive(SERVO1_TOPIC, 180));
+    CHECK(wait_for(servos_written));
+
+    /* the off count the channel's pulse range gives for the angle, on from 0 */
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, 90, &ticks0), ESP_OK);
+    CHECK_EQ(servo_pca9685_position_to_ticks(1, SERVO_UNIT_DEGREES, 180, &ticks1), ESP_OK);
+    const FakeI2cTransaction *t0 = pwm_write(0), *t1 = pwm_write(1);
+    if (t0 != NULL && t1 != NULL) {
+        CHECK_EQ(t0->bytes[2] | t0->bytes[3] << 8, 0);
+        CHECK_EQ(t0->bytes[4] | t0->bytes[5] << 8, ticks0);
+        CHECK_EQ(t1->bytes[4] | t1->bytes[5] << 8, ticks1);
+    }
+    CHECK(boot_wait(BOOT_PHASE_FIRST_COMMAND, 0));
+}
+
+static void test_dashboard_shows_the_servos(void)
+{
+    GuiIpcStats ipc;
+
+    CHECK(wait_for(bars_shown));
+    gui_ipc_get_stats(&ipc);
+    CHECK(ipc.posted >= 2);
+    CHECK_EQ(ipc.dropped, 0);
+}
+
+static void test_timer_publishes(void)
+{
+    int32_t last = -1;
+
+    /* once a second, counting up from 0 */
+    CHECK(wait_for(timer_published));
+    CHECK(fake_rclc_published(PUBLISH_TOPIC, &last) > 0);
+    CHECK(last >= 0);
+}
+
+static void test_lost_agent_shows_link_down(void)
+{
+    /* uros_task.c reports the link down after 10 failed spins in a row */
+    snapshot();
+    memcpy(statusBefore, pbm, sizeof(statusBefore));
+    fake_rclc_fail_spins(1000);
+    CHECK(wait_for(link_down));
+    CHECK(wait_for(status_redrawn));
+
+    /* the next good spin brings it back */
+    fake_rclc_fail_spins(0);
+    CHECK(wait_for(link_up));
+}
+
+int main(void)
+{
+    if (xTaskCreate(uros_task, "uros_task", 16 * 1024, NULL, 5, NULL) != pdPASS) {
+        fprintf(stderr, "could not start the app\n");
+        return 1;
+    }
+
+    RUN(test_boots_to_the_executor);
+    RUN(test_first_frame_reaches_the_panel);
+    RUN(test_servo_messages_reach_the_pca9685);
+    RUN(test_dashboard_shows_the_servos);
+    RUN(test_timer_publishes);
+    RUN(test_lost_agent_shows_link_down);
+
+    /* the tasks never return, end the process under them */
+    fflush(stdout);
+    fflush(stderr);
+    _exit(HOST_TEST_EXIT());
+}
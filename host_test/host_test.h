@@ -0,0 +1,31 @@
+/*
+ * host test - checks that count failures and carry on, so one run reports every broken case.
+ */
+#pragma once
+
+#include <stdio.h>
+
+static int host_test_failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+        long long a_ = (long long)(actual), e_ = (long long)(expected); \
+        if (a_ != e_) { \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define RUN(test) do { \
+        int before_ = host_test_failures; \
+        test(); \
+        printf("%-48s %s\n", #test, before_ == host_test_failures ? "ok" : "FAILED"); \
+    } while (0)
+
+#define HOST_TEST_EXIT() (host_test_failures == 0 ? 0 : 1)
@@ -0,0 +1,72 @@
+/*
+ * CmdRecord packing: source, unit and a 19 bit signed value across flags and value.
+ */
+#include "host_test.h"
+
+#include "cmd_recorder.h"
+
+static CmdRecord pack(int source, int unit, int32_t value)
+{
+    CmdRecord rec = {
+        .t_ms = 1234,
+        .channel = 7,
+        .flags = CMD_RECORD_FLAGS(source, unit, value),
+        .value = (int16_t) value,
+    };
+    return rec;
+}
+
+static void test_value_round_trips(void)
+{
+    static const int32_t values[] = {
+        0, 1, -1, 90, 180, 1500, 32767, 32768, -32768, -32769, 65535, 65536,
+        180000, -180000, CMD_RECORD_VALUE_MAX, -CMD_RECORD_VALUE_MAX, -CMD_RECORD_VALUE_MAX - 1,
+    };
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        CmdRecord rec = pack(SERVO_SOURCE_ROS, SERVO_UNIT_MILLIDEGREES, values[i]);
+        CHECK_EQ(CMD_RECORD_VALUE(&rec), values[i]);
+    }
+}
+
+static void test_every_value_in_range(void)
+{
+    int wrong = 0;
+
+    for (int32_t v = -CMD_RECORD_VALUE_MAX - 1; v <= CMD_RECORD_VALUE_MAX; v++) {
+        CmdRecord rec = pack(SERVO_SOURCE_HTTP, SERVO_UNIT_US, v);
+        wrong += CMD_RECORD_VALUE(&rec) != v;
+    }
+    CHECK_EQ(wrong, 0);
+}
+
+static void test_source_and_unit_survive_any_value(void)
+{
+    static const int32_t values[] = { 0, -1, CMD_RECORD_VALUE_MAX, -CMD_RECORD_VALUE_MAX - 1 };
+
+    for (int source = 0; source < 8; source++) {
+        for (int unit = 0; unit < SERVO_UNIT_COUNT; unit++) {
+            for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+                CmdRecord rec = pack(source, unit, values[i]);
+                CHECK_EQ(CMD_RECORD_SOURCE(rec.flags), source);
+                CHECK_EQ(CMD_RECORD_UNIT(rec.flags), unit);
+                CHECK_EQ(CMD_RECORD_VALUE(&rec), values[i]);
+            }
+        }
+    }
+}
+
+static void test_record_is_eight_bytes(void)
+{
+    CHECK_EQ(sizeof(CmdRecord), 8);
+    CHECK_EQ(CMD_RECORDER_SECTOR_SIZE % sizeof(CmdRecord), 0);
+}
+
+int main(void)
+{
+    RUN(test_value_round_trips);
+    RUN(test_every_value_in_range);
+    RUN(test_source_and_unit_survive_any_value);
+    RUN(test_record_is_eight_bytes);
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,84 @@
+/*
+ * i2c bus recovery: the stuck slave is clocked free and the master driver comes back
+ * with the clock and timing the display driver installed, not I2C_BUS_CLOCK_HZ.
+ */
+#include "host_test.h"
+
+#include "driver/gpio.h"
+#include "fake_i2c.h"
+#include "gui_task.h"
+#include "i2c_bus.h"
+
+SemaphoreHandle_t xGuiSemaphore;
+
+/* what lvgl_driver_init does for the display, at the display's own clock */
+static void install_display_driver(uint32_t clk_speed)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_BUS_SDA_PIN,
+        .scl_io_num = I2C_BUS_SCL_PIN,
+        .master.clk_speed = clk_speed,
+    };
+
+    i2c_driver_delete(I2C_BUS_PORT);
+    i2c_param_config(I2C_BUS_PORT, &conf);
+    i2c_driver_install(I2C_BUS_PORT, I2C_MODE_MASTER, 0, 0, 0);
+}
+
+static void test_needs_the_gui_lock(void)
+{
+    CHECK_EQ(i2c_bus_recover(), ESP_ERR_TIMEOUT);
+    CHECK_EQ(i2c_bus_recoveries(), 0);
+}
+
+static void test_clocks_the_slave_free(void)
+{
+    install_display_driver(I2C_BUS_CLOCK_HZ);
+    fake_gpio_hold_low(I2C_BUS_SDA_PIN, I2C_BUS_SCL_PIN, 3);
+
+    CHECK_EQ(i2c_bus_recover(), ESP_OK);
+    CHECK_EQ(gpio_get_level(I2C_BUS_SDA_PIN), 1);
+    CHECK_EQ(fake_gpio_falling_edges(I2C_BUS_SCL_PIN), 3 + 1); // the held clocks, then the STOP
+    CHECK(fake_i2c_driver()->installed);
+}
+
+static void test_keeps_the_display_clock(void)
+{
+    FakeI2cDriver *drv = fake_i2c_driver();
+
+    install_display_driver(100000);
+    i2c_set_data_timing(I2C_BUS_PORT, 123, 45);
+    int installs = drv->installs;
+
+    CHECK_EQ(i2c_bus_recover(), ESP_OK);
+    CHECK_EQ(drv->installs, installs + 1);
+    CHECK_EQ(drv->high, 400);       // 100kHz at 80MHz APB, not I2C_BUS_CLOCK_HZ
+    CHECK_EQ(drv->low, 400);
+    CHECK_EQ(drv->start_setup, 400);
+    CHECK_EQ(drv->stop_hold, 400);
+    CHECK_EQ(drv->sample, 123);
+    CHECK_EQ(drv->hold, 45);
+}
+
+static void test_falls_back_without_a_driver(void)
+{
+    FakeI2cDriver *drv = fake_i2c_driver();
+
+    i2c_driver_delete(I2C_BUS_PORT);
+    CHECK_EQ(i2c_bus_recover(), ESP_OK);
+    CHECK(drv->installed);
+    CHECK_EQ(drv->clk_speed, I2C_BUS_CLOCK_HZ);
+    CHECK_EQ(drv->high + drv->low, 80000000 / I2C_BUS_CLOCK_HZ);
+}
+
+int main(void)
+{
+    RUN(test_needs_the_gui_lock);
+    xGuiSemaphore = xSemaphoreCreateMutex();
+    RUN(test_clocks_the_slave_free);
+    RUN(test_keeps_the_display_clock);
+    RUN(test_falls_back_without_a_driver);
+    CHECK_EQ(i2c_bus_recoveries(), 3);
+    return HOST_TEST_EXIT();
+}
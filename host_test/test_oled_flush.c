@@ -0,0 +1,180 @@
+/*
+ * oled ssd1306: native 1bpp packing and the page/column windows sent for a flush,
+ * checked byte for byte against the fake bus. the module keeps the panel contents
+ * between tests, so each builds on the frame the previous one left.
+ */
+#include <string.h>
+
+#include "host_test.h"
+
+#include "fake_i2c.h"
+#include "oled_fields.h"
+#include "oled_ssd1306.h"
+
+#define ADDR_WRITE (0x3C << 1)
+#define CMD_STREAM 0x00
+#define DATA_STREAM 0x40
+
+/* lvgl draw buffer, one lv_color_t per pixel - 1 is white, an unlit pixel */
+static lv_color_t buf[OLED_DRAW_BUF_PX] __attribute__((aligned(4)));
+static lv_disp_drv_t drv;
+
+void oled_fields_redraw_area(const lv_area_t *area)
+{
+    (void) area;
+}
+
+static void clear(void)
+{
+    memset(buf, 1, sizeof(buf));
+}
+
+static void light(int x, int y)
+{
+    buf[y * OLED_WIDTH + x].full = 0;
+}
+
+static void flush_all(void)
+{
+    lv_area_t area = { 0, 0, OLED_WIDTH - 1, OLED_HEIGHT - 1 };
+    oled_flush(&drv, &area, buf);
+}
+
+/* the command then data transaction of one window, from transaction `index` */
+static void check_window(int index, uint8_t page, uint8_t first, uint8_t last, const uint8_t *data)
+{
+    const FakeI2cTransaction *cmd = fake_i2c_get(index);
+    const FakeI2cTransaction *dat = fake_i2c_get(index + 1);
+    const uint8_t window[] = { ADDR_WRITE, CMD_STREAM, 0x21, first, last, 0x22, page, page };
+
+    CHECK(cmd != NULL && dat != NULL);
+    if (cmd == NULL || dat == NULL) {
+        return;
+    }
+    CHECK_EQ(cmd->len, sizeof(window));
+    CHECK(memcmp(cmd->bytes, window, sizeof(window)) == 0);
+    CHECK_EQ(dat->len, 2 + last - first + 1);
+    CHECK_EQ(dat->bytes[0], ADDR_WRITE);
+    CHECK_EQ(dat->bytes[1], DATA_STREAM);
+    CHECK(memcmp(&dat->bytes[2], data, last - first + 1) == 0);
+}
+
+static void test_first_flush_sends_every_page(void)
+{
+    uint8_t expected[OLED_WIDTH];
+
+    clear();
+    light(5, 10);
+    light(127, 63);
+    fake_i2c_reset();
+    flush_all();
+
+    CHECK_EQ(fake_i2c_count(), 2 * OLED_PAGES);
+    for (int page = 0; page < OLED_PAGES; page++) {
+        const FakeI2cTransaction *cmd = fake_i2c_get(2 * page);
+        const FakeI2cTransaction *dat = fake_i2c_get(2 * page + 1);
+        const uint8_t window[] = { ADDR_WRITE, CMD_STREAM, 0x20, 0x00, 0x21, 0, OLED_WIDTH - 1, 0x22, page, page };
+
+        CHECK_EQ(cmd->len, sizeof(window));
+        CHECK(memcmp(cmd->bytes, window, sizeof(window)) == 0);
+
+        memset(expected, 0, sizeof(expected));
+        if (page == 1) {
+            expected[5] = 1U << 2;
+        }
+        if (page == 7) {
+            expected[127] = 1U << 7;
+        }
+        CHECK_EQ(dat->len, 2 + OLED_WIDTH);
+        CHECK(memcmp(&dat->bytes[2], expected, OLED_WIDTH) == 0);
+    }
+}
+
+static void test_identical_flush_sends_nothing(void)
+{
+    OledFlushStats before, after;
+
+    oled_get_flush_stats(&before);
+    fake_i2c_reset();
+    flush_all();
+    CHECK_EQ(fake_i2c_count(), 0);
+    oled_get_flush_stats(&after);
+    CHECK_EQ(after.frames - before.frames, 1);
+    CHECK_EQ(after.windows - before.windows, 0);
+    CHECK_EQ(after.last_frame_bytes, 0);
+}
+
+static void test_one_pixel_sends_one_window(void)
+{
+    const uint8_t data[] = { 1U << 4 };
+
+    light(40, 20);
+    fake_i2c_reset();
+    flush_all();
+    CHECK_EQ(fake_i2c_count(), 2);
+    check_window(0, 2, 40, 40, data);
+}
+
+static void test_failed_window_is_retried(void)
+{
+    const uint8_t data[] = { 1U << 0 };
+    OledFlushStats before, after;
+
+    oled_get_flush_stats(&before);
+    light(60, 0);
+    fake_i2c_reset();
+    fake_i2c_fail_next(1, ESP_ERR_TIMEOUT);
+    flush_all();
+    CHECK_EQ(fake_i2c_count(), 1); // the command failed, no data sent
+    oled_get_flush_stats(&after);
+    CHECK_EQ(after.errors - before.errors, 1);
+
+    fake_i2c_reset();
+    CHECK(oled_commit());
+    CHECK_EQ(fake_i2c_count(), 2);
+    check_window(0, 0, 60, 60, data);
+
+    fake_i2c_reset();
+    CHECK(!oled_commit());
+    CHECK_EQ(fake_i2c_count(), 0);
+}
+
+static void test_partial_area_is_packed(void)
+{
+    /* an 8 x 8 area at column 8, page 2, with a diagonal lit */
+    lv_area_t area = { 8, 16, 15, 23 };
+    lv_color_t part[8 * 8] __attribute__((aligned(4)));
+    uint8_t expected[8];
+
+    memset(part, 1, sizeof(part));
+    for (int i = 0; i < 8; i++) {
+        part[i * 8 + i].full = 0;
+        expected[i] = 1U << i;
+    }
+    fake_i2c_reset();
+    oled_flush(&drv, &area, part);
+    CHECK_EQ(fake_i2c_count(), 2);
+    check_window(0, 2, 8, 15, expected);
+}
+
+static void test_rounder_aligns_to_pages_and_words(void)
+{
+    lv_area_t area = { 5, 9, 10, 17 };
+
+    oled_rounder(&drv, &area);
+    CHECK_EQ(area.x1, 4);
+    CHECK_EQ(area.x2, 11);
+    CHECK_EQ(area.y1, 8);
+    CHECK_EQ(area.y2, 23);
+}
+
+int main(void)
+{
+    RUN(test_first_flush_sends_every_page);
+    RUN(test_identical_flush_sends_nothing);
+    RUN(test_one_pixel_sends_one_window);
+    RUN(test_failed_window_is_retried);
+    RUN(test_partial_area_is_packed);
+    RUN(test_rounder_aligns_to_pages_and_words);
+    return HOST_TEST_EXIT();
+}
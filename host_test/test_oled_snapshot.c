@@ -0,0 +1,319 @@
+/*
+ * oled snapshot: the dashboard rendered as the gui task renders it - servo and link
+ * events posted through the ipc table in app.c, then dashboard_apply, lvgl (the fake in
+ * fakes/fake_lvgl.c), oled_flush with the glyph fields, and oled_commit onto the fake
+ * bus. the last frame is written by oled_write_pbm and compared with the committed
+ * golden tools/golden/host_dashboard.pbm. each frame's render time, bytes and windows
+ * are printed.
+ *
+ * the fake lvgl draws in a 5x7 font, so the golden has the board's layout and the
+ * windows it sends, not its glyphs.
+ *
+ *   test_oled_snapshot                    compare with the golden
+ *   test_oled_snapshot --update           rewrite the golden, check it by eye before committing
+ *   test_oled_snapshot --capture <file>   also write a serial capture of the snapshot, with CR LF
+ *                                         and log lines between rows, for tools/gui_snapshot.py
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_test.h"
+
+#include "app.h"
+#include "boot_profile.h"
+#include "fake_i2c.h"
+#include "gui_benchmark.h"
+#include "gui_dashboard.h"
+#include "http_calls.h"
+#include "oled_ssd1306.h"
+#include "supervisor.h"
+#include "uros_task.h"
+
+#define PBM_MAX 10000
+#define FRAME_MS 40   // the gui task's 25 fps cap
+
+typedef struct Frame {
+    uint32_t render_us;
+    uint32_t bytes;
+    uint32_t windows;
+    uint8_t pages;     // pages sent, bit per page
+} Frame;
+
+static lv_color_t buf[OLED_DRAW_BUF_PX] __attribute__((aligned(4)));
+static char pbm[PBM_MAX];   // the snapshot of the last frame
+static size_t pbmLen;
+
+/* appMain is not run, the tasks it starts are not part of this test */
+void boot_profile_init(void)
+{
+}
+
+void boot_mark(BootPhase phase)
+{
+    (void) phase;
+}
+
+esp_err_t supervisor_start(void)
+{
+    return ESP_OK;
+}
+
+void http_calls_init(void)
+{
+}
+
+void uros_start(void)
+{
+}
+
+void guiTask(void *arg)
+{
+    (void) arg;
+}
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* the pages the windows on the fake bus since the last reset went to */
+static uint8_t pages_sent(void)
+{
+    uint8_t pages = 0;
+
+    for (int i = 0; i < fake_i2c_count(); i++) {
+        const FakeI2cTransaction *t = fake_i2c_get(i);
+        if (t->len >= 8 && t->bytes[1] == 0x00 && t->bytes[t->len - 3] == 0x22) {
+            pages |= 1U << t->bytes[t->len - 2];
+        }
+    }
+    return pages;
+}
+
+static void setup(void)
+{
+    static lv_disp_buf_t disp_buf;
+    lv_disp_drv_t disp_drv;
+
+    lv_init();
+    lv_disp_buf_init(&disp_buf, buf, NULL, OLED_DRAW_BUF_PX);
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.flush_cb = oled_flush;
+    disp_drv.rounder_cb = oled_rounder;
+    disp_drv.buffer = &disp_buf;
+    lv_disp_drv_register(&disp_drv);
+
+    dashboard_create(lv_disp_get_scr_act(NULL));
+    lv_task_set_prio(lv_disp_get_default()->refr_task, LV_TASK_PRIO_OFF);
+}
+
+/* one pass of the gui task's render_frame with a refresh, `ms` after the last */
+static Frame render(const char *name, uint32_t ms)
+{
+    ServoDisplayState states[kServoChannelCount];
+    OledFlushStats before, after;
+    int servo_num;
+    Frame f;
+
+    lv_tick_inc(ms);
+    oled_get_flush_stats(&before);
+    fake_i2c_reset();
+
+    uint64_t start = now_us();
+    uint32_t dirty = gui_ipc_take_dirty(states, &servo_num);
+    dashboard_apply(states, dirty, servo_num);
+    lv_task_handler();
+    lv_refr_now(NULL);
+    oled_commit();
+    f.render_us = (uint32_t)(now_us() - start);
+
+    oled_get_flush_stats(&after);
+    f.bytes = after.bytes - before.bytes;
+    f.windows = after.windows - before.windows;
+    f.pages = pages_sent();
+    printf("  %-28s %6uus %5u bytes %2u windows  pages %02x\n", name, f.render_us, f.bytes, f.windows, f.pages);
+    return f;
+}
+
+static void snapshot(void)
+{
+    FILE *f = tmpfile();
+
+    oled_write_pbm(f);
+    rewind(f);
+    pbmLen = fread(pbm, 1, sizeof(pbm) - 1, f);
+    pbm[pbmLen] = '\0';
+    fclose(f);
+}
+
+static char pixel(int x, int y)
+{
+    return pbm[strlen("P1\n128 64\n") + y * (OLED_WIDTH + 1) + x];
+}
+
+static void test_first_frame_sends_the_whole_panel(void)
+{
+    Frame f = render("first frame", FRAME_MS);
+
+    CHECK_EQ(f.windows, OLED_PAGES);
+    CHECK_EQ(f.pages, 0xff);
+    /* address, control, memory mode and window commands, then address, control and 128 columns */
+    CHECK_EQ(f.bytes, OLED_PAGES * (2 + 2 + 6 + 2 + OLED_WIDTH));
+}
+
+static void test_idle_frame_sends_nothing(void)
+{
+    Frame f = render("idle", FRAME_MS);
+
+    CHECK_EQ(f.bytes, 0);
+    CHECK_EQ(f.windows, 0);
+}
+
+static void test_one_servo_sends_its_bar_and_readout(void)
+{
+    gui_ipc_post_servo_angle(3, 90);
+    Frame f = render("servo 3 to 90", FRAME_MS);
+
+    /* the half of the bar that filled (pages 4-5) and the readout's text rows (page 6) */
+    CHECK_EQ(f.pages, 0x70);
+    CHECK_EQ(f.windows, 3);
+    CHECK(f.bytes < OLED_FRAME_BYTES / 8);
+}
+
+static void test_link_up_sends_the_status_page(void)
+{
+    gui_ipc_post_link_state(true);
+    Frame f = render("link up", FRAME_MS);
+
+    /* the status text only reaches into page 0 */
+    CHECK_EQ(f.pages, 0x01);
+}
+
+static void test_every_channel(void)
+{
+    for (int ch = 0; ch < kServoChannelCount; ch++) {
+        gui_ipc_post_servo_angle(ch, ch * 12);
+    }
+    gui_ipc_post_servo_angle(15, 180);
+    render("16 channels", FRAME_MS);
+
+    /* a second later the status task shows the command rate */
+    Frame f = render("status rate", 1000);
+    CHECK_EQ(f.pages, 0x01);
+
+    snapshot();
+    CHECK_EQ(pixel(15 * 8 + 3, 16 + 2), '1');  // channel 15 at 180 is filled to the top
+    CHECK_EQ(pixel(0 * 8 + 3, 16 + 2), '0');   // channel 0 at 0 is empty
+    CHECK_EQ(pixel(0 * 8 + 3, 16 + 29), '0');
+    CHECK_EQ(pixel(0 * 8 + 1, 16 + 29), '1');  // but has its outline
+}
+
+static void test_snapshot_is_plain_text(void)
+{
+    const char *row = strchr(strchr(pbm, '\n') + 1, '\n') + 1;
+    int rows = 0;
+
+    CHECK(strncmp(pbm, "P1\n128 64\n", 10) == 0);
+    CHECK_EQ(strspn(pbm + 10, "01\n"), strlen(pbm + 10));
+    for (const char *end; (end = strchr(row, '\n')) != NULL; row = end + 1) {
+        CHECK_EQ(end - row, OLED_WIDTH);
+        rows++;
+    }
+    CHECK_EQ(rows, OLED_HEIGHT);
+}
+
+static size_t read_file(const char *path, char *out, size_t size)
+{
+    FILE *f = fopen(path, "rb");
+    size_t len;
+
+    if (f == NULL) {
+        return 0;
+    }
+    len = fread(out, 1, size - 1, f);
+    out[len] = '\0';
+    fclose(f);
+    return len;
+}
+
+static void test_matches_golden(void)
+{
+    static char golden[PBM_MAX];
+    size_t golden_len = read_file(GOLDEN_PBM, golden, sizeof(golden));
+
+    CHECK(golden_len > 0);
+    CHECK_EQ(golden_len, pbmLen);
+    CHECK(memcmp(golden, pbm, pbmLen) == 0);
+    if (golden_len != pbmLen || memcmp(golden, pbm, pbmLen) != 0) {
+        fprintf(stderr, "snapshot differs from %s - if the change is intended, run with --update\n", GOLDEN_PBM);
+    }
+}
+
+/* the snapshot as a monitor would capture it: an older snapshot first, CR LF, colour and stray log lines */
+static void write_capture(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    int line = 0;
+
+    CHECK(f != NULL);
+    if (f == NULL) {
+        return;
+    }
+    fprintf(f, "\x1b[0;32mI (312) gui_task: gui up\x1b[0m\r\n");
+    fprintf(f, "\r\n%s\r\nP1\r\n2 1\r\n10\r\n%s\r\n", GUI_BENCHMARK_PBM_BEGIN, GUI_BENCHMARK_PBM_END);
+    fprintf(f, "\r\n%s\r\n", GUI_BENCHMARK_PBM_BEGIN);
+    for (const char *p = pbm, *end; (end = strchr(p, '\n')) != NULL; p = end + 1, line++) {
+        if (line == 1 || line == 20) {
+            fprintf(f, "\x1b[0;33mW (10412) PCA9685: servo 3..5 write failed: ESP_FAIL\x1b[0m\r\n");
+        }
+        fprintf(f, "%.*s\r\n", (int) (end - p), p);
+    }
+    fprintf(f, "\r\n%s\r\n", GUI_BENCHMARK_PBM_END);
+    fprintf(f, "I (10502) gui_bench: done\r\n");
+    fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+    const char *capture = NULL;
+    int update = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = 1;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture = argv[++i];
+        }
+    }
+
+    setup();
+    printf("frames:\n");
+    RUN(test_first_frame_sends_the_whole_panel);
+    RUN(test_idle_frame_sends_nothing);
+    RUN(test_one_servo_sends_its_bar_and_readout);
+    RUN(test_link_up_sends_the_status_page);
+    RUN(test_every_channel);
+
+    if (update) {
+        FILE *f = fopen(GOLDEN_PBM, "wb");
+        if (f == NULL) {
+            perror(GOLDEN_PBM);
+            return 1;
+        }
+        fwrite(pbm, 1, pbmLen, f);
+        fclose(f);
+        printf("wrote %s\n", GOLDEN_PBM);
+        return 0;
+    }
+
+    RUN(test_snapshot_is_plain_text);
+    RUN(test_matches_golden);
+    if (capture != NULL) {
+        write_capture(capture);
+    }
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,149 @@
+/*
+ * ros arena: stack-like allocation, in place growth of the top block, and heap fallback.
+ * every test leaves the arena empty for the next.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "host_test.h"
+
+#include "ros_arena.h"
+
+#define HEADER 8 // BlockHeader in ros_arena.c
+
+static rcl_allocator_t arena;
+
+static uint32_t used(void)
+{
+    RosArenaStats stats;
+    ros_arena_get_stats(&stats);
+    return stats.used;
+}
+
+static uint32_t fallbacks(void)
+{
+    RosArenaStats stats;
+    ros_arena_get_stats(&stats);
+    return stats.heap_fallbacks;
+}
+
+static void test_blocks_are_aligned_and_sized(void)
+{
+    char *a = arena.allocate(10, arena.state);
+    char *b = arena.allocate(100, arena.state);
+    char *c = arena.allocate(5, arena.state);
+
+    CHECK(((uintptr_t) a & 7) == 0);
+    CHECK(((uintptr_t) b & 7) == 0);
+    CHECK(((uintptr_t) c & 7) == 0);
+    CHECK_EQ(used(), (HEADER + 16) + (HEADER + 104) + (HEADER + 8));
+
+    arena.deallocate(c, arena.state);
+    arena.deallocate(b, arena.state);
+    arena.deallocate(a, arena.state);
+    CHECK_EQ(used(), 0);
+}
+
+static void test_free_out_of_order_is_reclaimed_with_the_top(void)
+{
+    char *a = arena.allocate(16, arena.state);
+    char *b = arena.allocate(16, arena.state);
+    char *c = arena.allocate(16, arena.state);
+
+    arena.deallocate(b, arena.state);
+    CHECK_EQ(used(), 3 * (HEADER + 16));     // b is under c, only marked
+    arena.deallocate(c, arena.state);
+    CHECK_EQ(used(), HEADER + 16);           // c and the freed b below it go
+    arena.deallocate(a, arena.state);
+    CHECK_EQ(used(), 0);
+}
+
+static void test_realloc_top_block_in_place(void)
+{
+    char *a = arena.allocate(8, arena.state);
+    char *b = arena.allocate(8, arena.state);
+
+    strcpy(b, "abcdefg");
+    char *grown = arena.reallocate(b, 200, arena.state);
+    CHECK(grown == b);
+    CHECK(strcmp(grown, "abcdefg") == 0);
+    CHECK_EQ(used(), (HEADER + 8) + (HEADER + 200));
+
+    char *shrunk = arena.reallocate(grown, 8, arena.state);
+    CHECK(shrunk == b);
+    CHECK_EQ(used(), 2 * (HEADER + 8));
+
+    /* a block under the top moves, keeping its contents */
+    strcpy(a, "1234567");
+    char *moved = arena.reallocate(a, 64, arena.state);
+    CHECK(moved != a);
+    CHECK(strcmp(moved, "1234567") == 0);
+
+    arena.deallocate(moved, arena.state);
+    arena.deallocate(b, arena.state);
+    CHECK_EQ(used(), 0);
+}
+
+static void test_zero_allocate(void)
+{
+    char *dirty = arena.allocate(64, arena.state);
+    memset(dirty, 0xAA, 64);
+    arena.deallocate(dirty, arena.state);
+
+    unsigned char *z = arena.zero_allocate(16, 4, arena.state);
+    int nonzero = 0;
+    for (int i = 0; i < 64; i++) {
+        nonzero += z[i] != 0;
+    }
+    CHECK_EQ(nonzero, 0);
+    CHECK(arena.zero_allocate(SIZE_MAX / 2, 4, arena.state) == NULL);
+    arena.deallocate(z, arena.state);
+    CHECK_EQ(used(), 0);
+}
+
+static void test_overflow_falls_back_to_the_heap(void)
+{
+    uint32_t before = fallbacks();
+    char *big = arena.allocate(ROS_ARENA_SIZE + 1, arena.state);
+
+    CHECK(big != NULL);
+    CHECK_EQ(fallbacks(), before + 1);
+    CHECK_EQ(used(), 0);
+    memset(big, 0, ROS_ARENA_SIZE + 1);
+    arena.deallocate(big, arena.state);   // goes back to the heap, not the arena
+
+    /* growing past the arena moves the block out to the heap */
+    char *small = arena.allocate(8, arena.state);
+    strcpy(small, "kept");
+    char *grown = arena.reallocate(small, ROS_ARENA_SIZE, arena.state);
+    CHECK(grown != NULL && grown != small);
+    CHECK(strcmp(grown, "kept") == 0);
+    CHECK_EQ(fallbacks(), before + 2);
+    CHECK_EQ(used(), 0);
+    arena.deallocate(grown, arena.state);
+}
+
+static void test_peak_is_kept(void)
+{
+    RosArenaStats stats;
+    char *a = arena.allocate(1000, arena.state);
+
+    arena.deallocate(a, arena.state);
+    ros_arena_get_stats(&stats);
+    CHECK_EQ(stats.size, ROS_ARENA_SIZE);
+    CHECK_EQ(stats.used, 0);
+    CHECK(stats.peak >= HEADER + 1000);
+}
+
+int main(void)
+{
+    arena = ros_arena_allocator();
+
+    RUN(test_blocks_are_aligned_and_sized);
+    RUN(test_free_out_of_order_is_reclaimed_with_the_top);
+    RUN(test_realloc_top_block_in_place);
+    RUN(test_zero_allocate);
+    RUN(test_overflow_falls_back_to_the_heap);
+    RUN(test_peak_is_kept);
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,183 @@
+/*
+ * sequence player: the NVS blob encoding, validation and the easing curves.
+ * seq_player.c is built into this test so its static helpers can be reached.
+ */
+#include "host_test.h"
+
+#include "../seq_player.c"
+
+/* the player only talks to servo_command from its task, which the tests never run */
+int servo_command_set_many(ServoCommandSource source, const ServoCommand *cmds, int count)
+{
+    (void) source;
+    (void) cmds;
+    return count;
+}
+
+void servo_command_get_millidegrees(int32_t *millidegrees)
+{
+    memset(millidegrees, 0, kServoChannelCount * sizeof(millidegrees[0]));
+}
+
+static Sequence sample(void)
+{
+    Sequence seq = { .channel_mask = (1U << 0) | (1U << 5) | (1U << 15), .frame_count = 3 };
+
+    for (int f = 0; f < seq.frame_count; f++) {
+        seq.frames[f].duration_ms = 250 * (f + 1);
+        seq.frames[f].easing = f % SEQ_EASING_COUNT;
+        seq.frames[f].angles[0] = 10 * f;
+        seq.frames[f].angles[5] = 180 - 30 * f;
+        seq.frames[f].angles[15] = 90;
+    }
+    return seq;
+}
+
+static void test_encode_decode_round_trip(void)
+{
+    static uint8_t blob[BLOB_MAX_LEN];
+    Sequence in = sample();
+    Sequence out;
+
+    size_t len = encode(&in, blob);
+    CHECK_EQ(len, BLOB_HEADER_LEN + 3 * BLOB_FRAME_LEN(3));
+    CHECK_EQ(blob[0], SEQ_PLAYER_VERSION);
+    CHECK_EQ(decode(blob, len, &out), ESP_OK);
+    CHECK_EQ(out.channel_mask, in.channel_mask);
+    CHECK_EQ(out.frame_count, in.frame_count);
+    CHECK(memcmp(out.frames, in.frames, sizeof(SeqFrame) * in.frame_count) == 0);
+}
+
+static void test_full_sequence_fits_the_blob(void)
+{
+    static uint8_t blob[BLOB_MAX_LEN];
+    static Sequence in, out;
+
+    in.channel_mask = 0xFFFF;
+    in.frame_count = SEQ_PLAYER_MAX_FRAMES;
+    for (int f = 0; f < SEQ_PLAYER_MAX_FRAMES; f++) {
+        in.frames[f].duration_ms = 20;
+        for (int ch = 0; ch < kServoChannelCount; ch++) {
+            in.frames[f].angles[ch] = (f * 7 + ch * 11) % 181;
+        }
+    }
+    CHECK_EQ(encode(&in, blob), BLOB_MAX_LEN);
+    CHECK_EQ(decode(blob, BLOB_MAX_LEN, &out), ESP_OK);
+    CHECK(memcmp(&out, &in, sizeof(in)) == 0);
+}
+
+static void test_decode_rejects_bad_blobs(void)
+{
+    static uint8_t blob[BLOB_MAX_LEN];
+    Sequence in = sample();
+    Sequence out;
+    size_t len = encode(&in, blob);
+
+    CHECK_EQ(decode(blob, 2, &out), ESP_ERR_INVALID_VERSION);
+    CHECK_EQ(decode(blob, len - 1, &out), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(decode(blob, len + 1, &out), ESP_ERR_INVALID_SIZE);
+
+    blob[0] = SEQ_PLAYER_VERSION + 1;
+    CHECK_EQ(decode(blob, len, &out), ESP_ERR_INVALID_VERSION);
+    blob[0] = SEQ_PLAYER_VERSION;
+
+    blob[1] = SEQ_PLAYER_MAX_FRAMES + 1;
+    CHECK_EQ(decode(blob, len, &out), ESP_ERR_INVALID_SIZE);
+    blob[1] = in.frame_count;
+
+    /* first frame's easing, then its channel 0 angle */
+    blob[BLOB_HEADER_LEN + 2] = SEQ_EASING_COUNT;
+    CHECK_EQ(decode(blob, len, &out), ESP_ERR_INVALID_ARG);
+    blob[BLOB_HEADER_LEN + 2] = SEQ_EASE_LINEAR;
+    blob[BLOB_HEADER_LEN + 3] = 181;
+    CHECK_EQ(decode(blob, len, &out), ESP_ERR_INVALID_ARG);
+}
+
+static void test_validate(void)
+{
+    Sequence seq = sample();
+
+    CHECK_EQ(validate(&seq), ESP_OK);
+
+    seq.channel_mask = 0;
+    CHECK_EQ(validate(&seq), ESP_ERR_INVALID_ARG);
+
+    seq = sample();
+    seq.frames[1].angles[5] = -1;
+    CHECK_EQ(validate(&seq), ESP_ERR_INVALID_ARG);
+
+    /* an unused channel may hold anything */
+    seq = sample();
+    seq.frames[1].angles[3] = 500;
+    CHECK_EQ(validate(&seq), ESP_OK);
+
+    /* all jumps would never yield when looping */
+    seq = sample();
+    for (int f = 0; f < seq.frame_count; f++) {
+        seq.frames[f].duration_ms = 0;
+    }
+    CHECK_EQ(validate(&seq), ESP_ERR_INVALID_ARG);
+}
+
+static void test_ease_end_points_and_midpoints(void)
+{
+    for (int e = 0; e < SEQ_EASING_COUNT; e++) {
+        CHECK_EQ(ease(e, 0), 0);
+        CHECK_EQ(ease(e, EASE_ONE), EASE_ONE);
+    }
+    CHECK_EQ(ease(SEQ_EASE_LINEAR, 500), 500);
+    CHECK_EQ(ease(SEQ_EASE_IN, 500), 250);
+    CHECK_EQ(ease(SEQ_EASE_OUT, 500), 750);
+    CHECK_EQ(ease(SEQ_EASE_IN_OUT, 500), 500);
+    CHECK_EQ(ease(SEQ_EASE_STEP, EASE_ONE - 1), 0);
+}
+
+static void test_ease_is_monotonic(void)
+{
+    for (int e = 0; e < SEQ_EASING_COUNT; e++) {
+        int32_t last = ease(e, 0);
+        int backwards = 0;
+
+        for (int32_t p = 1; p <= EASE_ONE; p++) {
+            int32_t now = ease(e, p);
+            backwards += now < last || now > EASE_ONE;
+            last = now;
+        }
+        CHECK_EQ(backwards, 0);
+    }
+    /* in-out is symmetric about the middle */
+    for (int32_t p = 0; p <= EASE_ONE; p += 50) {
+        CHECK(abs(ease(SEQ_EASE_IN_OUT, p) + ease(SEQ_EASE_IN_OUT, EASE_ONE - p) - EASE_ONE) <= 1);
+    }
+}
+
+static void test_store_load_delete(void)
+{
+    Sequence in = sample();
+    static Sequence out;
+
+    CHECK_EQ(seq_player_store("wave", &in), ESP_OK);
+    CHECK_EQ(load("wave", &out), ESP_OK);
+    CHECK_EQ(out.frame_count, in.frame_count);
+    CHECK(memcmp(out.frames, in.frames, sizeof(SeqFrame) * in.frame_count) == 0);
+
+    CHECK_EQ(seq_player_store("", &in), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(seq_player_store("sixteen_chars_xx", &in), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(load("missing", &out), ESP_ERR_NOT_FOUND);
+
+    CHECK_EQ(seq_player_delete("wave"), ESP_OK);
+    CHECK_EQ(load("wave", &out), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(seq_player_delete("wave"), ESP_ERR_NOT_FOUND);
+}
+
+int main(void)
+{
+    RUN(test_encode_decode_round_trip);
+    RUN(test_full_sequence_fits_the_blob);
+    RUN(test_decode_rejects_bad_blobs);
+    RUN(test_validate);
+    RUN(test_ease_end_points_and_midpoints);
+    RUN(test_ease_is_monotonic);
+    RUN(test_store_load_delete);
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,133 @@
+/*
+ * servo command: a batch is one PCA9685 write, and the count returned and added to the
+ * metrics is the channels written, whatever repeats the batch held.
+ */
+#include <string.h>
+
+#include "host_test.h"
+
+#include "app.h"
+#include "app_metrics.h"
+#include "boot_profile.h"
+#include "fake_i2c.h"
+#include "servo_command.h"
+#include "servo_pca9685.h"
+
+static int shown[kServoChannelCount];
+static int posts;
+
+esp_err_t i2c_bus_recover(void)
+{
+    return ESP_OK;
+}
+
+uint32_t i2c_bus_recoveries(void)
+{
+    return 0;
+}
+
+void boot_mark(BootPhase phase)
+{
+    (void) phase;
+}
+
+void gui_ipc_post_servo_angle(int servo_num, int32_t angle)
+{
+    shown[servo_num] = angle;
+    posts++;
+}
+
+static uint32_t counter(MetricCounter c)
+{
+    AppMetrics m;
+
+    metrics_snapshot(&m);
+    return m.counters[c];
+}
+
+static void setup(void)
+{
+    fake_i2c_reset();
+    servo_pca9685_initialise(0x40, SERVO_PWM_ANALOG_HZ);
+    for (int ch = 0; ch < 3; ch++) {
+        set_channel_min_max_pulse_us(ch, 500, 2500, 180);
+    }
+    servo_command_init();
+}
+
+static void test_batch_counts_each_channel(void)
+{
+    const ServoCommand cmds[] = {
+        { 0, SERVO_UNIT_DEGREES, 10 },
+        { 1, SERVO_UNIT_DEGREES, 20 },
+        { 2, SERVO_UNIT_DEGREES, 30 },
+    };
+    uint32_t http = counter(METRIC_SERVO_CMD_HTTP);
+
+    fake_i2c_reset();
+    posts = 0;
+    CHECK_EQ(servo_command_set_many(SERVO_SOURCE_HTTP, cmds, 3), 3);
+    CHECK_EQ(fake_i2c_count(), 1);
+    CHECK_EQ(counter(METRIC_SERVO_CMD_HTTP) - http, 3);
+    CHECK_EQ(posts, 3);
+}
+
+static void test_repeated_channel_counts_once(void)
+{
+    const ServoCommand cmds[] = {
+        { 0, SERVO_UNIT_DEGREES, 10 },
+        { 0, SERVO_UNIT_DEGREES, 90 },
+        { 0, SERVO_UNIT_DEGREES, 45 },
+        { 1, SERVO_UNIT_DEGREES, 60 },
+    };
+    uint32_t http = counter(METRIC_SERVO_CMD_HTTP);
+
+    fake_i2c_reset();
+    posts = 0;
+    CHECK_EQ(servo_command_set_many(SERVO_SOURCE_HTTP, cmds, 4), 2);
+    CHECK_EQ(fake_i2c_count(), 1);
+    CHECK_EQ(counter(METRIC_SERVO_CMD_HTTP) - http, 2);
+    CHECK_EQ(posts, 2);
+    CHECK_EQ(shown[0], 45);   // the last entry for the channel wins
+}
+
+static void test_rejected_entries_are_not_counted(void)
+{
+    const ServoCommand cmds[] = {
+        { 0, SERVO_UNIT_DEGREES, 181 },
+        { 16, SERVO_UNIT_DEGREES, 0 },
+        { 2, SERVO_UNIT_DEGREES, 0 },
+        { 2, SERVO_UNIT_DEGREES, 5 },
+    };
+    uint32_t http = counter(METRIC_SERVO_CMD_HTTP);
+    uint32_t rejected = counter(METRIC_SERVO_CMD_REJECTED);
+
+    CHECK_EQ(servo_command_set_many(SERVO_SOURCE_HTTP, cmds, 4), 1);
+    CHECK_EQ(counter(METRIC_SERVO_CMD_HTTP) - http, 1);
+    CHECK_EQ(counter(METRIC_SERVO_CMD_REJECTED) - rejected, 2);
+}
+
+static void test_failed_write_counts_the_channels(void)
+{
+    const ServoCommand cmds[] = {
+        { 1, SERVO_UNIT_DEGREES, 10 },
+        { 1, SERVO_UNIT_DEGREES, 20 },
+    };
+    uint32_t failed = counter(METRIC_SERVO_CMD_FAILED);
+
+    fake_i2c_reset();
+    fake_i2c_fail_next(1000, ESP_FAIL);
+    CHECK_EQ(servo_command_set_many(SERVO_SOURCE_ROS, cmds, 2), 0);
+    CHECK_EQ(counter(METRIC_SERVO_CMD_FAILED) - failed, 1);
+    fake_i2c_reset();
+}
+
+int main(void)
+{
+    setup();
+    RUN(test_batch_counts_each_channel);
+    RUN(test_repeated_channel_counts_once);
+    RUN(test_rejected_entries_are_not_counted);
+    RUN(test_failed_write_counts_the_channels);
+    return HOST_TEST_EXIT();
+}
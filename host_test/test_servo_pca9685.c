@@ -0,0 +1,242 @@
+/*
+ * servo pca9685: prescale and timing, position conversion, the bytes written for single
+ * and batched channels, and retry, recovery and degraded mode against the fake bus.
+ * the module keeps its state between tests, so they run in order from uninitialised.
+ */
+#include <string.h>
+
+#include "host_test.h"
+
+#include "esp_timer.h"
+#include "fake_i2c.h"
+#include "i2c_bus.h"
+#include "pca9685.h"
+#include "servo_pca9685.h"
+
+#define ADDR 0x40
+#define ADDR_WRITE (ADDR << 1)
+
+static int recoveries;
+
+esp_err_t i2c_bus_recover(void)
+{
+    recoveries++;
+    return ESP_OK;
+}
+
+uint32_t i2c_bus_recoveries(void)
+{
+    return recoveries;
+}
+
+static void test_position_before_initialise(void)
+{
+    uint16_t ticks;
+
+    set_channel_min_max_pulse_us(0, 500, 2500, 180);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, 90, &ticks), ESP_ERR_INVALID_STATE);
+}
+
+static void test_prescale_for_frequency(void)
+{
+    CHECK_EQ(prescaleForFrequency(50), 121);
+    CHECK_EQ(prescaleForFrequency(SERVO_PWM_ANALOG_HZ), 101);
+    CHECK_EQ(prescaleForFrequency(SERVO_PWM_DIGITAL_HZ), 30);
+    CHECK_EQ(prescaleForFrequency(SERVO_PWM_DIGITAL_FAST_HZ), 17);
+    CHECK_EQ(prescaleForFrequency(1000), 5);
+    CHECK_EQ(prescaleForFrequency(1526), 3);
+    CHECK_EQ(prescaleForFrequency(40000), 3);
+    CHECK_EQ(prescaleForFrequency(1), 255);
+    CHECK_EQ(prescaleForFrequency(0), 255);
+}
+
+static void test_initialise_writes_the_prescale(void)
+{
+    ServoPwmInfo info;
+    bool found = false;
+
+    fake_i2c_reset();
+    servo_pca9685_initialise(ADDR, SERVO_PWM_ANALOG_HZ);
+
+    for (int i = 0; i < fake_i2c_count(); i++) {
+        const FakeI2cTransaction *t = fake_i2c_get(i);
+        CHECK_EQ(t->bytes[0], ADDR_WRITE);
+        if (t->len == 3 && t->bytes[1] == PRE_SCALE) {
+            CHECK_EQ(t->bytes[2], 101);
+            found = true;
+        }
+    }
+    CHECK(found);
+
+    servo_pca9685_get_pwm_info(&info);
+    CHECK_EQ(info.requested_hz, SERVO_PWM_ANALOG_HZ);
+    CHECK_EQ(info.prescale, 101);
+    CHECK_EQ(info.period_us, 16711);
+    CHECK_EQ(info.step_ns, 4080);
+    CHECK_EQ(info.actual_mhz, 59838);
+}
+
+static void test_position_to_ticks(void)
+{
+    uint16_t ticks = 0;
+
+    set_channel_min_max_pulse_us(0, 500, 2500, 180);
+
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, 0, &ticks), ESP_OK);
+    CHECK_EQ(ticks, 123);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, 90, &ticks), ESP_OK);
+    CHECK_EQ(ticks, 368);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, 180, &ticks), ESP_OK);
+    CHECK_EQ(ticks, 613);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_MILLIDEGREES, 45000, &ticks), ESP_OK);
+    CHECK_EQ(ticks, 245);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_US, 1500, &ticks), ESP_OK);
+    CHECK_EQ(ticks, 368);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_TICKS, 400, &ticks), ESP_OK);
+    CHECK_EQ(ticks, 400);
+
+    ticks = 1;
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, 181, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, -1, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_MILLIDEGREES, 180001, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_US, 499, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_US, 2501, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_TICKS, 122, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_TICKS, 614, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_COUNT, 0, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(1, SERVO_UNIT_DEGREES, 0, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(servo_pca9685_position_to_ticks(16, SERVO_UNIT_DEGREES, 0, &ticks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(ticks, 1); // untouched on error
+}
+
+static void test_ticks_to_millidegrees(void)
+{
+    uint32_t step = servo_pca9685_resolution_millidegrees(0);
+
+    CHECK_EQ(step, 367);
+    CHECK_EQ(servo_pca9685_resolution_millidegrees(1), 0);
+    for (int32_t deg = 0; deg <= 180; deg += 15) {
+        uint16_t ticks;
+        CHECK_EQ(servo_pca9685_position_to_ticks(0, SERVO_UNIT_DEGREES, deg, &ticks), ESP_OK);
+        int32_t back = servo_pca9685_ticks_to_millidegrees(0, ticks);
+        CHECK(back >= deg * 1000 - (int32_t) step && back <= deg * 1000 + (int32_t) step);
+    }
+    CHECK_EQ(servo_pca9685_ticks_to_millidegrees(0, 0), 0);
+    CHECK_EQ(servo_pca9685_ticks_to_millidegrees(0, 4095), 180000);
+    CHECK_EQ(servo_pca9685_ticks_to_millidegrees(1, 368), 0);
+}
+
+static void test_single_write(void)
+{
+    fake_i2c_reset();
+    CHECK_EQ(set_pca9685_servo_angle(0, 90), ESP_OK);
+    CHECK_EQ(fake_i2c_count(), 1);
+
+    const FakeI2cTransaction *t = fake_i2c_get(0);
+    const uint8_t expected[] = { ADDR_WRITE, LED0_ON_L, 0, 0, 368 & 0xff, 368 >> 8 };
+    CHECK_EQ(t->len, sizeof(expected));
+    CHECK(memcmp(t->bytes, expected, sizeof(expected)) == 0);
+    CHECK_EQ(t->ticks, PCA9685_I2C_DEADLINE_TICKS(6));
+
+    CHECK_EQ(set_pca9685_servo_angle(0, 181), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(set_pca9685_servo_angle(1, 0), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(set_pca9685_servo_ticks(16, 300), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(fake_i2c_count(), 1);
+}
+
+static void test_batch_carries_the_channels_between(void)
+{
+    uint16_t ticks[16] = { 0 };
+
+    CHECK_EQ(set_pca9685_servo_ticks(4, 300), ESP_OK);
+    fake_i2c_reset();
+
+    ticks[3] = 0x123;
+    ticks[5] = 0x456;
+    CHECK_EQ(set_pca9685_servo_ticks_many((1U << 3) | (1U << 5), ticks), ESP_OK);
+    CHECK_EQ(fake_i2c_count(), 1);
+
+    const FakeI2cTransaction *t = fake_i2c_get(0);
+    const uint8_t expected[] = {
+        ADDR_WRITE, LED0_ON_L + LED_MULTIPLYER * 3,
+        0, 0, 0x23, 0x01,           // channel 3
+        0, 0, 300 & 0xff, 300 >> 8, // channel 4, its last steps
+        0, 0, 0x56, 0x04,           // channel 5
+    };
+    CHECK_EQ(t->len, sizeof(expected));
+    CHECK(memcmp(t->bytes, expected, sizeof(expected)) == 0);
+    CHECK_EQ(t->ticks, PCA9685_I2C_DEADLINE_TICKS(sizeof(expected)));
+
+    CHECK_EQ(set_pca9685_servo_ticks_many(0, ticks), ESP_OK);
+    CHECK_EQ(fake_i2c_count(), 1);
+}
+
+static void test_deadline_covers_the_payload(void)
+{
+    CHECK_EQ(PCA9685_I2C_WIRE_MS(6), 1);
+    CHECK_EQ(PCA9685_I2C_WIRE_MS(66), 6);
+    /* never shorter than the wire time plus the wait, whatever the tick rate rounds to */
+    for (int bytes = 2; bytes <= 2 + 4 * 16; bytes++) {
+        CHECK(PCA9685_I2C_DEADLINE_TICKS(bytes) * portTICK_PERIOD_MS
+              >= PCA9685_I2C_WIRE_MS(bytes) + PCA9685_I2C_WAIT_MS);
+    }
+}
+
+static void test_retry_recover_and_degrade(void)
+{
+    ServoBusStats before, after;
+
+    fake_time_advance_us(2 * 1000 * 1000);
+    servo_pca9685_get_bus_stats(&before);
+
+    /* two failures then a success - retried within the one command */
+    fake_i2c_reset();
+    fake_i2c_fail_next(2, ESP_ERR_TIMEOUT);
+    CHECK_EQ(set_pca9685_servo_ticks(0, 200), ESP_OK);
+    CHECK_EQ(fake_i2c_count(), 3);
+    servo_pca9685_get_bus_stats(&after);
+    CHECK_EQ(after.retries - before.retries, 2);
+    CHECK_EQ(after.failures - before.failures, 0);
+    CHECK(!after.degraded);
+
+    /* a command failing every attempt recovers the bus, once per interval */
+    int recovered = recoveries;
+    fake_i2c_reset();
+    fake_i2c_fail_next(3 * 3, ESP_FAIL);
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQ(set_pca9685_servo_ticks(0, 200), ESP_FAIL);
+    }
+    CHECK_EQ(fake_i2c_count(), 3 * 3);
+    CHECK_EQ(recoveries - recovered, 1);
+    CHECK(servo_pca9685_degraded());
+
+    /* degraded: one attempt per command */
+    fake_i2c_reset();
+    fake_i2c_fail_next(1, ESP_FAIL);
+    CHECK_EQ(set_pca9685_servo_ticks(0, 200), ESP_FAIL);
+    CHECK_EQ(fake_i2c_count(), 1);
+
+    /* the first success leaves degraded mode */
+    CHECK_EQ(set_pca9685_servo_ticks(0, 200), ESP_OK);
+    CHECK_EQ(fake_i2c_count(), 2);
+    CHECK(!servo_pca9685_degraded());
+
+    servo_pca9685_get_bus_stats(&after);
+    CHECK_EQ(after.failures - before.failures, 4);
+    CHECK_EQ(after.recoveries - before.recoveries, 1);
+    CHECK(!after.degraded);
+}
+
+int main(void)
+{
+    RUN(test_position_before_initialise);
+    RUN(test_prescale_for_frequency);
+    RUN(test_initialise_writes_the_prescale);
+    RUN(test_position_to_ticks);
+    RUN(test_ticks_to_millidegrees);
+    RUN(test_single_write);
+    RUN(test_batch_carries_the_channels_between);
+    RUN(test_deadline_covers_the_payload);
+    RUN(test_retry_recover_and_degrade);
+    return HOST_TEST_EXIT();
+}
@@ -1,9 +1,19 @@
 #pragma once
 
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * uncomment to build the esp_http_client examples (http_examples.c) and run them
+ * from http_calls_init. needs howsmyssl_com_root_cert.pem embedded by the build.
+ */
+// #define HTTP_EXAMPLES 1
+
 /**
  * @brief sets up the servo on given pin and initialises the mcpwm module on ESP32 for the pin
  *
@@ -16,19 +26,98 @@ void http_calls_init(void);
 
 
 /**
- * @brief invokes get request on endpointURL and puts the resulting pack in results_buf
+ * @brief called for each piece of response body as it arrives, already de-chunked.
+ *
+ * @param data - the bytes received, only valid during the call
+ * @param len - number of bytes
+ * @param arg - the arg given with the request
+ *
+ * @return ESP_OK to keep receiving. any error stops delivery and is returned by the request.
+ */
+typedef esp_err_t (*http_data_cb_t)(const char *data, int len, void *arg);
+
+/**
+ * @brief invokes get request on endpointURL and puts the response body in results_buf
  *
  * @param  endpointURL - the URL for the endpoint
  * 
- * @param  result_buf - pre-allocated buffer
+ * @param  result_buf - pre-allocated buffer, always nul terminated
  * 
  * @param max_buf_size - the size of the pre-allocated buffer
  *
  * @return
- *     - esp error value. ok or not. 
+ *     - esp error value. ok or not. ESP_ERR_INVALID_SIZE if the body was truncated to fit.
  */
 esp_err_t http_rest_get(char *endpointURL, char *result_buf, uint32_t max_buf_size); 
 
+/**
+ * @brief invokes get request on endpointURL and streams the response body to on_data as it arrives.
+ *
+ * @param  endpointURL - the URL for the endpoint
+ * @param  on_data - receives each piece of the body
+ * @param  arg - passed to on_data
+ * @param  status_code - (optional) the response status
+ *
+ * @return
+ *     - esp error value. ok or not, or the error on_data returned.
+ */
+esp_err_t http_rest_get_stream(const char *endpointURL, http_data_cb_t on_data, void *arg, int *status_code);
+
+/*
+ * counters for the keep-alive client pool
+ */
+typedef struct HttpPoolStats {
+    uint32_t requests;       // requests performed
+    uint32_t reused;         // requests that went out on an already open connection
+    uint32_t connects;       // new connections opened
+    uint32_t reconnects;     // requests retried on a fresh connection after a failure
+    uint32_t failures;       // requests that failed after the retry
+    uint64_t connect_us;     // total time spent connecting (DNS + TCP), divide by connects for the average
+    uint32_t max_connect_us; // slowest connect
+} HttpPoolStats;
+
+/**
+ * @brief perform a request on a pooled, kept-alive connection to the url's host.
+ * the connection is reopened and the request retried once if it fails.
+ * not thread safe - all pooled requests must come from one task, normally the http worker (http_worker.h).
+ *
+ * @param url - full url, the scheme://host:port part selects the pooled connection
+ * @param method - HTTP_METHOD_GET, HTTP_METHOD_POST...
+ * @param post_data - request body or NULL
+ * @param post_len - length of post_data
+ * @param on_data - (optional) receives the response body as it arrives
+ * @param arg - passed to on_data
+ * @param status_code - (optional) the response status
+ *
+ * @return
+ *     - esp error value. ok or not.
+ */
+esp_err_t http_pool_request(const char *url, esp_http_client_method_t method,
+                            const char *post_data, int post_len,
+                            http_data_cb_t on_data, void *arg, int *status_code);
+
+/**
+ * @brief copy out the pool counters. safe to call from any task.
+ */
+void http_pool_get_stats(HttpPoolStats *stats);
+
+/**
+ * @brief close every pooled connection and free the clients.
+ */
+void http_pool_close_all(void);
+
+
+/**
+ * @brief logging event handler shared by every esp_http_client in the app.
+ */
+esp_err_t _http_event_handler(esp_http_client_event_t *evt);
+
+#ifdef HTTP_EXAMPLES
+/**
+ * @brief run the esp_http_client examples once, on their own task.
+ */
+void http_examples_start(void);
+#endif
 
 #ifdef __cplusplus
 }
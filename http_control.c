@@ -0,0 +1,719 @@
+/*
+ * http control and metrics server.
+ *
+ * handlers run on the esp_http_server task. servo commands go through
+ * servo_command_set_many, the same path the ros callbacks use.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+
+#include "app.h"
+#include "app_metrics.h"
+#include "app_ram.h"
+#include "boot_profile.h"
+#include "cmd_recorder.h"
+#include "gui_task.h"
+#include "http_calls.h"
+#include "http_control.h"
+#include "http_worker.h"
+#include "oled_ssd1306.h"
+#include "ros_arena.h"
+#include "seq_player.h"
+#include "servo_command.h"
+#include "servo_pca9685.h"
+#include "supervisor.h"
+#include "trace.h"
+
+#define TAG "http_control"
+
+#define BINARY_RECORD_LEN 3
+
+/***************************
+ * globals
+ ***************************/
+static httpd_handle_t server;
+/* handlers only run on the server task, one at a time */
+static char metricsBuf[HTTP_CONTROL_METRICS_BUF]; // /metrics page, or /trace chunks
+#ifdef SEQ_PLAYER
+static char uploadBody[SEQ_PLAYER_MAX_UPLOAD];   // POST /sequence body
+static Sequence uploadSeq;                       // and its parse
+#endif
+
+typedef struct MetricsWriter {
+    char *buf;
+    size_t len;
+    bool overflow;
+} MetricsWriter;
+
+static void emit(MetricsWriter *w, const char *fmt, ...)
+{
+    va_list args;
+
+    if (w->overflow) {
+        return;
+    }
+    va_start(args, fmt);
+    int n = vsnprintf(w->buf + w->len, sizeof(metricsBuf) - w->len, fmt, args);
+    va_end(args);
+    if (n < 0 || w->len + n >= sizeof(metricsBuf)) {
+        w->overflow = true;
+        return;
+    }
+    w->len += n;
+}
+
+static esp_err_t reply_error(httpd_req_t *req, httpd_err_code_t code, const char *msg)
+{
+    metrics_count(METRIC_HTTP_SERVER_BAD, 1);
+    return httpd_resp_send_err(req, code, msg);
+}
+
+/*
+ * read the whole body into buf. returns its length, or -1 after replying with an error.
+ */
+static int read_body(httpd_req_t *req, char *buf, size_t size)
+{
+    int received = 0;
+
+    if (req->content_len == 0 || req->content_len >= size) {
+        reply_error(req, HTTPD_400_BAD_REQUEST, "body missing or too long");
+        return -1;
+    }
+
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            /* the socket is gone, nothing to reply on */
+            return -1;
+        }
+        received += ret;
+    }
+    buf[received] = '\0';
+
+    return received;
+}
+
+static int parse_binary(const uint8_t *body, int len, ServoUnit unit, ServoCommand *cmds)
+{
+    if (len % BINARY_RECORD_LEN != 0) {
+        return -1;
+    }
+
+    int count = len / BINARY_RECORD_LEN;
+    if (count > kServoChannelCount) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        const uint8_t *rec = &body[i * BINARY_RECORD_LEN];
+        cmds[i].channel = rec[0];
+        cmds[i].unit = unit;
+        cmds[i].value = rec[1] | (rec[2] << 8);
+    }
+
+    return count;
+}
+
+/*
+ * a json number as a command value. degrees may carry a fraction and are then sent
+ * as milli-degrees; every other unit takes whole numbers only. false if the value
+ * has a fraction where none is allowed or does not fit an int32 in its unit.
+ */
+static bool json_position(double value, ServoUnit unit, ServoCommand *cmd)
+{
+    if (unit == SERVO_UNIT_DEGREES && value != floor(value)) {
+        unit = SERVO_UNIT_MILLIDEGREES;
+        value = round(value * 1000);
+    }
+    if (value != floor(value) || value < INT32_MIN || value > INT32_MAX) {
+        return false;
+    }
+    cmd->unit = unit;
+    cmd->value = (int32_t) value;
+    return true;
+}
+
+static int parse_json(const char *body, ServoUnit unit, ServoCommand *cmds)
+{
+    cJSON *root = cJSON_Parse(body);
+    int count = 0;
+
+    if (root == NULL || !cJSON_IsObject(root)) {
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    for (cJSON *item = root->child; item != NULL; item = item->next) {
+        char *end;
+        long channel = strtol(item->string, &end, 10);
+
+        if (count == kServoChannelCount || *end != '\0' || end == item->string ||
+            channel < 0 || channel > UINT8_MAX || !cJSON_IsNumber(item) ||
+            !json_position(item->valuedouble, unit, &cmds[count])) {
+            count = -1;
+            break;
+        }
+        /* valueint is clamped by cJSON, the value is taken from valuedouble only */
+        cmds[count].channel = channel;
+        count++;
+    }
+    cJSON_Delete(root);
+
+    return count;
+}
+
+static bool parse_unit(httpd_req_t *req, ServoUnit *unit)
+{
+    static const char *const names[SERVO_UNIT_COUNT] = {"deg", "mdeg", "us", "ticks"};
+    char query[32];
+    char value[8];
+
+    *unit = SERVO_UNIT_DEGREES;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK
+        || httpd_query_key_value(query, "unit", value, sizeof(value)) != ESP_OK) {
+        return true;
+    }
+    for (int i = 0; i < SERVO_UNIT_COUNT; i++) {
+        if (strcmp(value, names[i]) == 0) {
+            *unit = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t servos_post(httpd_req_t *req)
+{
+    char body[HTTP_CONTROL_MAX_BODY];
+    ServoCommand cmds[kServoChannelCount];
+    char content_type[32] = "";
+    ServoUnit unit;
+    char reply[24];
+    int64_t start = esp_timer_get_time();
+    int count;
+
+    metrics_count(METRIC_HTTP_SERVER_REQUESTS, 1);
+
+    int len = read_body(req, body, sizeof(body));
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+
+    if (!parse_unit(req, &unit)) {
+        return reply_error(req, HTTPD_400_BAD_REQUEST, "unknown unit");
+    }
+
+    httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type));
+    if (strncmp(content_type, "application/octet-stream", strlen("application/octet-stream")) == 0) {
+        count = parse_binary((const uint8_t *) body, len, unit, cmds);
+    } else {
+        count = parse_json(body, unit, cmds);
+    }
+    if (count < 0) {
+        return reply_error(req, HTTPD_400_BAD_REQUEST, "malformed servo list");
+    }
+
+    int applied = servo_command_set_many(SERVO_SOURCE_HTTP, cmds, count);
+
+    snprintf(reply, sizeof(reply), "{\"applied\":%d}", applied);
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t err = httpd_resp_sendstr(req, reply);
+
+    metrics_record_us(METRIC_HIST_HTTP_SERVOS_US, (uint32_t)(esp_timer_get_time() - start));
+    return err;
+}
+
+static esp_err_t servos_post_handler(httpd_req_t *req)
+{
+    TRACE_BEGIN(TRACE_SPAN_HTTP_SERVE);
+    esp_err_t err = servos_post(req);
+    TRACE_END(TRACE_SPAN_HTTP_SERVE);
+
+    return err;
+}
+
+static void emit_histogram(MetricsWriter *w, const char *name, const MetricsHistogram *h)
+{
+    uint32_t cumulative = 0;
+
+    emit(w, "# TYPE %s histogram\n", name);
+    for (int b = 0; b < METRICS_HIST_BUCKETS - 1; b++) {
+        cumulative += h->buckets[b];
+        emit(w, "%s_bucket{le=\"%u\"} %u\n", name, metrics_bucket_limit_us(b), cumulative);
+    }
+    emit(w, "%s_bucket{le=\"+Inf\"} %u\n", name, h->count);
+    emit(w, "%s_sum %llu\n%s_count %u\n", name, h->sum_us, name, h->count);
+    emit(w, "%s_max %u\n", name, h->max_us);
+}
+
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    MetricsWriter w = { .buf = metricsBuf };
+    AppMetrics metrics;
+    GuiIpcStats ipc;
+    GuiStats gui;
+    OledFlushStats flush;
+    HttpPoolStats pool;
+    HttpWorkerStats worker;
+    ServoBusStats bus;
+    ServoPwmInfo pwm;
+
+    metrics_count(METRIC_HTTP_SERVER_REQUESTS, 1);
+
+    /* snapshot everything first so the page is as consistent as it can be */
+    metrics_snapshot(&metrics);
+    gui_ipc_get_stats(&ipc);
+    gui_get_stats(&gui);
+    oled_get_flush_stats(&flush);
+    http_pool_get_stats(&pool);
+    http_worker_get_stats(&worker);
+    servo_pca9685_get_bus_stats(&bus);
+    servo_pca9685_get_pwm_info(&pwm);
+
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        emit(&w, "%s %u\n", metrics_counter_name(c), metrics.counters[c]);
+    }
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        emit_histogram(&w, metrics_histogram_name(h), &metrics.histograms[h]);
+    }
+
+    emit(&w, "gui_ipc_posted %u\ngui_ipc_coalesced %u\ngui_ipc_dropped %u\n",
+         ipc.posted, ipc.coalesced, ipc.dropped);
+    emit(&w, "gui_frames %u\ngui_wakeups %u\ngui_busy_us %llu\ngui_idle_us %llu\ngui_max_frame_us %u\n",
+         gui.frames, gui.wakeups, gui.busy_us, gui.idle_us, gui.max_frame_us);
+    emit(&w, "oled_frames %u\noled_windows %u\noled_bytes %u\noled_max_frame_bytes %u\noled_errors %u\n",
+         flush.frames, flush.windows, flush.bytes, flush.max_frame_bytes, flush.errors);
+    emit(&w, "http_pool_requests %u\nhttp_pool_reused %u\nhttp_pool_connects %u\nhttp_pool_failures %u\n",
+         pool.requests, pool.reused, pool.connects, pool.failures);
+    emit(&w, "http_worker_submitted %u\nhttp_worker_rejected %u\nhttp_worker_failed %u\nhttp_worker_max_depth %u\n",
+         worker.submitted, worker.rejected, worker.failed, worker.max_depth);
+
+    emit(&w, "pca9685_writes %u\npca9685_retries %u\npca9685_failures %u\npca9685_degraded %d\ni2c_bus_recoveries %u\n",
+         bus.writes, bus.retries, bus.failures, bus.degraded, bus.recoveries);
+    emit(&w, "pca9685_pwm_requested_hz %u\npca9685_pwm_prescale %u\npca9685_pwm_frequency_mhz %u\n"
+         "pca9685_pwm_period_us %u\npca9685_pwm_step_ns %u\n",
+         pwm.requested_hz, pwm.prescale, pwm.actual_mhz, pwm.period_us, pwm.step_ns);
+    for (int ch = 0; ch < kServoChannelCount; ch++) {
+        uint32_t resolution = servo_pca9685_resolution_millidegrees(ch);
+        if (resolution != 0) {
+            emit(&w, "servo_resolution_millidegrees{channel=\"%d\"} %u\n", ch, resolution);
+        }
+    }
+    SupervisorStats sup;
+    static SupervisorTaskStats tasks[SUPERVISOR_MAX_TASKS]; // off the server task stack, like metricsBuf
+    supervisor_get_stats(&sup);
+    int taskCount = supervisor_get_tasks(tasks, SUPERVISOR_MAX_TASKS);
+    emit(&w, "supervisor_stalls %u\nsupervisor_stack_warnings %u\ntasks %u\n",
+         sup.stalls, sup.stack_warnings, sup.task_count);
+    for (int t = 0; t < taskCount; t++) {
+        if (sup.run_time_stats) {
+            emit(&w, "task_cpu_percent{task=\"%s\"} %u.%u\n",
+                 tasks[t].name, tasks[t].cpu_permille / 10, tasks[t].cpu_permille % 10);
+        }
+        emit(&w, "task_stack_free_bytes{task=\"%s\"} %u\n", tasks[t].name, tasks[t].stack_free);
+    }
+    for (int o = 0; o < APP_RAM_OWNER_COUNT; o++) {
+        emit(&w, "ram_reserved_bytes{subsystem=\"%s\"} %u\n", app_ram_owner_name(o), app_ram_reserved(o));
+    }
+    emit(&w, "heap_free_bytes %u\nheap_min_free_bytes %u\nheap_largest_free_block_bytes %u\n",
+         esp_get_free_heap_size(), esp_get_minimum_free_heap_size(),
+         heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    RosArenaStats arena;
+    ros_arena_get_stats(&arena);
+    emit(&w, "ros_arena_size_bytes %u\nros_arena_used_bytes %u\nros_arena_peak_bytes %u\nros_arena_heap_fallbacks %u\n",
+         arena.size, arena.used, arena.peak, arena.heap_fallbacks);
+    for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+        uint32_t ms = boot_phase_ms(p);
+        if (ms != 0) {
+            emit(&w, "boot_phase_ms{phase=\"%s\"} %u\n", boot_phase_name(p), ms);
+        }
+    }
+#ifdef CMD_RECORDER
+    CmdRecorderStats rec;
+    cmd_recorder_get_stats(&rec);
+    emit(&w, "cmdlog_recorded %u\ncmdlog_dropped %u\ncmdlog_flash_writes %u\ncmdlog_flash_bytes %u\n"
+         "cmdlog_erases %u\ncmdlog_replayed %u\ncmdlog_replay_errors %u\ncmdlog_replaying %d\n",
+         rec.recorded, rec.dropped, rec.writes, rec.bytes_written,
+         rec.erases, rec.replayed, rec.replay_errors, rec.replaying);
+#endif
+#ifdef SEQ_PLAYER
+    SeqPlayerStats seq;
+    seq_player_get_stats(&seq);
+    emit(&w, "seq_started %u\nseq_completed %u\nseq_frames %u\nseq_writes %u\nseq_late_ticks %u\nseq_playing %d\n",
+         seq.started, seq.completed, seq.frames, seq.writes, seq.late_ticks, seq.playing);
+#endif
+
+    if (w.overflow) {
+        ESP_LOGE(TAG, "metrics page larger than %d bytes", HTTP_CONTROL_METRICS_BUF);
+        return reply_error(req, HTTPD_500_INTERNAL_SERVER_ERROR, "metrics buffer too small");
+    }
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    return httpd_resp_send(req, metricsBuf, w.len);
+}
+
+#ifdef TRACE_ENABLED
+typedef struct ChunkWriter {
+    httpd_req_t *req;
+    size_t len;
+} ChunkWriter;
+
+/*
+ * gather dump lines in metricsBuf so the socket sees a few large chunks rather than one per line.
+ */
+static void trace_chunk(const char *buf, size_t len, void *arg)
+{
+    ChunkWriter *w = (ChunkWriter *) arg;
+
+    if (w->len + len > sizeof(metricsBuf)) {
+        httpd_resp_send_chunk(w->req, metricsBuf, w->len);
+        w->len = 0;
+    }
+    memcpy(metricsBuf + w->len, buf, len);
+    w->len += len;
+}
+
+static esp_err_t trace_get_handler(httpd_req_t *req)
+{
+    ChunkWriter w = { .req = req };
+
+    metrics_count(METRIC_HTTP_SERVER_REQUESTS, 1);
+
+    httpd_resp_set_type(req, "text/plain");
+    trace_dump(trace_chunk, &w);
+    if (w.len > 0) {
+        httpd_resp_send_chunk(req, metricsBuf, w.len);
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static const httpd_uri_t traceUri = {
+    .uri = "/trace",
+    .method = HTTP_GET,
+    .handler = trace_get_handler,
+};
+#endif
+
+#ifdef CMD_RECORDER
+/*
+ * POST /replay?speed=N - replay the newest recorded session, N times faster (0 back to back).
+ * POST /replay?stop=1 - stop a running replay.
+ */
+static esp_err_t replay_post_handler(httpd_req_t *req)
+{
+    char query[32] = "";
+    char value[12];
+    uint32_t speed = 1;
+
+    metrics_count(METRIC_HTTP_SERVER_REQUESTS, 1);
+
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    httpd_resp_set_type(req, "application/json");
+    if (httpd_query_key_value(query, "stop", value, sizeof(value)) == ESP_OK) {
+        cmd_recorder_replay_stop();
+        return httpd_resp_sendstr(req, "{\"replaying\":false}");
+    }
+    if (httpd_query_key_value(query, "speed", value, sizeof(value)) == ESP_OK) {
+        speed = strtoul(value, NULL, 10);
+    }
+
+    if (cmd_recorder_replay(speed) != ESP_OK) {
+        return reply_error(req, HTTPD_400_BAD_REQUEST, "recorder not running or already replaying");
+    }
+    return httpd_resp_sendstr(req, "{\"replaying\":true}");
+}
+
+/*
+ * GET /cmdlog - the raw log partition, for tools/cmdlog.py.
+ */
+static esp_err_t cmdlog_get_handler(httpd_req_t *req)
+{
+    uint32_t size = cmd_recorder_size();
+
+    metrics_count(METRIC_HTTP_SERVER_REQUESTS, 1);
+
+    if (size == 0) {
+        return reply_error(req, HTTPD_500_INTERNAL_SERVER_ERROR, "recorder not running");
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    for (uint32_t offset = 0; offset < size; offset += CMD_RECORDER_SECTOR_SIZE) {
+        if (cmd_recorder_read(offset, metricsBuf, CMD_RECORDER_SECTOR_SIZE) != ESP_OK
+            || httpd_resp_send_chunk(req, metricsBuf, CMD_RECORDER_SECTOR_SIZE) != ESP_OK) {
+            /* the client sees a truncated chunked body */
+            return ESP_FAIL;
+        }
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static const httpd_uri_t replayUri = {
+    .uri = "/replay",
+    .method = HTTP_POST,
+    .handler = replay_post_handler,
+};
+
+static const httpd_uri_t cmdlogUri = {
+    .uri = "/cmdlog",
+    .method = HTTP_GET,
+    .handler = cmdlog_get_handler,
+};
+#endif
+
+#ifdef SEQ_PLAYER
+static const char *easingNames[SEQ_EASING_COUNT] = {
+    [SEQ_EASE_LINEAR] = "linear",
+    [SEQ_EASE_IN] = "in",
+    [SEQ_EASE_OUT] = "out",
+    [SEQ_EASE_IN_OUT] = "in_out",
+    [SEQ_EASE_STEP] = "step",
+};
+
+static int parse_easing(const cJSON *item)
+{
+    if (item == NULL) {
+        return SEQ_EASE_LINEAR;
+    }
+    for (int e = 0; cJSON_IsString(item) && e < SEQ_EASING_COUNT; e++) {
+        if (strcmp(item->valuestring, easingNames[e]) == 0) {
+            return e;
+        }
+    }
+    return -1;
+}
+
+/*
+ * {"channels": [0, 1], "frames": [{"ms": 400, "ease": "in_out", "pose": [90, 30]}, ...]}
+ * pose angles are listed in the order of "channels".
+ */
+static bool parse_sequence(const char *body, Sequence *seq)
+{
+    uint8_t order[kServoChannelCount];
+    int channels = 0;
+    bool ok = false;
+    cJSON *root = cJSON_Parse(body);
+
+    memset(seq, 0, sizeof(*seq));
+    const cJSON *chs = cJSON_GetObjectItem(root, "channels");
+    const cJSON *frames = cJSON_GetObjectItem(root, "frames");
+    if (!cJSON_IsArray(chs) || !cJSON_IsArray(frames) || cJSON_GetArraySize(frames) > SEQ_PLAYER_MAX_FRAMES) {
+        goto done;
+    }
+
+    const cJSON *ch;
+    cJSON_ArrayForEach(ch, chs) {
+        if (!cJSON_IsNumber(ch) || ch->valueint < 0 || ch->valueint >= kServoChannelCount
+            || (seq->channel_mask & (1U << ch->valueint))) {
+            goto done;
+        }
+        seq->channel_mask |= 1U << ch->valueint;
+        order[channels++] = ch->valueint;
+    }
+
+    const cJSON *frame;
+    cJSON_ArrayForEach(frame, frames) {
+        SeqFrame *kf = &seq->frames[seq->frame_count];
+        const cJSON *ms = cJSON_GetObjectItem(frame, "ms");
+        const cJSON *pose = cJSON_GetObjectItem(frame, "pose");
+        int easing = parse_easing(cJSON_GetObjectItem(frame, "ease"));
+
+        if (!cJSON_IsNumber(ms) || ms->valueint < 0 || ms->valueint > UINT16_MAX || easing < 0
+            || !cJSON_IsArray(pose) || cJSON_GetArraySize(pose) != channels) {
+            goto done;
+        }
+        kf->duration_ms = ms->valueint;
+        kf->easing = easing;
+        for (int i = 0; i < channels; i++) {
+            const cJSON *angle = cJSON_GetArrayItem(pose, i);
+            if (!cJSON_IsNumber(angle) || angle->valueint < INT16_MIN || angle->valueint > INT16_MAX) {
+                goto done;
+            }
+            kf->angles[order[i]] = angle->valueint;
+        }
+        seq->frame_count++;
+    }
+    ok = true;
+
+done:
+    cJSON_Delete(root);
+    return ok;
+}
+
+static bool query_name(httpd_req_t *req, char *name, size_t size)
+{
+    char query[48] = "";
+
+    return httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK
+           && httpd_query_key_value(query, "name", name, size) == ESP_OK;
+}
+
+/*
+ * POST /sequence?name=N - store the sequence in the body.
+ * DELETE /sequence?name=N - remove it.
+ */
+static esp_err_t sequence_handler(httpd_req_t *req)
+{
+    char name[SEQ_PLAYER_NAME_LEN + 1];
+    esp_err_t err;
+
+    metrics_count(METRIC_HTTP_SERVER_REQUESTS, 1);
+
+    if (!query_name(req, name, sizeof(name))) {
+        return reply_error(req, HTTPD_400_BAD_REQUEST, "name missing or too long");
+    }
+
+    if (req->method == HTTP_DELETE) {
+        err = seq_player_delete(name);
+    } else {
+        /* sequences are larger than a servo list, so the body and the parse go in static
+         * buffers - handlers run one at a time on the server task */
+        int len = read_body(req, uploadBody, sizeof(uploadBody));
+        if (len < 0) {
+            err = ESP_FAIL;
+        } else if (!parse_sequence(uploadBody, &uploadSeq)) {
+            err = ESP_ERR_INVALID_ARG;
+        } else {
+            err = seq_player_store(name, &uploadSeq);
+        }
+        if (len < 0) {
+            return ESP_FAIL;
+        }
+    }
+
+    if (err == ESP_ERR_NOT_FOUND) {
+        return reply_error(req, HTTPD_404_NOT_FOUND, "no such sequence");
+    }
+    if (err != ESP_OK) {
+        return reply_error(req, HTTPD_400_BAD_REQUEST, esp_err_to_name(err));
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"ok\":true}");
+}
+
+/*
+ * POST /play?name=N[&loops=L] - play a stored sequence L times (default once, 0 repeats).
+ * POST /play?stop=1 - stop playing.
+ */
+static esp_err_t play_post_handler(httpd_req_t *req)
+{
+    char query[48] = "";
+    char name[SEQ_PLAYER_NAME_LEN + 1];
+    char value[8];
+    uint16_t loops = 1;
+
+    metrics_count(METRIC_HTTP_SERVER_REQUESTS, 1);
+
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    httpd_resp_set_type(req, "application/json");
+    if (httpd_query_key_value(query, "stop", value, sizeof(value)) == ESP_OK) {
+        seq_player_stop();
+        return httpd_resp_sendstr(req, "{\"playing\":false}");
+    }
+    if (httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK) {
+        return reply_error(req, HTTPD_400_BAD_REQUEST, "name missing or too long");
+    }
+    if (httpd_query_key_value(query, "loops", value, sizeof(value)) == ESP_OK) {
+        loops = strtoul(value, NULL, 10);
+    }
+
+    esp_err_t err = seq_player_play(name, loops);
+    if (err == ESP_ERR_NOT_FOUND) {
+        return reply_error(req, HTTPD_404_NOT_FOUND, "no such sequence");
+    }
+    if (err != ESP_OK) {
+        return reply_error(req, HTTPD_500_INTERNAL_SERVER_ERROR, esp_err_to_name(err));
+    }
+    return httpd_resp_sendstr(req, "{\"playing\":true}");
+}
+
+static const httpd_uri_t sequencePostUri = {
+    .uri = "/sequence",
+    .method = HTTP_POST,
+    .handler = sequence_handler,
+};
+
+static const httpd_uri_t sequenceDeleteUri = {
+    .uri = "/sequence",
+    .method = HTTP_DELETE,
+    .handler = sequence_handler,
+};
+
+static const httpd_uri_t playUri = {
+    .uri = "/play",
+    .method = HTTP_POST,
+    .handler = play_post_handler,
+};
+#endif
+
+static const httpd_uri_t servosUri = {
+    .uri = "/servos",
+    .method = HTTP_POST,
+    .handler = servos_post_handler,
+};
+
+static const httpd_uri_t metricsUri = {
+    .uri = "/metrics",
+    .method = HTTP_GET,
+    .handler = metrics_get_handler,
+};
+
+esp_err_t http_control_start(void)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    esp_err_t err;
+
+    if (server != NULL) {
+        return ESP_OK;
+    }
+
+    config.server_port = HTTP_CONTROL_PORT;
+    config.max_open_sockets = HTTP_CONTROL_MAX_SOCKETS;
+    config.lru_purge_enable = true;
+    config.max_uri_handlers = HTTP_CONTROL_MAX_HANDLERS;
+
+    err = httpd_start(&server, &config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Couldn't start server: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    httpd_register_uri_handler(server, &servosUri);
+    httpd_register_uri_handler(server, &metricsUri);
+#ifdef TRACE_ENABLED
+    httpd_register_uri_handler(server, &traceUri);
+#endif
+#ifdef CMD_RECORDER
+    httpd_register_uri_handler(server, &replayUri);
+    httpd_register_uri_handler(server, &cmdlogUri);
+#endif
+#ifdef SEQ_PLAYER
+    httpd_register_uri_handler(server, &sequencePostUri);
+    httpd_register_uri_handler(server, &sequenceDeleteUri);
+    httpd_register_uri_handler(server, &playUri);
+#endif
+
+    app_ram_reserve(APP_RAM_HTTP, sizeof(metricsBuf)
+#ifdef SEQ_PLAYER
+                    + sizeof(uploadBody) + sizeof(uploadSeq)
+#endif
+                    );
+    ESP_LOGI(TAG, "listening on port %d", HTTP_CONTROL_PORT);
+    return ESP_OK;
+}
@@ -0,0 +1,44 @@
+/*
+ * http control - an embedded http server as a second control path beside micro ros.
+ *
+ *   POST /servos   set several channels in one request, ?unit=deg (default), mdeg, us or ticks
+ *                  application/octet-stream: 3 byte records, channel then value as uint16 little endian
+ *                  application/json: {"<channel>": value, ...} e.g. {"0": 90, "1": 45.25}
+ *                  fractional degrees in json are applied to the milli-degree, a fraction in
+ *                  any other unit or a value too large for the unit is a 400.
+ *                  replies {"applied": n}
+ *   GET /metrics   counters and latency histograms in the prometheus text format
+ *   GET /trace     the trace ring (trace.h), only with TRACE_ENABLED
+ *   POST /replay   ?speed=N replays the newest recorded session, ?stop=1 stops it. only with CMD_RECORDER
+ *   GET /cmdlog    the raw command log partition (cmd_recorder.h), only with CMD_RECORDER
+ *   POST /sequence ?name=N stores the keyframe sequence in the json body, DELETE removes it
+ *                  {"channels": [0, 1], "frames": [{"ms": 400, "ease": "in_out", "pose": [90, 30]}, ...]}
+ *                  ease is linear (default), in, out, in_out or step. only with SEQ_PLAYER
+ *   POST /play     ?name=N[&loops=L] plays a stored sequence, loops=0 repeats, ?stop=1 stops.
+ *                  only with SEQ_PLAYER
+ *
+ * connections are kept alive between requests; when all sockets are in use the
+ * least recently used one is closed for the new client.
+ */
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_CONTROL_PORT 80
+#define HTTP_CONTROL_MAX_SOCKETS 4
+#define HTTP_CONTROL_MAX_BODY 256     // 16 channels as json with room to spare
+#define HTTP_CONTROL_MAX_HANDLERS 12
+#define HTTP_CONTROL_METRICS_BUF 12288 // the whole /metrics page, built then sent in one write
+
+/**
+ * @brief start the server. the network must be up (http_calls_init).
+ */
+esp_err_t http_control_start(void);
+
+#ifdef __cplusplus
+}
+#endif
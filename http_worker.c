@@ -0,0 +1,149 @@
+/*
+ * http worker task - a bounded request queue in front of the pooled http client.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "app_ram.h"
+#include "http_worker.h"
+#include "trace.h"
+
+#define TAG "http_worker"
+
+typedef struct HttpWorkerRequest {
+    char url[HTTP_WORKER_URL_LEN];
+    esp_http_client_method_t method;
+    const char *post_data;
+    int post_len;
+    http_data_cb_t on_data;
+    http_done_cb_t on_done;
+    void *arg;
+    int64_t enqueued_us;
+} HttpWorkerRequest;
+
+/***************************
+ * globals
+ ***************************/
+static QueueHandle_t requestQueue;
+static StaticQueue_t requestQueueBuffer;
+static uint8_t requestQueueStorage[HTTP_WORKER_QUEUE_DEPTH * sizeof(HttpWorkerRequest)];
+static TaskHandle_t workerTask;
+static StaticTask_t workerTaskBuffer;
+static StackType_t workerStack[HTTP_WORKER_STACK_SIZE];
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static HttpWorkerStats stats;
+
+static void http_worker_task(void *pvParameter)
+{
+    HttpWorkerRequest req;
+    HttpWorkerResult result;
+
+    (void) pvParameter;
+
+    while (1) {
+        if (pdTRUE != xQueueReceive(requestQueue, &req, portMAX_DELAY)) {
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+        result.queue_wait_us = (uint32_t)(start - req.enqueued_us);
+        TRACE_BEGIN(TRACE_SPAN_HTTP_REQUEST);
+        result.err = http_pool_request(req.url, req.method, req.post_data, req.post_len,
+                                       req.on_data, req.arg, &result.status);
+        TRACE_END(TRACE_SPAN_HTTP_REQUEST);
+        result.run_us = (uint32_t)(esp_timer_get_time() - start);
+
+        portENTER_CRITICAL(&statsLock);
+        stats.depth = uxQueueMessagesWaiting(requestQueue);
+        stats.completed++;
+        if (result.err != ESP_OK) {
+            stats.failed++;
+        }
+        stats.queue_wait_us += result.queue_wait_us;
+        if (result.queue_wait_us > stats.max_queue_wait_us) {
+            stats.max_queue_wait_us = result.queue_wait_us;
+        }
+        stats.run_us += result.run_us;
+        if (result.run_us > stats.max_run_us) {
+            stats.max_run_us = result.run_us;
+        }
+        portEXIT_CRITICAL(&statsLock);
+
+        if (req.on_done != NULL) {
+            req.on_done(&result, req.arg);
+        }
+    }
+}
+
+esp_err_t http_worker_start(void)
+{
+    if (workerTask != NULL) {
+        return ESP_OK;
+    }
+
+    requestQueue = xQueueCreateStatic(HTTP_WORKER_QUEUE_DEPTH, sizeof(HttpWorkerRequest),
+                                      requestQueueStorage, &requestQueueBuffer);
+    workerTask = xTaskCreateStatic(http_worker_task, "http_worker", HTTP_WORKER_STACK_SIZE,
+                                   NULL, HTTP_WORKER_PRIORITY, workerStack, &workerTaskBuffer);
+    app_ram_reserve(APP_RAM_HTTP, sizeof(requestQueueBuffer) + sizeof(requestQueueStorage)
+                    + sizeof(workerTaskBuffer) + sizeof(workerStack));
+
+    ESP_LOGI(TAG, "started, queue depth %d, stack %d", HTTP_WORKER_QUEUE_DEPTH, HTTP_WORKER_STACK_SIZE);
+    return ESP_OK;
+}
+
+esp_err_t http_worker_submit(const char *url, esp_http_client_method_t method,
+                             const char *post_data, int post_len,
+                             http_data_cb_t on_data, http_done_cb_t on_done, void *arg)
+{
+    HttpWorkerRequest req = {
+        .method = method,
+        .post_data = post_data,
+        .post_len = post_len,
+        .on_data = on_data,
+        .on_done = on_done,
+        .arg = arg,
+    };
+    esp_err_t err = ESP_OK;
+
+    if (strlen(url) >= sizeof(req.url)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    strcpy(req.url, url);
+    req.enqueued_us = esp_timer_get_time();
+
+    /* zero wait - the caller is never held up by a busy worker */
+    if (requestQueue == NULL || pdTRUE != xQueueSend(requestQueue, &req, 0)) {
+        err = ESP_ERR_NO_MEM;
+    }
+
+    portENTER_CRITICAL(&statsLock);
+    if (err == ESP_OK) {
+        stats.submitted++;
+        stats.depth = uxQueueMessagesWaiting(requestQueue);
+        if (stats.depth > stats.max_depth) {
+            stats.max_depth = stats.depth;
+        }
+    } else {
+        stats.rejected++;
+    }
+    portEXIT_CRITICAL(&statsLock);
+
+    return err;
+}
+
+void http_worker_get_stats(HttpWorkerStats *out)
+{
+    portENTER_CRITICAL(&statsLock);
+    *out = stats;
+    portEXIT_CRITICAL(&statsLock);
+}
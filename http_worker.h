@@ -0,0 +1,80 @@
+/*
+ * http worker - runs HTTP requests on their own task so callers never block on the network.
+ *
+ * requests are copied into a bounded queue and performed one at a time on the
+ * pooled keep-alive client (http_pool_request). submitting never blocks: if the
+ * queue is full the request is rejected and counted.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+#include "http_calls.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_WORKER_QUEUE_DEPTH 4
+#define HTTP_WORKER_STACK_SIZE (6 * 1024) // esp_http_client perform + pool + logging
+#define HTTP_WORKER_PRIORITY 1            // below the executor, network work only runs when it is idle
+#define HTTP_WORKER_URL_LEN 128
+
+typedef struct HttpWorkerResult {
+    esp_err_t err;
+    int status;             // http status, 0 if the request failed
+    uint32_t queue_wait_us; // time spent queued before the worker picked it up
+    uint32_t run_us;        // time spent performing it
+} HttpWorkerResult;
+
+/**
+ * @brief completion callback. runs on the worker task.
+ */
+typedef void (*http_done_cb_t)(const HttpWorkerResult *result, void *arg);
+
+typedef struct HttpWorkerStats {
+    uint32_t submitted;
+    uint32_t rejected;          // queue full, or worker not started
+    uint32_t completed;
+    uint32_t failed;            // completed with an error
+    uint32_t depth;             // requests waiting right now
+    uint32_t max_depth;
+    uint64_t queue_wait_us;     // totals, divide by completed for averages
+    uint32_t max_queue_wait_us;
+    uint64_t run_us;
+    uint32_t max_run_us;
+} HttpWorkerStats;
+
+/**
+ * @brief create the queue and worker task. safe to call more than once.
+ */
+esp_err_t http_worker_start(void);
+
+/**
+ * @brief queue a request. never blocks.
+ *
+ * @param url - copied, at most HTTP_WORKER_URL_LEN - 1 characters
+ * @param method - HTTP_METHOD_GET, HTTP_METHOD_POST...
+ * @param post_data - request body or NULL. not copied - must stay valid until on_done runs
+ * @param post_len - length of post_data
+ * @param on_data - (optional) receives the response body, on the worker task
+ * @param on_done - (optional) called with the result, on the worker task
+ * @param arg - passed to on_data and on_done
+ *
+ * @return
+ *     - ESP_OK if queued, ESP_ERR_INVALID_ARG if the url is too long, ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t http_worker_submit(const char *url, esp_http_client_method_t method,
+                             const char *post_data, int post_len,
+                             http_data_cb_t on_data, http_done_cb_t on_done, void *arg);
+
+/**
+ * @brief copy out the worker counters. safe to call from any task.
+ */
+void http_worker_get_stats(HttpWorkerStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,150 @@
+/*
+ * i2c bus recovery.
+ *
+ * a slave that lost clocks mid byte (a glitch, a brown out, a loose cable) can hold
+ * SDA low forever, and every later transaction then times out. clocking SCL until
+ * SDA is released and sending a STOP puts the slave back to idle.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "esp32/rom/ets_sys.h"
+#include "esp_log.h"
+
+#include "gui_task.h"
+#include "i2c_bus.h"
+
+#define TAG "i2c_bus"
+
+#define RECOVERY_CLOCKS 9      // one byte and its ack bit
+#define RECOVERY_HALF_PERIOD_US 5
+
+/***************************
+ * globals
+ ***************************/
+static volatile uint32_t recoveries;
+
+static void clock_out_stuck_slave(void)
+{
+    gpio_set_direction(I2C_BUS_SDA_PIN, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(I2C_BUS_SDA_PIN, GPIO_PULLUP_ONLY);
+    gpio_set_direction(I2C_BUS_SCL_PIN, GPIO_MODE_OUTPUT_OD);
+    gpio_set_pull_mode(I2C_BUS_SCL_PIN, GPIO_PULLUP_ONLY);
+    gpio_set_level(I2C_BUS_SCL_PIN, 1);
+    ets_delay_us(RECOVERY_HALF_PERIOD_US);
+
+    for (int i = 0; i < RECOVERY_CLOCKS && gpio_get_level(I2C_BUS_SDA_PIN) == 0; i++) {
+        gpio_set_level(I2C_BUS_SCL_PIN, 0);
+        ets_delay_us(RECOVERY_HALF_PERIOD_US);
+        gpio_set_level(I2C_BUS_SCL_PIN, 1);
+        ets_delay_us(RECOVERY_HALF_PERIOD_US);
+    }
+
+    /* STOP: SDA rises while SCL is high */
+    gpio_set_direction(I2C_BUS_SDA_PIN, GPIO_MODE_OUTPUT_OD);
+    gpio_set_level(I2C_BUS_SCL_PIN, 0);
+    gpio_set_level(I2C_BUS_SDA_PIN, 0);
+    ets_delay_us(RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(I2C_BUS_SCL_PIN, 1);
+    ets_delay_us(RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(I2C_BUS_SDA_PIN, 1);
+    ets_delay_us(RECOVERY_HALF_PERIOD_US);
+}
+
+/*
+ * the timing the display driver installed the master with - its clock may not be ours.
+ */
+typedef struct BusTiming {
+    int high, low;                  // SCL period, APB cycles
+    int start_setup, start_hold;
+    int stop_setup, stop_hold;
+    int sample, hold;
+} BusTiming;
+
+static esp_err_t save_timing(BusTiming *t)
+{
+    esp_err_t err = i2c_get_period(I2C_BUS_PORT, &t->high, &t->low);
+
+    if (err == ESP_OK) {
+        err = i2c_get_start_timing(I2C_BUS_PORT, &t->start_setup, &t->start_hold);
+    }
+    if (err == ESP_OK) {
+        err = i2c_get_stop_timing(I2C_BUS_PORT, &t->stop_setup, &t->stop_hold);
+    }
+    if (err == ESP_OK) {
+        err = i2c_get_data_timing(I2C_BUS_PORT, &t->sample, &t->hold);
+    }
+    return err;
+}
+
+static esp_err_t restore_timing(const BusTiming *t)
+{
+    esp_err_t err = i2c_set_period(I2C_BUS_PORT, t->high, t->low);
+
+    if (err == ESP_OK) {
+        err = i2c_set_start_timing(I2C_BUS_PORT, t->start_setup, t->start_hold);
+    }
+    if (err == ESP_OK) {
+        err = i2c_set_stop_timing(I2C_BUS_PORT, t->stop_setup, t->stop_hold);
+    }
+    if (err == ESP_OK) {
+        err = i2c_set_data_timing(I2C_BUS_PORT, t->sample, t->hold);
+    }
+    return err;
+}
+
+esp_err_t i2c_bus_recover(void)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_BUS_SDA_PIN,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = I2C_BUS_SCL_PIN,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = I2C_BUS_CLOCK_HZ,
+    };
+    BusTiming timing;
+    esp_err_t err;
+
+    if (xGuiSemaphore == NULL ||
+        pdTRUE != xSemaphoreTake(xGuiSemaphore, pdMS_TO_TICKS(I2C_BUS_LOCK_WAIT_MS))) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    recoveries++;
+    ESP_LOGW(TAG, "recovering bus (sda %d, scl %d), attempt %u", I2C_BUS_SDA_PIN, I2C_BUS_SCL_PIN, recoveries);
+
+    /* read back what the display driver set up, so the bus comes back at its speed */
+    bool saved = save_timing(&timing) == ESP_OK;
+    if (!saved) {
+        ESP_LOGW(TAG, "installed timing unreadable, reinstalling at %uHz", I2C_BUS_CLOCK_HZ);
+    }
+
+    i2c_driver_delete(I2C_BUS_PORT);
+    clock_out_stuck_slave();
+
+    err = i2c_param_config(I2C_BUS_PORT, &conf);
+    if (err == ESP_OK) {
+        err = i2c_driver_install(I2C_BUS_PORT, I2C_MODE_MASTER, 0, 0, 0);
+    }
+    if (err == ESP_OK && saved) {
+        err = restore_timing(&timing);
+    }
+    xSemaphoreGive(xGuiSemaphore);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Couldn't reinstall i2c driver: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+uint32_t i2c_bus_recoveries(void)
+{
+    return recoveries;
+}
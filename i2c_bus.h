@@ -0,0 +1,55 @@
+/*
+ * i2c bus - recovery for the I2C bus shared by the SSD1306 and the PCA9685.
+ *
+ * the master driver is installed by the lvgl display driver; the pins below must
+ * match its configuration. the clock and timing are read back from the installed
+ * driver before a recovery and restored after it.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_BUS_PORT I2C_NUM_0
+
+#ifdef CONFIG_LV_DISP_PIN_SDA
+#define I2C_BUS_SDA_PIN CONFIG_LV_DISP_PIN_SDA
+#else
+#define I2C_BUS_SDA_PIN 21
+#endif
+
+#ifdef CONFIG_LV_DISP_PIN_SCL
+#define I2C_BUS_SCL_PIN CONFIG_LV_DISP_PIN_SCL
+#else
+#define I2C_BUS_SCL_PIN 22
+#endif
+
+#define I2C_BUS_CLOCK_HZ 400000 // only used if the installed timing cannot be read back
+#define I2C_BUS_LOCK_WAIT_MS 200 // longest wait for the gui to release the bus before giving up
+
+/**
+ * @brief free a stuck bus and reinstall the master driver.
+ *
+ * clocks SCL until a slave holding SDA low lets go, sends a STOP, then reinstalls
+ * the driver with the clock and timing it had. the gui lock is held throughout so
+ * the display is not mid flush.
+ * call from a task, never while holding xGuiSemaphore.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_TIMEOUT if the gui did not release the bus, or the driver install error
+ */
+esp_err_t i2c_bus_recover(void);
+
+/**
+ * @brief number of recoveries attempted so far.
+ */
+uint32_t i2c_bus_recoveries(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,185 @@
+/*
+ * oled_fields - glyph cache and numeric fields blitted straight into the frame.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "oled_fields.h"
+#include "oled_ssd1306.h"
+
+#define TAG "oled_fields"
+
+#define GLYPH_COUNT (sizeof(OLED_GLYPH_CHARSET) - 1)
+#define GLYPH_HEIGHT (OLED_GLYPH_PAGES * 8)
+
+typedef struct OledField {
+    uint8_t page;
+    uint8_t col;
+    uint8_t chars;
+    char shown[OLED_FIELD_MAX_CHARS + 1];
+} OledField;
+
+/***************************
+ * globals
+ ***************************/
+/* one cell per charset entry: OLED_GLYPH_PAGES runs of cellWidth column bytes */
+static uint8_t glyphs[GLYPH_COUNT][OLED_GLYPH_PAGES * OLED_GLYPH_MAX_WIDTH];
+static uint8_t blankGlyph[OLED_GLYPH_PAGES * OLED_GLYPH_MAX_WIDTH];
+static uint8_t cellWidth;
+
+static OledField fields[OLED_FIELD_MAX];
+static int fieldCount;
+
+static const uint8_t *glyph_for(char c)
+{
+    const char *pos = (c == '\0') ? NULL : strchr(OLED_GLYPH_CHARSET, c);
+    return pos ? glyphs[pos - OLED_GLYPH_CHARSET] : blankGlyph;
+}
+
+/*
+ * render one lvgl glyph into a cell. the font bitmap is packed rows of bpp bit
+ * pixels, msb first; anything at least half coverage counts as lit.
+ */
+static void rasterise(const lv_font_t *font, char c, uint8_t *cell)
+{
+    lv_font_glyph_dsc_t dsc;
+
+    memset(cell, 0, OLED_GLYPH_PAGES * cellWidth);
+    if (!lv_font_get_glyph_dsc(font, &dsc, c, 0) || dsc.box_w == 0) {
+        return;
+    }
+    const uint8_t *bmp = lv_font_get_glyph_bitmap(font, c);
+    if (bmp == NULL) {
+        return;
+    }
+
+    uint8_t bpp = dsc.bpp;
+    uint8_t max = (1 << bpp) - 1;
+    int left = dsc.ofs_x + (cellWidth - dsc.adv_w) / 2;
+    int top = (font->line_height - font->base_line) - dsc.box_h - dsc.ofs_y;
+
+    for (int y = 0; y < dsc.box_h; y++) {
+        int py = top + y;
+        if (py < 0 || py >= GLYPH_HEIGHT) {
+            continue;
+        }
+        for (int x = 0; x < dsc.box_w; x++) {
+            int px = left + x;
+            if (px < 0 || px >= cellWidth) {
+                continue;
+            }
+            uint32_t bit = (y * dsc.box_w + x) * bpp;
+            uint8_t value = (bmp[bit >> 3] >> (8 - bpp - (bit & 0x7))) & max;
+            if (value > max / 2) {
+                cell[(py >> 3) * cellWidth + px] |= 1U << (py & 0x7);
+            }
+        }
+    }
+}
+
+uint8_t oled_glyphs_init(const lv_font_t *font)
+{
+    lv_font_glyph_dsc_t dsc;
+
+    cellWidth = 0;
+    for (char c = '0'; c <= '9'; c++) {
+        if (lv_font_get_glyph_dsc(font, &dsc, c, 0) && dsc.adv_w > cellWidth) {
+            cellWidth = dsc.adv_w;
+        }
+    }
+    if (cellWidth == 0 || cellWidth > OLED_GLYPH_MAX_WIDTH) {
+        cellWidth = OLED_GLYPH_MAX_WIDTH;
+    }
+
+    for (size_t i = 0; i < GLYPH_COUNT; i++) {
+        rasterise(font, OLED_GLYPH_CHARSET[i], glyphs[i]);
+    }
+    memset(blankGlyph, 0, sizeof(blankGlyph));
+
+    ESP_LOGI(TAG, "cached %d glyphs, %dx%d cells, %d bytes",
+        (int) GLYPH_COUNT, cellWidth, GLYPH_HEIGHT, (int) (GLYPH_COUNT * OLED_GLYPH_PAGES * cellWidth));
+    return cellWidth;
+}
+
+int oled_field_create(uint8_t page, uint8_t col, uint8_t chars)
+{
+    if (fieldCount >= OLED_FIELD_MAX || chars == 0 || chars > OLED_FIELD_MAX_CHARS
+        || page + OLED_GLYPH_PAGES > OLED_PAGES || col + chars * cellWidth > OLED_WIDTH) {
+        ESP_LOGE(TAG, "no room for field at page %d col %d (%d chars)", page, col, chars);
+        return -1;
+    }
+
+    OledField *field = &fields[fieldCount];
+    field->page = page;
+    field->col = col;
+    field->chars = chars;
+    memset(field->shown, ' ', chars);
+    field->shown[chars] = '\0';
+
+    return fieldCount++;
+}
+
+static void draw_cell(const OledField *field, int i)
+{
+    oled_blit(field->page, field->col + i * cellWidth, glyph_for(field->shown[i]), cellWidth, OLED_GLYPH_PAGES);
+}
+
+void oled_field_set_text(int field_id, const char *text)
+{
+    if (field_id < 0 || field_id >= fieldCount) {
+        return;
+    }
+
+    OledField *field = &fields[field_id];
+    int len = strlen(text);
+    int pad = field->chars - len;
+
+    /* only cells whose character changed are copied into the frame */
+    for (int i = 0; i < field->chars; i++) {
+        char c = (i < pad) ? ' ' : text[i - pad];
+        if (field->shown[i] != c) {
+            field->shown[i] = c;
+            draw_cell(field, i);
+        }
+    }
+}
+
+void oled_field_set_int(int field_id, int32_t value)
+{
+    char text[12];
+
+    if (field_id < 0 || field_id >= fieldCount) {
+        return;
+    }
+
+    int len = snprintf(text, sizeof(text), "%d", value);
+    if (len > fields[field_id].chars) {
+        memset(text, '#', fields[field_id].chars);
+        text[fields[field_id].chars] = '\0';
+    }
+    oled_field_set_text(field_id, text);
+}
+
+void oled_fields_redraw_area(const lv_area_t *area)
+{
+    for (int f = 0; f < fieldCount; f++) {
+        const OledField *field = &fields[f];
+        int x1 = field->col;
+        int x2 = field->col + field->chars * cellWidth - 1;
+        int y1 = field->page * 8;
+        int y2 = y1 + GLYPH_HEIGHT - 1;
+
+        if (area->x2 < x1 || area->x1 > x2 || area->y2 < y1 || area->y1 > y2) {
+            continue;
+        }
+        for (int i = 0; i < field->chars; i++) {
+            draw_cell(field, i);
+        }
+    }
+}
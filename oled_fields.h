@@ -0,0 +1,69 @@
+/*
+ * oled_fields - numeric readouts drawn from a cache of pre-rasterised glyphs.
+ *
+ * the digits and a few symbols are rasterised once from an lvgl font into
+ * page ordered column bytes. a field is a fixed run of character cells on the
+ * page grid; changing its value copies only the cells that differ into the
+ * frame, with no lvgl label relayout or glyph rendering.
+ *
+ * all functions must be called from the gui task.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OLED_GLYPH_CHARSET "0123456789-+.:%# " // '#' marks a value too wide for its field
+#define OLED_GLYPH_PAGES 2                       // cells are 16 pixels tall
+#define OLED_GLYPH_MAX_WIDTH 12
+#define OLED_FIELD_MAX 4
+#define OLED_FIELD_MAX_CHARS 6
+
+/**
+ * @brief rasterise the glyph cache from a font. cells are as wide as the widest digit.
+ *
+ * @param font - the lvgl font to take glyphs from, normally the dashboard label font
+ *
+ * @return the cell width in pixels
+ */
+uint8_t oled_glyphs_init(const lv_font_t *font);
+
+/**
+ * @brief reserve a field on the page grid.
+ *
+ * @param page - top page of the field
+ * @param col - left column
+ * @param chars - number of character cells, at most OLED_FIELD_MAX_CHARS
+ *
+ * @return field id, or -1 if there is no room
+ */
+int oled_field_create(uint8_t page, uint8_t col, uint8_t chars);
+
+/**
+ * @brief show text in a field, right aligned. characters outside the charset show as blank.
+ */
+void oled_field_set_text(int field, const char *text);
+
+/**
+ * @brief show an integer in a field, right aligned. values too wide show as '#'.
+ */
+void oled_field_set_int(int field, int32_t value);
+
+/**
+ * @brief redraw every field overlapping an area lvgl has just flushed. used by oled_flush.
+ */
+void oled_fields_redraw_area(const lv_area_t *area);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,327 @@
+/*
+ * SSD1306 display path with partial page updates.
+ *
+ * the panel memory is 8 pages of 128 columns, one byte per column holding
+ * 8 vertical pixels. lvgl draws either natively (one byte per pixel, packed
+ * into pages here) or into a page ordered buffer via oled_set_px. each flush
+ * is merged into `frame`, and when lvgl finishes a refresh the
+ * frame is compared with `shown` - what the panel last received - so only
+ * the changed column span of each changed page goes over I2C.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "driver/i2c.h"
+#include "esp_log.h"
+
+#include "oled_ssd1306.h"
+#include "oled_fields.h"
+#include "trace.h"
+
+#define TAG "oled"
+
+#define OLED_I2C_PORT I2C_NUM_0         // shared with the PCA9685
+#define OLED_I2C_ADDRESS 0x3C
+#define OLED_I2C_TIMEOUT_TICKS pdMS_TO_TICKS(50)
+
+#define OLED_CONTROL_BYTE_CMD_STREAM 0x00
+#define OLED_CONTROL_BYTE_DATA_STREAM 0x40
+#define OLED_CMD_SET_MEMORY_ADDR_MODE 0x20
+#define OLED_CMD_SET_COLUMN_RANGE 0x21
+#define OLED_CMD_SET_PAGE_RANGE 0x22
+
+#define BIT_SET(a, b) ((a) |= (1U << (b)))
+#define BIT_CLEAR(a, b) ((a) &= ~(1U << (b)))
+
+/***************************
+ * globals
+ ***************************/
+static uint8_t frame[OLED_PAGES][OLED_WIDTH] __attribute__((aligned(4))); // what lvgl has drawn
+static uint8_t shown[OLED_PAGES][OLED_WIDTH]; // what the panel has been sent
+static bool shownValid = false;               // panel contents unknown until the first full send
+
+/* columns touched per page since the last commit, to bound the compare */
+static uint8_t touchedPages;
+static uint8_t touchedMin[OLED_PAGES];
+static uint8_t touchedMax[OLED_PAGES];
+
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static OledFlushStats stats;
+static uint32_t frameBytes;
+
+/*
+ * send one page/column window: address it, then stream the column bytes.
+ */
+static esp_err_t send_window(uint8_t page, uint8_t col_start, uint8_t col_end)
+{
+    uint8_t len = col_end - col_start + 1;
+    uint8_t addr_mode_cmds[] = {
+        OLED_CMD_SET_MEMORY_ADDR_MODE, 0x00, // horizontal addressing
+    };
+    uint8_t window_cmds[] = {
+        OLED_CMD_SET_COLUMN_RANGE, col_start, col_end,
+        OLED_CMD_SET_PAGE_RANGE, page, page,
+    };
+    esp_err_t ret;
+
+    /* address + control + commands, then address + control + data */
+    frameBytes += 2 + (shownValid ? 0 : sizeof(addr_mode_cmds)) + sizeof(window_cmds) + 2 + len;
+
+#ifdef OLED_HEADLESS
+    /* counted above, nothing goes on the bus */
+    (void) addr_mode_cmds;
+    (void) window_cmds;
+    (void) ret;
+    return ESP_OK;
+#else
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (OLED_I2C_ADDRESS << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_STREAM, true);
+    if (!shownValid) {
+        i2c_master_write(cmd, addr_mode_cmds, sizeof(addr_mode_cmds), true);
+    }
+    i2c_master_write(cmd, window_cmds, sizeof(window_cmds), true);
+    i2c_master_stop(cmd);
+    ret = i2c_master_cmd_begin(OLED_I2C_PORT, cmd, OLED_I2C_TIMEOUT_TICKS);
+    i2c_cmd_link_delete(cmd);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (OLED_I2C_ADDRESS << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_DATA_STREAM, true);
+    i2c_master_write(cmd, &frame[page][col_start], len, true);
+    i2c_master_stop(cmd);
+    ret = i2c_master_cmd_begin(OLED_I2C_PORT, cmd, OLED_I2C_TIMEOUT_TICKS);
+    i2c_cmd_link_delete(cmd);
+
+    return ret;
+#endif
+}
+
+/*
+ * compare the touched part of each page with what the panel holds and send the difference.
+ */
+static void commit_frame(void)
+{
+    uint32_t windows = 0;
+    uint32_t errors = 0;
+    uint8_t failedPages = 0;
+
+    TRACE_BEGIN(TRACE_SPAN_OLED_FLUSH);
+    frameBytes = 0;
+    for (uint8_t page = 0; page < OLED_PAGES; page++) {
+        if (!(touchedPages & (1U << page)) && shownValid) {
+            continue;
+        }
+
+        int first = shownValid ? touchedMin[page] : 0;
+        int last = shownValid ? touchedMax[page] : OLED_WIDTH - 1;
+
+        if (shownValid) {
+            while (first <= last && frame[page][first] == shown[page][first]) {
+                first++;
+            }
+            while (last >= first && frame[page][last] == shown[page][last]) {
+                last--;
+            }
+            if (first > last) {
+                continue;
+            }
+        }
+
+        if (send_window(page, first, last) == ESP_OK) {
+            memcpy(&shown[page][first], &frame[page][first], last - first + 1);
+        } else {
+            /* leave shown stale and the window touched so the next commit retries it */
+            failedPages |= 1U << page;
+            touchedMin[page] = first;
+            touchedMax[page] = last;
+            errors++;
+        }
+        windows++;
+    }
+
+    if (errors == 0) {
+        shownValid = true;
+    }
+    touchedPages = failedPages;
+    TRACE_END(TRACE_SPAN_OLED_FLUSH);
+
+    portENTER_CRITICAL(&statsLock);
+    stats.frames++;
+    stats.windows += windows;
+    stats.bytes += frameBytes;
+    stats.errors += errors;
+    stats.last_frame_bytes = frameBytes;
+    if (frameBytes > stats.max_frame_bytes) {
+        stats.max_frame_bytes = frameBytes;
+    }
+    portEXIT_CRITICAL(&statsLock);
+}
+
+void oled_rounder(lv_disp_drv_t *disp_drv, lv_area_t *area)
+{
+    (void) disp_drv;
+
+    area->y1 = area->y1 & ~0x7;
+    area->y2 = area->y2 | 0x7;
+#if OLED_NATIVE_1BPP
+    area->x1 = area->x1 & ~0x3;
+    area->x2 = area->x2 | 0x3;
+#endif
+}
+
+void oled_set_px(lv_disp_drv_t *disp_drv, uint8_t *buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y,
+                 lv_color_t color, lv_opa_t opa)
+{
+    (void) disp_drv;
+
+    uint16_t byte_index = x + ((y >> 3) * buf_w);
+    uint8_t bit_index = y & 0x7;
+
+    if ((color.full == 0) && (LV_OPA_TRANSP != opa)) {
+        BIT_SET(buf[byte_index], bit_index);
+    } else {
+        BIT_CLEAR(buf[byte_index], bit_index);
+    }
+}
+
+#if OLED_NATIVE_1BPP
+/*
+ * pack one page of native pixels into frame bytes.
+ * each source row holds one lv_color_t byte (0 or 1) per column, so a 32 bit load
+ * covers 4 columns; shifting row r into bit r of each byte builds 4 page bytes at once.
+ */
+static void pack_page(uint8_t page, int x1, int words, const uint32_t *rows)
+{
+    uint32_t *dst = (uint32_t *) &frame[page][x1];
+
+    for (int w = 0; w < words; w++) {
+        uint32_t acc = 0;
+        for (int r = 0; r < 8; r++) {
+            acc |= (rows[r * words + w] & 0x01010101U) << r;
+        }
+        /* lvgl white is an unlit pixel */
+        dst[w] = ~acc;
+    }
+}
+#endif
+
+static void mark_touched(uint8_t page, int x1, int x2)
+{
+    uint8_t bit = 1U << page;
+
+    if (!(touchedPages & bit)) {
+        touchedPages |= bit;
+        touchedMin[page] = x1;
+        touchedMax[page] = x2;
+        return;
+    }
+    if (x1 < touchedMin[page]) {
+        touchedMin[page] = x1;
+    }
+    if (x2 > touchedMax[page]) {
+        touchedMax[page] = x2;
+    }
+}
+
+void oled_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p)
+{
+    int width = lv_area_get_width(area);
+    int page_first = area->y1 >> 3;
+    int page_last = area->y2 >> 3;
+
+#if OLED_NATIVE_1BPP
+    const uint32_t *src = (const uint32_t *) color_p;
+    int words = width / 4;
+
+    for (int page = page_first; page <= page_last && page < OLED_PAGES; page++) {
+        pack_page(page, area->x1, words, src);
+        src += 8 * words;
+        mark_touched(page, area->x1, area->x2);
+    }
+#else
+    const uint8_t *src = (const uint8_t *) color_p;
+
+    for (int page = page_first; page <= page_last && page < OLED_PAGES; page++) {
+        memcpy(&frame[page][area->x1], src, width);
+        src += width;
+        mark_touched(page, area->x1, area->x2);
+    }
+#endif
+
+    /* lvgl just painted over whatever glyph fields share this area */
+    oled_fields_redraw_area(area);
+
+    if (lv_disp_flush_is_last(disp_drv)) {
+        commit_frame();
+    }
+
+    lv_disp_flush_ready(disp_drv);
+}
+
+void oled_blit(uint8_t page, uint8_t col, const uint8_t *data, uint8_t width, uint8_t pages)
+{
+    uint8_t copy = width;
+
+    if (col >= OLED_WIDTH) {
+        return;
+    }
+    if (col + copy > OLED_WIDTH) {
+        copy = OLED_WIDTH - col;
+    }
+
+    for (uint8_t p = 0; p < pages && page + p < OLED_PAGES; p++) {
+        memcpy(&frame[page + p][col], &data[p * width], copy);
+        mark_touched(page + p, col, col + copy - 1);
+    }
+}
+
+bool oled_commit(void)
+{
+    if (touchedPages == 0) {
+        return false;
+    }
+    commit_frame();
+    return true;
+}
+
+void oled_get_flush_stats(OledFlushStats *out)
+{
+    portENTER_CRITICAL(&statsLock);
+    *out = stats;
+    portEXIT_CRITICAL(&statsLock);
+}
+
+void oled_write_pbm(FILE *out)
+{
+    char row[OLED_WIDTH + 2];
+
+    fprintf(out, "P1\n%d %d\n", OLED_WIDTH, OLED_HEIGHT);
+
+    /*
+     * one text line per pixel row, transposed from the pages. each line goes out in a
+     * single fputs so a log line from another task can only land between rows.
+     */
+    row[OLED_WIDTH] = '\n';
+    row[OLED_WIDTH + 1] = '\0';
+    for (int y = 0; y < OLED_HEIGHT; y++) {
+        const uint8_t *page = shown[y >> 3];
+        uint8_t bit = 1U << (y & 0x7);
+
+        for (int x = 0; x < OLED_WIDTH; x++) {
+            row[x] = (page[x] & bit) ? '1' : '0';
+        }
+        fputs(row, out);
+    }
+    fflush(out);
+}
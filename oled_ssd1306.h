@@ -0,0 +1,111 @@
+/*
+ * oled_ssd1306 - the display path for the 128x64 SSD1306.
+ *
+ * keeps a copy of what the panel is showing and only sends the page/column
+ * windows that differ, so the I2C bus shared with the PCA9685 is held
+ * for as little time as possible.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OLED_WIDTH 128
+#define OLED_HEIGHT 64
+#define OLED_PAGES (OLED_HEIGHT / 8)
+#define OLED_FRAME_BYTES (OLED_WIDTH * OLED_PAGES)
+
+/*
+ * how lvgl draws for this panel:
+ *  1 - lvgl renders one lv_color_t byte per pixel with its own fill and blend loops,
+ *      oled_flush packs 8 rows into page bytes, 4 columns per 32 bit word.
+ *  0 - lvgl calls oled_set_px for every pixel into a page ordered buffer.
+ */
+#ifndef OLED_NATIVE_1BPP
+#define OLED_NATIVE_1BPP 1
+#endif
+
+/*
+ * OLED_HEADLESS - render and diff exactly as normal but do not touch the panel.
+ * committed windows are only counted, the frame stays in memory for oled_write_pbm().
+ * useful for benchmarking the render path and taking snapshots without a display attached.
+ */
+// #define OLED_HEADLESS 1
+
+/* draw buffer size in pixels for the native path - the whole panel, so refreshes are never split */
+#define OLED_DRAW_BUF_PX (OLED_WIDTH * OLED_HEIGHT)
+
+typedef struct OledFlushStats {
+    uint32_t frames;           // frames committed to the panel
+    uint32_t windows;          // page/column windows transmitted, at most one per page per frame
+    uint32_t bytes;            // total bytes put on the bus, commands included
+    uint32_t last_frame_bytes; // bytes sent for the most recent frame
+    uint32_t max_frame_bytes;  // largest frame sent
+    uint32_t errors;           // I2C transactions that failed
+} OledFlushStats;
+
+/**
+ * @brief lvgl rounder - align the area to whole 8 pixel pages. columns are kept as is,
+ * or aligned to 4 for the native path so rows can be packed a word at a time.
+ */
+void oled_rounder(lv_disp_drv_t *disp_drv, lv_area_t *area);
+
+/**
+ * @brief lvgl set_px - write a pixel into a page ordered draw buffer. only used when OLED_NATIVE_1BPP is 0.
+ */
+void oled_set_px(lv_disp_drv_t *disp_drv, uint8_t *buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y,
+                 lv_color_t color, lv_opa_t opa);
+
+/**
+ * @brief lvgl flush - merge the area into the frame and send what changed since the last flush.
+ */
+void oled_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+
+/**
+ * @brief copy pre-rendered page bytes straight into the frame, bypassing lvgl.
+ * call from the gui task. nothing is sent until the next refresh or oled_commit().
+ *
+ * @param page - first page to write
+ * @param col - first column to write
+ * @param data - `pages` consecutive runs of `width` column bytes
+ * @param width - columns per page, clipped to the panel
+ * @param pages - number of pages
+ */
+void oled_blit(uint8_t page, uint8_t col, const uint8_t *data, uint8_t width, uint8_t pages);
+
+/**
+ * @brief send what oled_blit changed when no lvgl refresh is going to, and retry
+ * any window the previous commit failed to send.
+ * @return true if anything was committed
+ */
+bool oled_commit(void);
+
+/**
+ * @brief copy out the bus counters. safe to call from any task.
+ */
+void oled_get_flush_stats(OledFlushStats *stats);
+
+/**
+ * @brief write the last committed frame as a plain text PBM (P1) image, lit pixels as 1,
+ * one line of '0'/'1' per pixel row. text survives the console's line ending translation,
+ * and tools/gui_snapshot.py skips log lines that land between rows.
+ * call from the gui task (or with xGuiSemaphore held) so a flush is not in progress.
+ *
+ * @param out - where to write, e.g. stdout to capture over serial
+ */
+void oled_write_pbm(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
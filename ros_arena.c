@@ -0,0 +1,183 @@
+/*
+ * stack-like arena for the rcl allocator.
+ *
+ * each block has a header with its size and the offset of the block below it. freeing
+ * the top block drops it and any freed blocks under it; freeing any other block only
+ * marks it.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "ros_arena.h"
+
+#define ARENA_ALIGN 8
+#define NO_BLOCK UINT32_MAX
+#define BLOCK_FREED 0x80000000U
+
+typedef struct BlockHeader {
+    uint32_t size;   // payload bytes, BLOCK_FREED set once freed
+    uint32_t below;  // offset of the block under this one, NO_BLOCK for the first
+} BlockHeader;
+
+/***************************
+ * globals
+ ***************************/
+static portMUX_TYPE arenaLock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t arena[ROS_ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+static uint32_t top;                 // first free byte
+static uint32_t topBlock = NO_BLOCK; // offset of the highest block's header
+static RosArenaStats stats = { .size = ROS_ARENA_SIZE };
+
+static bool in_arena(const void *pointer)
+{
+    return (const uint8_t *) pointer >= arena && (const uint8_t *) pointer < arena + ROS_ARENA_SIZE;
+}
+
+static BlockHeader *header_of(void *pointer)
+{
+    return (BlockHeader *)((uint8_t *) pointer - sizeof(BlockHeader));
+}
+
+/* caller holds arenaLock */
+static void *take(size_t size)
+{
+    uint32_t need = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    if (size > ROS_ARENA_SIZE || top + sizeof(BlockHeader) + need > ROS_ARENA_SIZE) {
+        return NULL;
+    }
+
+    BlockHeader *h = (BlockHeader *) &arena[top];
+    h->size = need;
+    h->below = topBlock;
+    topBlock = top;
+    top += sizeof(BlockHeader) + need;
+
+    stats.used = top;
+    if (top > stats.peak) {
+        stats.peak = top;
+    }
+    return h + 1;
+}
+
+/* caller holds arenaLock */
+static void give_back(void *pointer)
+{
+    header_of(pointer)->size |= BLOCK_FREED;
+
+    while (topBlock != NO_BLOCK) {
+        BlockHeader *h = (BlockHeader *) &arena[topBlock];
+        if (!(h->size & BLOCK_FREED)) {
+            break;
+        }
+        top = topBlock;
+        topBlock = h->below;
+    }
+    stats.used = top;
+}
+
+static void *arena_allocate(size_t size, void *state)
+{
+    (void) state;
+
+    portENTER_CRITICAL(&arenaLock);
+    void *pointer = take(size);
+    if (pointer == NULL) {
+        stats.heap_fallbacks++;
+    }
+    portEXIT_CRITICAL(&arenaLock);
+
+    return pointer != NULL ? pointer : malloc(size);
+}
+
+static void arena_deallocate(void *pointer, void *state)
+{
+    (void) state;
+
+    if (pointer == NULL) {
+        return;
+    }
+    if (!in_arena(pointer)) {
+        free(pointer);
+        return;
+    }
+    portENTER_CRITICAL(&arenaLock);
+    give_back(pointer);
+    portEXIT_CRITICAL(&arenaLock);
+}
+
+static void *arena_reallocate(void *pointer, size_t size, void *state)
+{
+    if (pointer == NULL) {
+        return arena_allocate(size, state);
+    }
+    if (!in_arena(pointer)) {
+        return realloc(pointer, size);
+    }
+
+    BlockHeader *h = header_of(pointer);
+    uint32_t offset = (uint8_t *) h - arena;
+    uint32_t need = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    /* the top block grows or shrinks where it is */
+    portENTER_CRITICAL(&arenaLock);
+    if (offset == topBlock && size <= ROS_ARENA_SIZE
+        && offset + sizeof(BlockHeader) + need <= ROS_ARENA_SIZE) {
+        h->size = need;
+        top = offset + sizeof(BlockHeader) + need;
+        stats.used = top;
+        if (top > stats.peak) {
+            stats.peak = top;
+        }
+        portEXIT_CRITICAL(&arenaLock);
+        return pointer;
+    }
+    portEXIT_CRITICAL(&arenaLock);
+
+    void *moved = arena_allocate(size, state);
+    if (moved == NULL) {
+        return NULL;
+    }
+    memcpy(moved, pointer, h->size < size ? h->size : size);
+    arena_deallocate(pointer, state);
+    return moved;
+}
+
+static void *arena_zero_allocate(size_t count, size_t size, void *state)
+{
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void *pointer = arena_allocate(count * size, state);
+    if (pointer != NULL) {
+        memset(pointer, 0, count * size);
+    }
+    return pointer;
+}
+
+rcl_allocator_t ros_arena_allocator(void)
+{
+    rcl_allocator_t allocator = {
+        .allocate = arena_allocate,
+        .deallocate = arena_deallocate,
+        .reallocate = arena_reallocate,
+        .zero_allocate = arena_zero_allocate,
+        .state = NULL,
+    };
+    return allocator;
+}
+
+void ros_arena_get_stats(RosArenaStats *out)
+{
+    portENTER_CRITICAL(&arenaLock);
+    *out = stats;
+    portEXIT_CRITICAL(&arenaLock);
+}
@@ -0,0 +1,41 @@
+/*
+ * ros arena - a static block the rcl allocator hands out, so the micro-ROS support,
+ * node, entities and executor are built in fixed storage rather than on the heap.
+ *
+ * allocations are carved off the top of the arena. a freed block is given back once
+ * everything above it has been freed too, which covers the temporaries rcl makes and
+ * drops during set up; a block freed out of order is lost until then. if the arena runs
+ * out the request falls back to the heap and is counted, so ROS_ARENA_SIZE can be tuned
+ * from ros_arena_get_stats rather than failing on the device.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <rcl/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ROS_ARENA_SIZE (12 * 1024)
+
+typedef struct RosArenaStats {
+    uint32_t size;            // ROS_ARENA_SIZE
+    uint32_t used;            // bytes up to the top block, headers included
+    uint32_t peak;            // most ever used
+    uint32_t heap_fallbacks;  // allocations the arena had no room for
+} RosArenaStats;
+
+/**
+ * @brief an rcl allocator over the arena. use it for everything created on the ros task.
+ */
+rcl_allocator_t ros_arena_allocator(void);
+
+/**
+ * @brief copy out the counters. safe to call from any task.
+ */
+void ros_arena_get_stats(RosArenaStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,422 @@
+/*
+ * keyframe sequence player.
+ *
+ * seq_player_play decodes the stored sequence into `staged` and wakes the player task,
+ * which takes it over at its next tick. while playing, the task wakes every
+ * SEQ_PLAYER_TICK_MS on an absolute schedule, works out the pose for the current frame
+ * in milli-degrees and sends the channels that changed through servo_command_set_many,
+ * which writes them in one PCA9685 transaction. interpolating below a degree keeps slow
+ * moves from stepping a whole degree at a time.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "app_ram.h"
+#include "seq_player.h"
+#include "servo_command.h"
+
+#define TAG "seq_player"
+
+#define NOTIFY_PLAY (1U << 0)
+#define NOTIFY_STOP (1U << 1)
+
+#define BLOB_HEADER_LEN 4
+#define BLOB_FRAME_LEN(channels) (3 + 2 * (channels))
+#define BLOB_MAX_LEN (BLOB_HEADER_LEN + SEQ_PLAYER_MAX_FRAMES * BLOB_FRAME_LEN(kServoChannelCount))
+
+#define EASE_ONE 1000 // progress and eased progress are in thousandths
+
+/***************************
+ * globals
+ ***************************/
+static TaskHandle_t playerTask;
+static StaticTask_t playerTaskBuffer;
+static StackType_t playerStack[SEQ_PLAYER_STACK_SIZE];
+
+/* handed from seq_player_play to the task under stageLock */
+static SemaphoreHandle_t stageLock;
+static StaticSemaphore_t stageLockBuffer;
+static Sequence staged;
+static uint16_t stagedLoops;
+
+/* seq_player_play decodes here under loadLock, so callers on different tasks take turns */
+static SemaphoreHandle_t loadLock;
+static StaticSemaphore_t loadLockBuffer;
+static Sequence loading;
+
+/* player task only */
+static Sequence active;
+
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static SeqPlayerStats stats;
+
+static bool valid_name(const char *name)
+{
+    size_t len = strlen(name);
+    return len > 0 && len <= SEQ_PLAYER_NAME_LEN;
+}
+
+static esp_err_t validate(const Sequence *seq)
+{
+    uint32_t total_ms = 0;
+
+    if (seq->frame_count == 0 || seq->frame_count > SEQ_PLAYER_MAX_FRAMES || seq->channel_mask == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int f = 0; f < seq->frame_count; f++) {
+        const SeqFrame *frame = &seq->frames[f];
+
+        total_ms += frame->duration_ms;
+
+        if (frame->easing >= SEQ_EASING_COUNT) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int ch = 0; ch < kServoChannelCount; ch++) {
+            /* the same range servo_command enforces, so a stored sequence never plays a rejected pose */
+            if ((seq->channel_mask & (1U << ch)) && (frame->angles[ch] < 0 || frame->angles[ch] > 180)) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+    /* a looping sequence of nothing but jumps would never yield the cpu */
+    return total_ms > 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+static size_t encode(const Sequence *seq, uint8_t *blob)
+{
+    uint8_t *p = blob;
+
+    *p++ = SEQ_PLAYER_VERSION;
+    *p++ = seq->frame_count;
+    *p++ = seq->channel_mask & 0xFF;
+    *p++ = seq->channel_mask >> 8;
+    for (int f = 0; f < seq->frame_count; f++) {
+        const SeqFrame *frame = &seq->frames[f];
+
+        *p++ = frame->duration_ms & 0xFF;
+        *p++ = frame->duration_ms >> 8;
+        *p++ = frame->easing;
+        for (int ch = 0; ch < kServoChannelCount; ch++) {
+            if (seq->channel_mask & (1U << ch)) {
+                *p++ = (uint16_t) frame->angles[ch] & 0xFF;
+                *p++ = (uint16_t) frame->angles[ch] >> 8;
+            }
+        }
+    }
+    return p - blob;
+}
+
+static esp_err_t decode(const uint8_t *blob, size_t len, Sequence *seq)
+{
+    if (len < BLOB_HEADER_LEN || blob[0] != SEQ_PLAYER_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    memset(seq, 0, sizeof(*seq));
+    seq->frame_count = blob[1];
+    seq->channel_mask = blob[2] | (blob[3] << 8);
+
+    int channels = __builtin_popcount(seq->channel_mask);
+    if (seq->frame_count > SEQ_PLAYER_MAX_FRAMES
+        || len != BLOB_HEADER_LEN + seq->frame_count * BLOB_FRAME_LEN(channels)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *p = blob + BLOB_HEADER_LEN;
+    for (int f = 0; f < seq->frame_count; f++) {
+        SeqFrame *frame = &seq->frames[f];
+
+        frame->duration_ms = p[0] | (p[1] << 8);
+        frame->easing = p[2];
+        p += 3;
+        for (int ch = 0; ch < kServoChannelCount; ch++) {
+            if (seq->channel_mask & (1U << ch)) {
+                frame->angles[ch] = (int16_t)(p[0] | (p[1] << 8));
+                p += 2;
+            }
+        }
+    }
+    return validate(seq);
+}
+
+esp_err_t seq_player_store(const char *name, const Sequence *seq)
+{
+    uint8_t blob[BLOB_MAX_LEN];
+    nvs_handle_t nvs;
+
+    if (!valid_name(name) || validate(seq) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_open(SEQ_PLAYER_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    size_t len = encode(seq, blob);
+    err = nvs_set_blob(nvs, name, blob, len);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+
+    ESP_LOGI(TAG, "stored \"%s\": %d frames, %d bytes: %s", name, seq->frame_count, len, esp_err_to_name(err));
+    return err;
+}
+
+esp_err_t seq_player_delete(const char *name)
+{
+    nvs_handle_t nvs;
+
+    if (!valid_name(name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = nvs_open(SEQ_PLAYER_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_erase_key(nvs, name);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+
+    return err == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : err;
+}
+
+static esp_err_t load(const char *name, Sequence *seq)
+{
+    uint8_t blob[BLOB_MAX_LEN];
+    size_t len = sizeof(blob);
+    nvs_handle_t nvs;
+
+    if (!valid_name(name)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = nvs_open(SEQ_PLAYER_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(nvs, name, blob, &len);
+        nvs_close(nvs);
+    }
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    return decode(blob, len, seq);
+}
+
+/*
+ * progress through a frame (0..EASE_ONE) to the fraction of the move made.
+ */
+static int32_t ease(uint8_t easing, int32_t p)
+{
+    switch (easing) {
+    case SEQ_EASE_IN:
+        return p * p / EASE_ONE;
+    case SEQ_EASE_OUT:
+        return EASE_ONE - (EASE_ONE - p) * (EASE_ONE - p) / EASE_ONE;
+    case SEQ_EASE_IN_OUT:
+        return (int32_t)((int64_t) p * p * (3 * EASE_ONE - 2 * p) / ((int64_t) EASE_ONE * EASE_ONE));
+    case SEQ_EASE_STEP:
+        return p < EASE_ONE ? 0 : EASE_ONE;
+    default:
+        return p;
+    }
+}
+
+/*
+ * send the channels whose position differs from what was last sent.
+ */
+static void send_pose(const int32_t *pose, int32_t *sent)
+{
+    ServoCommand cmds[kServoChannelCount];
+    int count = 0;
+
+    for (int ch = 0; ch < kServoChannelCount; ch++) {
+        if ((active.channel_mask & (1U << ch)) && pose[ch] != sent[ch]) {
+            cmds[count].channel = ch;
+            cmds[count].unit = SERVO_UNIT_MILLIDEGREES;
+            cmds[count].value = pose[ch];
+            sent[ch] = pose[ch];
+            count++;
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+
+    servo_command_set_many(SERVO_SOURCE_SEQUENCE, cmds, count);
+    portENTER_CRITICAL(&statsLock);
+    stats.writes++;
+    portEXIT_CRITICAL(&statsLock);
+}
+
+static void set_playing(bool playing, bool completed)
+{
+    portENTER_CRITICAL(&statsLock);
+    stats.playing = playing;
+    if (playing) {
+        stats.started++;
+    }
+    if (completed) {
+        stats.completed++;
+    }
+    portEXIT_CRITICAL(&statsLock);
+}
+
+static void seq_player_task(void *arg)
+{
+    int32_t from[kServoChannelCount];   // pose at the start of the current frame, milli-degrees
+    int32_t pose[kServoChannelCount];
+    int32_t sent[kServoChannelCount];
+    bool playing = false;
+    uint16_t loops = 0;
+    int frame = 0;
+    int64_t frameStartUs = 0;
+    TickType_t lastWake = 0;
+
+    for (;;) {
+        uint32_t bits = 0;
+
+        xTaskNotifyWait(0, UINT32_MAX, &bits, playing ? 0 : portMAX_DELAY);
+
+        if (bits & NOTIFY_STOP) {
+            if (playing) {
+                ESP_LOGI(TAG, "stopped");
+                set_playing(false, false);
+            }
+            playing = false;
+        }
+        if (bits & NOTIFY_PLAY) {
+            xSemaphoreTake(stageLock, portMAX_DELAY);
+            active = staged;
+            loops = stagedLoops;
+            xSemaphoreGive(stageLock);
+
+            /* start from wherever the servos are now */
+            servo_command_get_millidegrees(from);
+            memcpy(sent, from, sizeof(sent));
+            frame = 0;
+            frameStartUs = esp_timer_get_time();
+            lastWake = xTaskGetTickCount();
+            playing = true;
+            set_playing(true, false);
+        }
+        if (!playing) {
+            continue;
+        }
+
+        const SeqFrame *kf = &active.frames[frame];
+        int64_t now = esp_timer_get_time();
+        int64_t elapsedUs = now - frameStartUs;
+        int64_t durationUs = (int64_t) kf->duration_ms * 1000;
+        bool reached = elapsedUs >= durationUs;
+        int32_t e = reached ? EASE_ONE : ease(kf->easing, (int32_t)(elapsedUs * EASE_ONE / durationUs));
+
+        for (int ch = 0; ch < kServoChannelCount; ch++) {
+            if (active.channel_mask & (1U << ch)) {
+                int32_t delta = kf->angles[ch] * 1000 - from[ch];
+                /* round to nearest rather than toward the start pose */
+                pose[ch] = from[ch] + (delta * e + (delta >= 0 ? EASE_ONE / 2 : -EASE_ONE / 2)) / EASE_ONE;
+            }
+        }
+        send_pose(pose, sent);
+
+        if (reached) {
+            portENTER_CRITICAL(&statsLock);
+            stats.frames++;
+            portEXIT_CRITICAL(&statsLock);
+
+            for (int ch = 0; ch < kServoChannelCount; ch++) {
+                from[ch] = kf->angles[ch] * 1000;
+            }
+            /* keep the schedule absolute, a late tick does not stretch the sequence */
+            frameStartUs += durationUs;
+            if (++frame == active.frame_count) {
+                frame = 0;
+                if (loops > 0 && --loops == 0) {
+                    ESP_LOGI(TAG, "finished");
+                    playing = false;
+                    set_playing(false, true);
+                    continue;
+                }
+            }
+            if (active.frames[frame].duration_ms == 0) {
+                /* a jump, handled without waiting a tick */
+                continue;
+            }
+        }
+
+        if (xTaskGetTickCount() - lastWake >= pdMS_TO_TICKS(SEQ_PLAYER_TICK_MS) * 2) {
+            portENTER_CRITICAL(&statsLock);
+            stats.late_ticks++;
+            portEXIT_CRITICAL(&statsLock);
+        }
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SEQ_PLAYER_TICK_MS));
+    }
+}
+
+esp_err_t seq_player_start(void)
+{
+    if (playerTask != NULL) {
+        return ESP_OK;
+    }
+
+    stageLock = xSemaphoreCreateMutexStatic(&stageLockBuffer);
+    loadLock = xSemaphoreCreateMutexStatic(&loadLockBuffer);
+    playerTask = xTaskCreateStatic(seq_player_task, "seq_player", SEQ_PLAYER_STACK_SIZE,
+                                   NULL, SEQ_PLAYER_PRIORITY, playerStack, &playerTaskBuffer);
+    app_ram_reserve(APP_RAM_SEQUENCE, sizeof(playerTaskBuffer) + sizeof(playerStack)
+                    + sizeof(stageLockBuffer) + sizeof(loadLockBuffer)
+                    + sizeof(staged) + sizeof(loading) + sizeof(active));
+    return ESP_OK;
+}
+
+esp_err_t seq_player_play(const char *name, uint16_t loops)
+{
+    if (playerTask == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* decode outside stageLock, the player keeps ticking meanwhile */
+    xSemaphoreTake(loadLock, portMAX_DELAY);
+    esp_err_t err = load(name, &loading);
+    if (err == ESP_OK) {
+        xSemaphoreTake(stageLock, portMAX_DELAY);
+        staged = loading;
+        stagedLoops = loops;
+        xSemaphoreGive(stageLock);
+        xTaskNotify(playerTask, NOTIFY_PLAY, eSetBits);
+        ESP_LOGI(TAG, "playing \"%s\", %d frames, loops %d", name, loading.frame_count, loops);
+    }
+    xSemaphoreGive(loadLock);
+
+    return err;
+}
+
+void seq_player_stop(void)
+{
+    if (playerTask != NULL) {
+        xTaskNotify(playerTask, NOTIFY_STOP, eSetBits);
+    }
+}
+
+void seq_player_get_stats(SeqPlayerStats *out)
+{
+    portENTER_CRITICAL(&statsLock);
+    *out = stats;
+    portEXIT_CRITICAL(&statsLock);
+}
@@ -0,0 +1,111 @@
+/*
+ * seq_player - named keyframe sequences stored in NVS and played on the device.
+ *
+ * a sequence is a list of multi-channel poses, each reached over a duration with an
+ * easing curve, starting from wherever the servos are when it is triggered. the player
+ * interpolates every SEQ_PLAYER_TICK_MS and writes the channels that moved as one
+ * batched PCA9685 update, so a gesture costs one trigger message rather than a stream
+ * of setpoints over wi-fi.
+ *
+ * stored format (NVS blob per name, little endian):
+ *   u8 version | u8 frame count | u16 channel mask
+ *   then per frame: u16 duration ms | u8 easing | i16 angle per masked channel, lowest channel first
+ *
+ * uploaded and triggered from the http control server, see http_control.h.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "app.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// uncomment to enable the sequence player (needs HTTP_CONTROL to upload and trigger)
+// #define SEQ_PLAYER 1
+
+#define SEQ_PLAYER_MAX_FRAMES 32
+#define SEQ_PLAYER_NAME_LEN 15          // NVS key limit
+#define SEQ_PLAYER_TICK_MS 20           // interpolation step, about one servo pulse period
+#define SEQ_PLAYER_NVS_NAMESPACE "sequences"
+#define SEQ_PLAYER_MAX_UPLOAD 4096      // json upload, a full sequence of 32 frames by 4 channels fits
+#define SEQ_PLAYER_STACK_SIZE (3 * 1024)
+#define SEQ_PLAYER_PRIORITY 3           // below the ros executor, above network work
+
+#define SEQ_PLAYER_VERSION 1
+
+typedef enum SeqEasing {
+    SEQ_EASE_LINEAR,
+    SEQ_EASE_IN,       // accelerate from rest
+    SEQ_EASE_OUT,      // decelerate to rest
+    SEQ_EASE_IN_OUT,   // smoothstep, at rest at both ends
+    SEQ_EASE_STEP,     // hold the previous pose, then jump at the end of the frame
+    SEQ_EASING_COUNT
+} SeqEasing;
+
+typedef struct SeqFrame {
+    uint16_t duration_ms;
+    uint8_t easing;                     // SeqEasing
+    int16_t angles[kServoChannelCount]; // indexed by channel, only the sequence's channels are used
+} SeqFrame;
+
+typedef struct Sequence {
+    uint16_t channel_mask;              // bit n set if channel n moves
+    uint8_t frame_count;
+    SeqFrame frames[SEQ_PLAYER_MAX_FRAMES];
+} Sequence;
+
+typedef struct SeqPlayerStats {
+    uint32_t started;      // sequences triggered
+    uint32_t completed;    // sequences that ran all their loops
+    uint32_t frames;       // keyframes reached
+    uint32_t writes;       // batched updates sent
+    uint32_t late_ticks;   // ticks that ran a whole tick or more behind schedule
+    bool playing;
+} SeqPlayerStats;
+
+/**
+ * @brief start the player task. nvs must be initialised (http_calls_init).
+ */
+esp_err_t seq_player_start(void);
+
+/**
+ * @brief validate and store a sequence under a name, replacing any with the same name.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_INVALID_ARG for a bad name, channel, easing or frame count, or the nvs error
+ */
+esp_err_t seq_player_store(const char *name, const Sequence *seq);
+
+/**
+ * @brief remove a stored sequence.
+ */
+esp_err_t seq_player_delete(const char *name);
+
+/**
+ * @brief load a stored sequence and play it from the current servo positions,
+ * replacing whatever is playing.
+ *
+ * @param loops - times to play it, 0 to repeat until stopped
+ * @return
+ *     - ESP_OK, ESP_ERR_NOT_FOUND, ESP_ERR_INVALID_STATE if not started
+ */
+esp_err_t seq_player_play(const char *name, uint16_t loops);
+
+/**
+ * @brief stop playing, the servos hold where they are.
+ */
+void seq_player_stop(void);
+
+/**
+ * @brief copy out the counters. safe to call from any task.
+ */
+void seq_player_get_stats(SeqPlayerStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
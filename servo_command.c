@@ -0,0 +1,179 @@
+/*
+ * servo command - shared actuation path for ros and http.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "app.h"
+#include "app_metrics.h"
+#include "app_ram.h"
+#include "boot_profile.h"
+#include "cmd_recorder.h"
+#include "servo_command.h"
+#include "servo_pca9685.h"
+
+#define TAG "servo_cmd"
+
+/***************************
+ * globals
+ ***************************/
+static SemaphoreHandle_t actuateLock;
+static StaticSemaphore_t actuateLockBuffer;
+static portMUX_TYPE anglesLock = portMUX_INITIALIZER_UNLOCKED;
+static int32_t lastMillidegrees[kServoChannelCount];
+
+esp_err_t servo_command_init(void)
+{
+    if (actuateLock == NULL) {
+        actuateLock = xSemaphoreCreateMutexStatic(&actuateLockBuffer);
+        app_ram_reserve(APP_RAM_SERVO, sizeof(actuateLockBuffer) + sizeof(lastMillidegrees));
+    }
+    return ESP_OK;
+}
+
+/*
+ * record and range check one command, converting it to the channel's PCA9685 step.
+ * caller holds actuateLock.
+ */
+static bool accept(ServoCommandSource source, uint8_t channel, ServoUnit unit, int32_t value, uint16_t *ticks)
+{
+#ifdef CMD_RECORDER
+    /* record what arrived, rejected commands included, so a replay reproduces it */
+    cmd_recorder_append(source, channel, unit, value);
+#endif
+
+    if (channel >= kServoChannelCount || servo_pca9685_position_to_ticks(channel, unit, value, ticks) != ESP_OK) {
+        ESP_LOGW(TAG, "rejected servo %d position %d (unit %d)", channel, value, unit);
+        metrics_count(METRIC_SERVO_CMD_REJECTED, 1);
+        return false;
+    }
+    return true;
+}
+
+static void count_applied(ServoCommandSource source, uint32_t commands, uint32_t elapsed, esp_err_t err)
+{
+    switch (source) {
+    case SERVO_SOURCE_HTTP:
+        metrics_count(METRIC_SERVO_CMD_HTTP, commands);
+        metrics_record_us(METRIC_HIST_ACTUATE_HTTP_US, elapsed);
+        break;
+    case SERVO_SOURCE_REPLAY:
+        metrics_count(METRIC_SERVO_CMD_REPLAY, commands);
+        break;
+    case SERVO_SOURCE_SEQUENCE:
+        metrics_count(METRIC_SERVO_CMD_SEQUENCE, commands);
+        break;
+    default:
+        metrics_count(METRIC_SERVO_CMD_ROS, commands);
+        metrics_record_us(METRIC_HIST_ACTUATE_ROS_US, elapsed);
+        break;
+    }
+    if (err != ESP_OK) {
+        metrics_count(METRIC_SERVO_CMD_FAILED, commands);
+    } else {
+        boot_mark(BOOT_PHASE_FIRST_COMMAND);
+    }
+}
+
+/*
+ * the display and the last position are kept as the angle the step actually gives,
+ * whatever unit the command came in. only called once the write has succeeded, so
+ * neither shows a position the servo never reached.
+ */
+static void show_position(uint8_t channel, uint16_t ticks)
+{
+    int32_t mdeg = servo_pca9685_ticks_to_millidegrees(channel, ticks);
+
+    gui_ipc_post_servo_angle(channel, (mdeg + 500) / 1000);
+    portENTER_CRITICAL(&anglesLock);
+    lastMillidegrees[channel] = mdeg;
+    portEXIT_CRITICAL(&anglesLock);
+}
+
+esp_err_t servo_command_set_position(ServoCommandSource source, uint8_t channel, ServoUnit unit, int32_t value)
+{
+    uint16_t ticks;
+
+    xSemaphoreTake(actuateLock, portMAX_DELAY);
+    if (!accept(source, channel, unit, value, &ticks)) {
+        xSemaphoreGive(actuateLock);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    esp_err_t err = set_pca9685_servo_ticks(channel, ticks);
+
+    count_applied(source, 1, (uint32_t)(esp_timer_get_time() - start), err);
+    if (err == ESP_OK) {
+        show_position(channel, ticks);
+    }
+    xSemaphoreGive(actuateLock);
+
+    return err;
+}
+
+esp_err_t servo_command_set(ServoCommandSource source, uint8_t channel, int32_t angle)
+{
+    return servo_command_set_position(source, channel, SERVO_UNIT_DEGREES, angle);
+}
+
+int servo_command_set_many(ServoCommandSource source, const ServoCommand *cmds, int count)
+{
+    uint16_t ticks[kServoChannelCount];
+    uint16_t mask = 0;
+
+    xSemaphoreTake(actuateLock, portMAX_DELAY);
+    for (int i = 0; i < count; i++) {
+        uint16_t t;
+
+        /* a repeated channel keeps its last position, as if written in order */
+        if (accept(source, cmds[i].channel, cmds[i].unit, cmds[i].value, &t)) {
+            ticks[cmds[i].channel] = t;
+            mask |= 1U << cmds[i].channel;
+        }
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = ESP_OK;
+    int written = __builtin_popcount(mask);   // a repeated channel is one write
+
+    if (mask != 0) {
+        /* one bus transaction for the whole batch */
+        err = set_pca9685_servo_ticks_many(mask, ticks);
+
+        count_applied(source, written, (uint32_t)(esp_timer_get_time() - start), err);
+        for (int ch = 0; ch < kServoChannelCount && err == ESP_OK; ch++) {
+            if (mask & (1U << ch)) {
+                show_position(ch, ticks[ch]);
+            }
+        }
+    }
+    xSemaphoreGive(actuateLock);
+
+    return err == ESP_OK ? written : 0;
+}
+
+void servo_command_get_angles(int16_t *angles)
+{
+    portENTER_CRITICAL(&anglesLock);
+    for (int ch = 0; ch < kServoChannelCount; ch++) {
+        angles[ch] = (lastMillidegrees[ch] + 500) / 1000;
+    }
+    portEXIT_CRITICAL(&anglesLock);
+}
+
+void servo_command_get_millidegrees(int32_t *mdeg)
+{
+    portENTER_CRITICAL(&anglesLock);
+    memcpy(mdeg, lastMillidegrees, sizeof(lastMillidegrees));
+    portEXIT_CRITICAL(&anglesLock);
+}
@@ -0,0 +1,85 @@
+/*
+ * servo command - the one actuation path for every control source.
+ *
+ * ros callbacks and the http control endpoint both come through here, so a
+ * command is range checked, shown on the display, written to the PCA9685 and
+ * counted the same way whichever way it arrived.
+ *
+ * positions are given in a ServoUnit and converted straight to the channel's PCA9685
+ * step, so microseconds, steps and milli-degrees keep the full 12 bit resolution.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "servo_pca9685.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum ServoCommandSource {
+    SERVO_SOURCE_ROS,
+    SERVO_SOURCE_HTTP,
+    SERVO_SOURCE_REPLAY,   // commands played back from the recorder log
+    SERVO_SOURCE_SEQUENCE, // frames interpolated by the keyframe sequence player
+} ServoCommandSource;
+
+typedef struct ServoCommand {
+    uint8_t channel;
+    uint8_t unit;   // ServoUnit
+    int32_t value;
+} ServoCommand;
+
+/**
+ * @brief create the lock that serialises PCA9685 writes between sources.
+ * call once the PCA9685 is initialised and before any control source starts.
+ */
+esp_err_t servo_command_init(void);
+
+/**
+ * @brief range check and apply one command in whole degrees.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_INVALID_ARG if the channel or angle is out of range, or the PCA9685 write error
+ */
+esp_err_t servo_command_set(ServoCommandSource source, uint8_t channel, int32_t angle);
+
+/**
+ * @brief range check and apply one command in any unit. the value is checked as signed
+ * against the channel's configured range, so negative values are rejected rather than wrapped.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_INVALID_ARG if the channel, unit or value is out of range, or the PCA9685 write error
+ */
+esp_err_t servo_command_set_position(ServoCommandSource source, uint8_t channel, ServoUnit unit, int32_t value);
+
+/**
+ * @brief apply several commands as one PCA9685 transaction under one lock, so another
+ * source cannot interleave with the batch. invalid entries are skipped and counted.
+ *
+ * @return
+ *     - the number of channels written, a channel repeated in the batch counting once,
+ *       0 if the bus write failed
+ */
+int servo_command_set_many(ServoCommandSource source, const ServoCommand *cmds, int count);
+
+/**
+ * @brief copy out the last angle applied to each channel, to the nearest degree. safe from any task.
+ *
+ * @param angles - kServoChannelCount entries
+ */
+void servo_command_get_angles(int16_t *angles);
+
+/**
+ * @brief copy out the last angle applied to each channel in thousandths of a degree,
+ * as given by the PCA9685 step written. safe from any task.
+ *
+ * @param mdeg - kServoChannelCount entries
+ */
+void servo_command_get_millidegrees(int32_t *mdeg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,15 +29,20 @@
 #include <math.h>
 
 #include "pca9685.h"
+#include "esp_timer.h"
+#include "i2c_bus.h"
 #include "servo_pca9685.h"
+#include "trace.h"
 
 #define TAG "PCA9685"
 //You can get these value from the datasheet of servo you use, in general pulse width varies between 1000 to 2000 mocrosecond
 #define SERVO_MIN_PULSEWIDTH 500 //Minimum pulse width in microsecond
 #define SERVO_MAX_PULSEWIDTH 2500 //Maximum pulse width in microsecond
-#define SERVO_MAX_DEGREE 90 //Maximum angle in degree upto which servo can rotate
-#define PCA9685_CLOCK_FREQUENCY_HZ 60 // 1000 Hz for LED's, 50Hz for Servos.
 #define MAX_CHANNELS 16
+#define PCA9685_WRITE_ATTEMPTS 3                    // first try plus retries, while healthy
+#define PCA9685_RETRY_BACKOFF_MS 2                  // pause before the first retry, doubled each time
+#define PCA9685_DEGRADED_AFTER 3                    // failed commands in a row before degraded mode
+#define PCA9685_RECOVERY_INTERVAL_US (1000 * 1000)  // bus recovery at most this often
 
 /***************************
  * globals
@@ -50,6 +55,24 @@ typedef struct channel_config {
 
 channel_config_t channels[MAX_CHANNELS];
 
+typedef struct pwm_steps {
+    uint16_t on;
+    uint16_t off;
+} pwm_steps_t;
+
+// last steps written per channel
+static pwm_steps_t written_steps[MAX_CHANNELS];
+
+// the timing the prescaler gives, set once by servo_pca9685_initialise
+static ServoPwmInfo pwm_info;
+static uint64_t step_ps;
+
+static portMUX_TYPE bus_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static ServoBusStats bus_stats;
+static volatile bool degraded;
+static int consecutive_failures;
+static int64_t last_recovery_us = -PCA9685_RECOVERY_INTERVAL_US;
+
 
 #undef ESP_ERROR_CHECK
 #define ESP_ERROR_CHECK(x)   do { esp_err_t rc = (x); if (rc != ESP_OK) { ESP_LOGE("err", "esp_err_t = %d", rc); assert(0 && #x);} } while(0);
@@ -76,8 +99,32 @@ void i2c_scan() {
     ESP_LOGI(TAG, "I2C scan complete:");
 }
 
-void servo_pca9685_initialise(uint8_t addr) {
+/*
+ * work out the real step length from the prescaler the chip will be given, rather than
+ * the requested frequency - they differ by up to a few percent, more at high frequencies.
+ */
+static void calculate_pwm_info(uint16_t pwm_hz) {
+    uint8_t prescale = prescaleForFrequency(pwm_hz);
+
+    step_ps = (uint64_t) (prescale + 1) * 1000000000000ULL / PCA9685_OSC_HZ;
+    pwm_info.requested_hz = pwm_hz;
+    pwm_info.prescale = prescale;
+    pwm_info.actual_mhz = (uint64_t) PCA9685_OSC_HZ * 1000 / ((uint64_t) PCA9685_MAX_STEPS * (prescale + 1));
+    pwm_info.period_us = step_ps * PCA9685_MAX_STEPS / 1000000;
+    pwm_info.step_ns = step_ps / 1000;
+
+    ESP_LOGI(TAG, "pwm %uHz requested: prescale %u, %u.%03uHz, step %uns, worst case update latency %uus",
+             pwm_hz, prescale, pwm_info.actual_mhz / 1000, pwm_info.actual_mhz % 1000,
+             pwm_info.step_ns, pwm_info.period_us);
+}
+
+void servo_pca9685_initialise(uint8_t addr, uint16_t pwm_hz) {
     ESP_LOGI(TAG, "initialising pca9685, executing on core %d, with address: %x", xPortGetCoreID(), addr);
+    calculate_pwm_info(pwm_hz);
+#ifdef SERVO_HEADLESS
+    ESP_LOGI(TAG, "headless - pca9685 writes are only recorded");
+    return;
+#else
     esp_err_t ret;
     set_pca9685_adress(addr);
     ret = resetPCA9685();
@@ -85,7 +132,7 @@ void servo_pca9685_initialise(uint8_t addr) {
         ESP_LOGE(TAG, "resetting pca9685 failed: error code: %d", ret);
         return;
     }
-    ret = setFrequencyPCA9685(PCA9685_CLOCK_FREQUENCY_HZ);  // 1000 Hz
+    ret = setFrequencyPCA9685(pwm_hz);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "setting frequence pca9685 failed: error code: %d", ret);
         return;
@@ -94,6 +141,7 @@ void servo_pca9685_initialise(uint8_t addr) {
     turnAllOff();
 
     ESP_LOGI(TAG,"Finished pca9685 setup");
+#endif
 }
 
 void set_channel_min_max_pulse_us(uint8_t channel, uint32_t min_pulse_us, uint32_t max_pulse_us, uint32_t max_degree) {
@@ -101,77 +149,250 @@ void set_channel_min_max_pulse_us(uint8_t channel, uint32_t min_pulse_us, uint32
     channels[channel].min_pulse_us = min_pulse_us;
     channels[channel].max_pulse_us = max_pulse_us;
     channels[channel].max_degree = max_degree;
+
+    if (pwm_info.period_us != 0 && max_pulse_us >= pwm_info.period_us) {
+        ESP_LOGW(TAG, "servo %d max pulse %uus does not fit the %uus pwm period, positions near it are rejected",
+                 channel, max_pulse_us, pwm_info.period_us);
+    }
+    ESP_LOGI(TAG, "servo %d resolution %u millidegrees per step", channel, servo_pca9685_resolution_millidegrees(channel));
 } 
 
 
-/**
- * @brief Use this function to calcute pulse width for per degree rotation
- *
- * @param  degree_of_rotation the angle in degree to which servo has to rotate
- *
- * @return
- *     - calculated pulse width
+/*
+ * pulse width to the nearest PCA9685 step. a step is (prescale + 1) oscillator cycles.
  */
-uint32_t servo_rot_to_pulsewidth(uint8_t channel, uint32_t degree_of_rotation)
-{
-    uint32_t cal_pulsewidth = 0;
-    float max_pulse_width = (channels[channel].max_pulse_us - channels[channel].min_pulse_us);
-    float min_width = channels[channel].min_pulse_us;
-    float max_degrees = channels[channel].max_degree;
-    float req_rotation = degree_of_rotation;
+static int64_t ns_to_ticks(int64_t pulse_ns) {
+    return (pulse_ns * 1000 + (int64_t) step_ps / 2) / (int64_t) step_ps;
+}
 
-    
-    cal_pulsewidth = min_width +  (max_pulse_width * req_rotation / max_degrees);
+static int64_t ticks_to_ns(int64_t ticks) {
+    return ticks * (int64_t) step_ps / 1000;
+}
+
+esp_err_t servo_pca9685_position_to_ticks(uint8_t num, ServoUnit unit, int32_t value, uint16_t *ticks) {
+    if (num >= MAX_CHANNELS || channels[num].max_degree == 0) {
+        // no pulse range configured, the conversion would divide by zero
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (step_ps == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const channel_config_t *ch = &channels[num];
+    int64_t min_ns = (int64_t) ch->min_pulse_us * 1000;
+    int64_t span_ns = (int64_t) (ch->max_pulse_us - ch->min_pulse_us) * 1000;
+    int64_t max_mdeg = (int64_t) ch->max_degree * 1000;
+    int64_t mdeg;
+    int64_t t;
 
-    ESP_LOGI(TAG,"min:%d, max:%d, max degrees:%d, pulse width: %d",
-        channels[channel].min_pulse_us,
-        channels[channel].max_pulse_us,
-        channels[channel].max_degree,
-         cal_pulsewidth);
+    switch (unit) {
+    case SERVO_UNIT_DEGREES:
+    case SERVO_UNIT_MILLIDEGREES:
+        mdeg = unit == SERVO_UNIT_DEGREES ? (int64_t) value * 1000 : value;
+        if (mdeg < 0 || mdeg > max_mdeg) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        t = ns_to_ticks(min_ns + span_ns * mdeg / max_mdeg);
+        break;
+    case SERVO_UNIT_US:
+        if (value < (int32_t) ch->min_pulse_us || value > (int32_t) ch->max_pulse_us) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        t = ns_to_ticks((int64_t) value * 1000);
+        break;
+    case SERVO_UNIT_TICKS:
+        if (value < ns_to_ticks(min_ns) || value > ns_to_ticks(min_ns + span_ns)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        t = value;
+        break;
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    return cal_pulsewidth;
+    if (t >= PCA9685_MAX_STEPS) {
+        // a pulse range longer than the period, nothing sensible to write
+        return ESP_ERR_INVALID_ARG;
+    }
+    *ticks = t;
+    return ESP_OK;
 }
 
-void get_steps_on_off_pulse_width(uint8_t channel, uint16_t *step_on, uint16_t *step_off, uint32_t pulse_width) {
-    *step_on = 0;
+int32_t servo_pca9685_ticks_to_millidegrees(uint8_t num, uint16_t ticks) {
+    if (num >= MAX_CHANNELS || channels[num].max_degree == 0) {
+        return 0;
+    }
 
-    // work out the maximum ticks - 4096 steps per period of the clock frequency
-    // we set. So 1/freq * 1,000,000 to convert to microseconds. 
-    float max_pulse_width = (float) 1.0 / PCA9685_CLOCK_FREQUENCY_HZ * 1000000;
+    const channel_config_t *ch = &channels[num];
+    int64_t min_ns = (int64_t) ch->min_pulse_us * 1000;
+    int64_t span_ns = (int64_t) (ch->max_pulse_us - ch->min_pulse_us) * 1000;
+    if (span_ns <= 0) {
+        return 0;
+    }
+    int64_t mdeg = (ticks_to_ns(ticks) - min_ns) * ch->max_degree * 1000 / span_ns;
 
-    // convert % pulse of max width to a number of steps (% of 4096)
-    *step_off = ((float)(pulse_width / max_pulse_width) * PCA9685_MAX_STEPS);
+    if (mdeg < 0) {
+        return 0;
+    }
+    return mdeg > ch->max_degree * 1000 ? ch->max_degree * 1000 : mdeg;
 }
 
+/*
+ * one transaction for written_steps[first .. first + count - 1].
+ */
+static esp_err_t write_steps(uint8_t first, uint8_t count) {
+    uint16_t on[MAX_CHANNELS];
+    uint16_t off[MAX_CHANNELS];
 
-void set_pca9685_servo_angle(uint8_t num, uint32_t degree_angle) {
-    esp_err_t ret;
+    if (count == 1) {
+        return setPWM(first, written_steps[first].on, written_steps[first].off);
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        on[i] = written_steps[first + i].on;
+        off[i] = written_steps[first + i].off;
+    }
+    return setPWMRange(first, count, on, off);
+}
+
+/*
+ * write the steps, retrying with a growing pause between attempts and recovering the bus
+ * if the writes keep failing. once degraded only one attempt is made per command, so a
+ * dead bus costs the caller one transaction deadline rather than every retry.
+ */
+static esp_err_t write_pwm_with_retry(uint8_t first, uint8_t count) {
+    int attempts = degraded ? 1 : PCA9685_WRITE_ATTEMPTS;
+    esp_err_t ret = ESP_FAIL;
 
-    ESP_LOGI(TAG,"Servo: %d -> Angle of rotation: %d", num, degree_angle);
-    if (degree_angle > SERVO_MAX_DEGREE) {
-        degree_angle = SERVO_MAX_DEGREE; 
-    } else if (degree_angle < 0) {
-        degree_angle = 0;
+    for (int attempt = 0; attempt < attempts; attempt++) {
+        if (attempt > 0) {
+            vTaskDelay(pdMS_TO_TICKS(PCA9685_RETRY_BACKOFF_MS << (attempt - 1)) + 1);
+            portENTER_CRITICAL(&bus_stats_lock);
+            bus_stats.retries++;
+            portEXIT_CRITICAL(&bus_stats_lock);
+        }
+        TRACE_BEGIN(TRACE_SPAN_PCA9685_WRITE);
+        ret = write_steps(first, count);
+        TRACE_END(TRACE_SPAN_PCA9685_WRITE);
+        if (ret == ESP_OK) {
+            break;
+        }
+        ESP_LOGW(TAG, "servo %d..%d write failed: %s", first, first + count - 1, esp_err_to_name(ret));
     }
 
-    uint32_t pulse_width = servo_rot_to_pulsewidth(num,degree_angle);
-    
-    uint16_t step_on, step_off;
-    get_steps_on_off_pulse_width(num, &step_on,&step_off,pulse_width);
-    ESP_LOGI(TAG,"step on: %d, step off: %d", step_on, step_off);
+    portENTER_CRITICAL(&bus_stats_lock);
+    bus_stats.writes++;
+    if (ret != ESP_OK) {
+        bus_stats.failures++;
+    }
+    portEXIT_CRITICAL(&bus_stats_lock);
 
-    ret = setPWM(num, step_on, step_off);
+    if (ret == ESP_OK) {
+        consecutive_failures = 0;
+        if (degraded) {
+            ESP_LOGW(TAG, "pca9685 writes succeeding again, leaving degraded mode");
+            degraded = false;
+        }
+        return ESP_OK;
+    }
 
-    if(ret == ESP_ERR_TIMEOUT)
-    {
-        ESP_LOGI(TAG, "I2C timeout");
+    consecutive_failures++;
+    if (!degraded && consecutive_failures >= PCA9685_DEGRADED_AFTER) {
+        ESP_LOGE(TAG, "%d failed commands in a row, pca9685 degraded", consecutive_failures);
+        degraded = true;
     }
-    else if(ret == ESP_OK)
-    {
+
+    /* a stuck slave holds the bus for everyone - try to free it, but not on every command */
+    int64_t now = esp_timer_get_time();
+    if (now - last_recovery_us >= PCA9685_RECOVERY_INTERVAL_US) {
+        last_recovery_us = now;
+        if (i2c_bus_recover() == ESP_OK) {
+            portENTER_CRITICAL(&bus_stats_lock);
+            bus_stats.recoveries++;
+            portEXIT_CRITICAL(&bus_stats_lock);
+        }
+    }
+    return ret;
+}
+
+esp_err_t set_pca9685_servo_ticks(uint8_t num, uint16_t ticks) {
+    esp_err_t ret;
+
+    ESP_LOGI(TAG,"Servo: %d -> step off: %d", num, ticks);
+    if (num >= MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    written_steps[num].on = 0;
+    written_steps[num].off = ticks;
+#ifdef SERVO_HEADLESS
+    ret = ESP_OK;
+#else
+    ret = write_pwm_with_retry(num, 1);
+#endif
+
+    if (ret == ESP_OK) {
         ESP_LOGI(TAG, "PWM set successfully");
     }
-    else
-    {
-        ESP_LOGE(TAG, "No ack, sensor not connected...skip...\n");
+    return ret;
+}
+
+esp_err_t set_pca9685_servo_ticks_many(uint16_t mask, const uint16_t *ticks) {
+    int first = -1;
+    int last = -1;
+
+    for (int num = 0; num < MAX_CHANNELS; num++) {
+        if (!(mask & (1U << num))) {
+            continue;
+        }
+        written_steps[num].on = 0;
+        written_steps[num].off = ticks[num];
+        if (first < 0) {
+            first = num;
+        }
+        last = num;
+    }
+    if (first < 0) {
+        return ESP_OK;
+    }
+
+    /* channels inside the span that are not being set are rewritten with their last steps */
+#ifdef SERVO_HEADLESS
+    return ESP_OK;
+#else
+    return write_pwm_with_retry(first, last - first + 1);
+#endif
+}
+
+esp_err_t set_pca9685_servo_angle(uint8_t num, uint32_t degree_angle) {
+    uint16_t ticks;
+
+    if (degree_angle > INT32_MAX
+        || servo_pca9685_position_to_ticks(num, SERVO_UNIT_DEGREES, degree_angle, &ticks) != ESP_OK) {
+        ESP_LOGE(TAG, "servo %d angle %u out of range or channel not configured, ignored", num, degree_angle);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return set_pca9685_servo_ticks(num, ticks);
+}
+
+void servo_pca9685_get_pwm_info(ServoPwmInfo *info) {
+    *info = pwm_info;
+}
+
+uint32_t servo_pca9685_resolution_millidegrees(uint8_t num) {
+    if (num >= MAX_CHANNELS || channels[num].max_pulse_us <= channels[num].min_pulse_us) {
+        return 0;
     }
-}
\ No newline at end of file
+
+    uint64_t span_ps = (uint64_t) (channels[num].max_pulse_us - channels[num].min_pulse_us) * 1000000;
+    return (uint64_t) channels[num].max_degree * 1000 * step_ps / span_ps;
+}
+
+bool servo_pca9685_degraded(void) {
+    return degraded;
+}
+
+void servo_pca9685_get_bus_stats(ServoBusStats *stats) {
+    portENTER_CRITICAL(&bus_stats_lock);
+    *stats = bus_stats;
+    portEXIT_CRITICAL(&bus_stats_lock);
+    stats->degraded = degraded;
+}
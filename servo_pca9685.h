@@ -1,29 +1,133 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * SERVO_HEADLESS - no PCA9685 attached. angles are converted to steps exactly as
+ * normal but nothing goes on the bus. with OLED_HEADLESS (oled_ssd1306.h) the whole
+ * app runs on a bare ESP32. the conversions are unit tested on the host, see host_test/.
+ */
+// #define SERVO_HEADLESS 1
+
+/*
+ * PWM frequency profiles. the frequency is one setting for the whole PCA9685, so every
+ * servo on a board has to accept it - analog servos can overheat or jitter above about 60Hz.
+ * a new setpoint reaches the output at the start of the next PWM period, so the period
+ * is the worst case latency the chip adds to a command: about 16.7ms at 60Hz, 3ms at 330Hz.
+ */
+#define SERVO_PWM_ANALOG_HZ 60          // analog servos
+#define SERVO_PWM_DIGITAL_HZ 200        // most digital servos
+#define SERVO_PWM_DIGITAL_FAST_HZ 330   // digital servos rated for 330Hz, pulses up to ~2900us
+
+/*
+ * the PCA9685 internal oscillator, nominally 25MHz but only within a few percent.
+ * if a scope shows the period off, put the measured frequency here - pulse widths are
+ * converted to steps with it.
+ */
+#define PCA9685_OSC_HZ 25000000
+
+/*
+ * units a servo position can be given in. at 60Hz a PCA9685 step is about 4us,
+ * roughly 0.35 degrees on a 2000us / 180 degree servo - finer than whole degrees.
+ * faster profiles have shorter steps: about 0.7us at 330Hz.
+ */
+typedef enum ServoUnit {
+    SERVO_UNIT_DEGREES,      // whole degrees, 0 .. the channel's max degree
+    SERVO_UNIT_MILLIDEGREES, // thousandths of a degree
+    SERVO_UNIT_US,           // pulse width in microseconds, min .. max pulse of the channel
+    SERVO_UNIT_TICKS,        // PCA9685 off step, the steps of the channel's pulse range
+    SERVO_UNIT_COUNT
+} ServoUnit;
+
+/*
+ * PCA9685 write health, see servo_pca9685_get_bus_stats()
+ */
+typedef struct ServoBusStats {
+    uint32_t writes;     // commands written, however many attempts they took
+    uint32_t retries;    // extra attempts after a failed write
+    uint32_t failures;   // commands that failed every attempt
+    uint32_t recoveries; // bus recoveries that reinstalled the driver
+    bool degraded;       // recent commands keep failing - single attempts until one succeeds
+} ServoBusStats;
+
+/*
+ * the PWM timing actually produced for the requested frequency, see servo_pca9685_get_pwm_info()
+ */
+typedef struct ServoPwmInfo {
+    uint16_t requested_hz;
+    uint8_t prescale;      // PRE_SCALE register value
+    uint32_t actual_mhz;   // frequency the prescaler gives, in millihertz
+    uint32_t period_us;    // one PWM period, the worst case wait for a new setpoint
+    uint32_t step_ns;      // one of the 4096 steps, the pulse width resolution
+} ServoPwmInfo;
+
 /**
  * @brief sets up the servo on given pin and initialises the mcpwm module on ESP32 for the pin
  *
  * @param  addr - the I2C address for the pca9685
- *
- * @return
- *     - calculated pulse width
+ * @param  pwm_hz - the PWM frequency, e.g. SERVO_PWM_ANALOG_HZ. the nearest the prescaler
+ *                  can do is used and logged with its resolution and latency.
  */
-void servo_pca9685_initialise(uint8_t addr);
+void servo_pca9685_initialise(uint8_t addr, uint16_t pwm_hz);
 
 /**
  * @brief Use this function to change the servo
  *
  * @param  num - the channel for the servo
- * @param degree_angle - the angle for the servo
+ * @param degree_angle - the angle for the servo, 0 .. the channel's max degree
+ *
+ * failed writes are retried with backoff and a stuck bus is recovered; after repeated
+ * failures the driver is degraded and makes one attempt per command until a write succeeds.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_INVALID_ARG for an unconfigured channel or an angle out of range, or the last I2C error
+ */
+esp_err_t set_pca9685_servo_angle(uint8_t num, uint32_t degree_angle);
+
+/**
+ * @brief set one channel to a PCA9685 off step (the pulse starts at step 0).
+ * retried and recovered like set_pca9685_servo_angle.
  *
  * @return
- *     - void
+ *     - ESP_OK, ESP_ERR_INVALID_ARG for a channel out of range, or the last I2C error
  */
-void set_pca9685_servo_angle(uint8_t num, uint32_t degree_angle);
+esp_err_t set_pca9685_servo_ticks(uint8_t num, uint16_t ticks);
+
+/**
+ * @brief set several channels in a single I2C transaction through the PCA9685 register auto increment.
+ *
+ * @param mask - bit n set for each channel n to change
+ * @param ticks - 16 off steps indexed by channel, only the masked ones are read
+ *
+ * the block runs from the lowest to the highest masked channel; channels in between keep
+ * their last steps. retried and recovered like set_pca9685_servo_angle.
+ *
+ * @return
+ *     - ESP_OK or the last I2C error
+ */
+esp_err_t set_pca9685_servo_ticks_many(uint16_t mask, const uint16_t *ticks);
+
+/**
+ * @brief convert a position to the channel's off step, to the nearest step.
+ * the value is range checked as signed against the channel's configured range:
+ * 0..max_degree, min_pulse_us..max_pulse_us, or the steps of those pulse widths.
+ *
+ * @return
+ *     - ESP_OK, ESP_ERR_INVALID_ARG if out of range or the channel is not configured,
+ *       ESP_ERR_INVALID_STATE before servo_pca9685_initialise
+ */
+esp_err_t servo_pca9685_position_to_ticks(uint8_t num, ServoUnit unit, int32_t value, uint16_t *ticks);
+
+/**
+ * @brief the angle an off step drives the channel to, in thousandths of a degree.
+ */
+int32_t servo_pca9685_ticks_to_millidegrees(uint8_t num, uint16_t ticks);
 
 /*
  * @brief set the servo characteristics for the channel
@@ -34,6 +138,26 @@ void set_pca9685_servo_angle(uint8_t num, uint32_t degree_angle);
  */
 void set_channel_min_max_pulse_us(uint8_t channel, uint32_t min_pulse_us, uint32_t max_pulse_us, uint32_t max_degree);
 
+/*
+ * @brief the PWM frequency, period and step length in use.
+ */
+void servo_pca9685_get_pwm_info(ServoPwmInfo *info);
+
+/*
+ * @brief the angle one step moves the channel, in thousandths of a degree. 0 if not configured.
+ */
+uint32_t servo_pca9685_resolution_millidegrees(uint8_t num);
+
+/*
+ * @brief true while PCA9685 writes keep failing.
+ */
+bool servo_pca9685_degraded(void);
+
+/*
+ * @brief copy out the write counters. safe to call from any task.
+ */
+void servo_pca9685_get_bus_stats(ServoBusStats *stats);
+
 /* 
  * dump out to log all the i2C devices.
  */
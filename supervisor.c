@@ -0,0 +1,321 @@
+/*
+ * task supervisor - stall checks, task watchdog, cpu and stack sampling.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+
+#include "app_ram.h"
+#include "supervisor.h"
+#include "trace.h"
+
+#define TAG "supervisor"
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+#define SUPERVISOR_RUN_TIME_STATS 1
+#endif
+
+typedef struct Supervised {
+    TaskHandle_t handle;
+    uint32_t stall_ms;
+    volatile uint32_t fed_ms;
+    bool stalled;              // reported, cleared by the next feed
+} Supervised;
+
+/* per task state carried between samples */
+typedef struct SampledTask {
+    TaskHandle_t handle;
+    uint32_t run_time;
+    bool warned;               // stack warning already logged
+} SampledTask;
+
+/***************************
+ * globals
+ ***************************/
+static StaticTask_t supervisorTaskBuffer;
+static StackType_t supervisorStack[SUPERVISOR_STACK_SIZE];
+static portMUX_TYPE supervisorLock = portMUX_INITIALIZER_UNLOCKED;
+static Supervised supervised[SUPERVISOR_MAX_SUPERVISED];
+static int supervisedCount;
+static SupervisorTaskStats taskStats[SUPERVISOR_MAX_TASKS];
+static int taskStatsCount;
+static SupervisorStats stats;
+
+static SampledTask sampled[SUPERVISOR_MAX_TASKS];
+static int sampledCount;
+#ifdef SUPERVISOR_RUN_TIME_STATS
+static TaskStatus_t taskStatus[SUPERVISOR_MAX_TASKS];
+static uint32_t lastTotalRunTime;
+#endif
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static int supervised_slot(TaskHandle_t handle)
+{
+    for (int i = 0; i < supervisedCount; i++) {
+        if (supervised[i].handle == handle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static SampledTask *find_sampled(const SampledTask *previous, int count, TaskHandle_t handle)
+{
+    for (int i = 0; i < count; i++) {
+        if (previous[i].handle == handle) {
+            return (SampledTask *) &previous[i];
+        }
+    }
+    return NULL;
+}
+
+static void warn_stack(SampledTask *task, const char *name, uint32_t stack_free)
+{
+    if (stack_free >= SUPERVISOR_STACK_WARN_BYTES || task->warned) {
+        return;
+    }
+    task->warned = true;
+    ESP_LOGW(TAG, "task %s has only %u bytes of stack left unused", name, stack_free);
+    portENTER_CRITICAL(&supervisorLock);
+    stats.stack_warnings++;
+    portEXIT_CRITICAL(&supervisorLock);
+}
+
+#ifdef SUPERVISOR_RUN_TIME_STATS
+/*
+ * every task's run time and stack high-water mark. cpu use is the change in run time
+ * since the previous sample, as a share of one core.
+ */
+static void sample_tasks(void)
+{
+    static SampledTask previous[SUPERVISOR_MAX_TASKS];
+    SupervisorTaskStats out[SUPERVISOR_MAX_TASKS];
+    uint32_t totalRunTime;
+
+    UBaseType_t count = uxTaskGetSystemState(taskStatus, SUPERVISOR_MAX_TASKS, &totalRunTime);
+    if (count == 0) {
+        ESP_LOGW(TAG, "%u tasks running, more than SUPERVISOR_MAX_TASKS - not sampled", uxTaskGetNumberOfTasks());
+        return;
+    }
+
+    int previousCount = sampledCount;
+    memcpy(previous, sampled, sizeof(previous));
+    uint32_t elapsed = totalRunTime - lastTotalRunTime;
+    lastTotalRunTime = totalRunTime;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *ts = &taskStatus[i];
+        SampledTask *was = find_sampled(previous, previousCount, ts->xHandle);
+        SampledTask *task = &sampled[i];
+
+        task->handle = ts->xHandle;
+        task->run_time = ts->ulRunTimeCounter;
+        task->warned = was != NULL && was->warned;
+
+        strlcpy(out[i].name, ts->pcTaskName, sizeof(out[i].name));
+        /* a task new since the last sample has no baseline yet */
+        out[i].cpu_permille = (was != NULL && elapsed > 0)
+            ? (uint16_t)((uint64_t)(ts->ulRunTimeCounter - was->run_time) * 1000 / elapsed) : 0;
+        out[i].stack_free = ts->usStackHighWaterMark;
+        out[i].supervised = supervised_slot(ts->xHandle);
+
+        warn_stack(task, out[i].name, out[i].stack_free);
+    }
+    sampledCount = count;
+
+    portENTER_CRITICAL(&supervisorLock);
+    memcpy(taskStats, out, count * sizeof(out[0]));
+    taskStatsCount = count;
+    stats.task_count = count;
+    stats.samples++;
+    portEXIT_CRITICAL(&supervisorLock);
+}
+#else
+/*
+ * without the trace facility only the supervised tasks' stacks can be looked at.
+ */
+static void sample_tasks(void)
+{
+    SupervisorTaskStats out[SUPERVISOR_MAX_SUPERVISED];
+    int count = supervisedCount;
+
+    for (int i = 0; i < count; i++) {
+        TaskHandle_t handle = supervised[i].handle;
+
+        sampled[i].handle = handle;
+        strlcpy(out[i].name, pcTaskGetTaskName(handle), sizeof(out[i].name));
+        out[i].cpu_permille = 0;
+        out[i].stack_free = uxTaskGetStackHighWaterMark(handle);
+        out[i].supervised = i;
+
+        warn_stack(&sampled[i], out[i].name, out[i].stack_free);
+    }
+    sampledCount = count;
+
+    portENTER_CRITICAL(&supervisorLock);
+    memcpy(taskStats, out, count * sizeof(out[0]));
+    taskStatsCount = count;
+    stats.task_count = uxTaskGetNumberOfTasks();
+    stats.samples++;
+    portEXIT_CRITICAL(&supervisorLock);
+}
+#endif
+
+static void stalled(Supervised *task, uint32_t silent_ms)
+{
+    ESP_LOGE(TAG, "task %s has not run its loop for %ums (stall time %ums)",
+             pcTaskGetTaskName(task->handle), silent_ms, task->stall_ms);
+    portENTER_CRITICAL(&supervisorLock);
+    stats.stalls++;
+    portEXIT_CRITICAL(&supervisorLock);
+
+    switch (SUPERVISOR_STALL_ACTION) {
+    case SUPERVISOR_ACTION_DUMP:
+#ifdef TRACE_ENABLED
+        trace_dump_serial();
+#endif
+        break;
+    case SUPERVISOR_ACTION_RESTART:
+        ESP_LOGE(TAG, "restarting");
+        esp_restart();
+        break;
+    default:
+        break;
+    }
+}
+
+static void check_stalls(void)
+{
+    uint32_t now = now_ms();
+
+    for (int i = 0; i < supervisedCount; i++) {
+        Supervised *task = &supervised[i];
+        uint32_t silent = now - task->fed_ms;
+
+        if (silent > task->stall_ms && !task->stalled) {
+            task->stalled = true;
+            stalled(task, silent);
+        }
+    }
+}
+
+static void supervisor_task(void *arg)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t sinceStats = SUPERVISOR_STATS_MS;
+
+    (void) arg;
+
+    for (;;) {
+        check_stalls();
+
+        sinceStats += SUPERVISOR_CHECK_MS;
+        if (sinceStats >= SUPERVISOR_STATS_MS) {
+            sinceStats = 0;
+            sample_tasks();
+        }
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SUPERVISOR_CHECK_MS));
+    }
+}
+
+esp_err_t supervisor_start(void)
+{
+    static TaskHandle_t task;
+
+    if (task != NULL) {
+        return ESP_OK;
+    }
+
+    /* already running if the sdkconfig enables it, its timeout and panic setting then stand */
+    esp_err_t err = esp_task_wdt_init(SUPERVISOR_WDT_TIMEOUT_S, SUPERVISOR_STALL_ACTION == SUPERVISOR_ACTION_RESTART);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "task watchdog not started: %s", esp_err_to_name(err));
+    }
+
+#ifdef SUPERVISOR_RUN_TIME_STATS
+    stats.run_time_stats = true;
+#else
+    ESP_LOGW(TAG, "no FreeRTOS run time stats in sdkconfig, cpu use is not measured");
+#endif
+
+    task = xTaskCreateStatic(supervisor_task, "supervisor", SUPERVISOR_STACK_SIZE,
+                             NULL, SUPERVISOR_PRIORITY, supervisorStack, &supervisorTaskBuffer);
+    app_ram_reserve(APP_RAM_SUPERVISOR, sizeof(supervisorTaskBuffer) + sizeof(supervisorStack)
+                    + sizeof(supervised) + sizeof(taskStats) + sizeof(sampled)
+#ifdef SUPERVISOR_RUN_TIME_STATS
+                    + sizeof(taskStatus)
+#endif
+                    );
+    return ESP_OK;
+}
+
+int supervisor_register(uint32_t stall_ms)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    int slot;
+
+    portENTER_CRITICAL(&supervisorLock);
+    slot = supervised_slot(self);
+    if (slot < 0 && supervisedCount < SUPERVISOR_MAX_SUPERVISED) {
+        slot = supervisedCount;
+        supervised[slot].handle = self;
+        supervised[slot].stall_ms = stall_ms;
+        supervised[slot].fed_ms = now_ms();
+        supervised[slot].stalled = false;
+        supervisedCount++;
+    }
+    portEXIT_CRITICAL(&supervisorLock);
+
+    if (slot < 0) {
+        ESP_LOGE(TAG, "more than %d supervised tasks, %s not supervised",
+                 SUPERVISOR_MAX_SUPERVISED, pcTaskGetTaskName(self));
+        return -1;
+    }
+    if (esp_task_wdt_add(NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "%s not added to the task watchdog", pcTaskGetTaskName(self));
+    }
+    ESP_LOGI(TAG, "supervising %s, stall after %ums", pcTaskGetTaskName(self), stall_ms);
+    return slot;
+}
+
+void supervisor_feed(int slot)
+{
+    if (slot < 0 || slot >= supervisedCount) {
+        return;
+    }
+    supervised[slot].fed_ms = now_ms();
+    if (supervised[slot].stalled) {
+        supervised[slot].stalled = false;
+        ESP_LOGW(TAG, "task %s running again", pcTaskGetTaskName(supervised[slot].handle));
+    }
+    esp_task_wdt_reset();
+}
+
+int supervisor_get_tasks(SupervisorTaskStats *tasks, int max)
+{
+    portENTER_CRITICAL(&supervisorLock);
+    int count = taskStatsCount < max ? taskStatsCount : max;
+    memcpy(tasks, taskStats, count * sizeof(tasks[0]));
+    portEXIT_CRITICAL(&supervisorLock);
+    return count;
+}
+
+void supervisor_get_stats(SupervisorStats *out)
+{
+    portENTER_CRITICAL(&supervisorLock);
+    *out = stats;
+    portEXIT_CRITICAL(&supervisorLock);
+}
@@ -0,0 +1,91 @@
+/*
+ * supervisor - watches the long running tasks so a hang or a stack about to
+ * overflow shows up before it becomes a crash.
+ *
+ * a supervised task registers itself and feeds the supervisor once per loop. each
+ * feed also resets the ESP-IDF task watchdog, which the task is added to, as the
+ * backstop if the supervisor itself cannot run. every SUPERVISOR_CHECK_MS the
+ * supervisor task looks for supervised tasks that have not fed within their stall
+ * time and takes SUPERVISOR_STALL_ACTION; every SUPERVISOR_STATS_MS it samples every
+ * task's cpu use and stack high-water mark for /metrics and the logs.
+ *
+ * cpu use needs CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS in sdkconfig; without them only the stack
+ * headroom of the supervised tasks and the stall checks are available.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SupervisorAction {
+    SUPERVISOR_ACTION_LOG,       // log the stalled task and carry on
+    SUPERVISOR_ACTION_DUMP,      // log, and dump the trace ring over serial (TRACE_ENABLED)
+    SUPERVISOR_ACTION_RESTART,   // log, then restart - the watchdog also panics instead of warning
+} SupervisorAction;
+
+#define SUPERVISOR_STALL_ACTION SUPERVISOR_ACTION_LOG
+#define SUPERVISOR_CHECK_MS 1000
+#define SUPERVISOR_STATS_MS 10000
+#define SUPERVISOR_WDT_TIMEOUT_S 10      // task watchdog, longer than any stall time so the supervisor acts first
+#define SUPERVISOR_STACK_WARN_BYTES 512  // headroom below this is logged, once per task
+#define SUPERVISOR_MAX_SUPERVISED 8
+#define SUPERVISOR_MAX_TASKS 24          // tasks sampled for cpu and stack, with more running the sample is skipped
+#define SUPERVISOR_STACK_SIZE (3 * 1024)
+#define SUPERVISOR_PRIORITY 2
+
+typedef struct SupervisorTaskStats {
+    char name[configMAX_TASK_NAME_LEN];
+    uint16_t cpu_permille;    // share of one core over the last sample period
+    uint32_t stack_free;      // bytes of stack never used, the high-water mark
+    int8_t supervised;        // slot from supervisor_register, -1 if not supervised
+} SupervisorTaskStats;
+
+typedef struct SupervisorStats {
+    uint32_t samples;         // cpu and stack samples taken
+    uint32_t stalls;          // times a supervised task missed its stall time
+    uint32_t stack_warnings;  // tasks seen below SUPERVISOR_STACK_WARN_BYTES
+    uint16_t task_count;      // tasks running at the last sample
+    bool run_time_stats;      // cpu use is being measured
+} SupervisorStats;
+
+/**
+ * @brief start the supervisor task and set up the task watchdog.
+ */
+esp_err_t supervisor_start(void);
+
+/**
+ * @brief supervise the calling task. call from the task itself, then supervisor_feed every loop.
+ *
+ * @param stall_ms - longest the task may go between feeds, e.g. its longest blocking wait plus margin
+ * @return
+ *     - the slot to feed, -1 if SUPERVISOR_MAX_SUPERVISED tasks are already registered
+ */
+int supervisor_register(uint32_t stall_ms);
+
+/**
+ * @brief the calling task is making progress. cheap, call once per loop.
+ */
+void supervisor_feed(int slot);
+
+/**
+ * @brief copy out the tasks from the last sample.
+ *
+ * @return the number of entries written, at most max
+ */
+int supervisor_get_tasks(SupervisorTaskStats *tasks, int max);
+
+/**
+ * @brief copy out the counters. safe to call from any task.
+ */
+void supervisor_get_stats(SupervisorStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
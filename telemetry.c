@@ -0,0 +1,325 @@
+/*
+ * telemetry sampler and batch uploader.
+ *
+ * the telemetry task takes a sample, folds in the result of the last upload and,
+ * when the interval is up, encodes the oldest unsent samples and hands the batch
+ * to the http worker. samples stay in the ring until the collector accepts them.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "app_ram.h"
+#include "http_worker.h"
+#include "oled_ssd1306.h"
+#include "servo_command.h"
+#include "servo_pca9685.h"
+#include "telemetry.h"
+
+#define TAG "telemetry"
+
+#define BATCH_HEADER_LEN 16
+#define VARINT_MAX_LEN 5
+
+typedef struct TelemetrySample {
+    uint32_t uptime_ms;
+    uint32_t free_heap;
+    uint32_t counters[METRIC_COUNTER_COUNT];
+    uint32_t health[TELEMETRY_HEALTH_COUNT];
+    int16_t angles[kServoChannelCount];
+    uint16_t latency[METRIC_HIST_COUNT][METRICS_HIST_BUCKETS]; // samples per bucket during the interval
+    uint8_t link_up;
+} TelemetrySample;
+
+/***************************
+ * globals
+ ***************************/
+static char collectorUrl[HTTP_WORKER_URL_LEN];
+static StaticTask_t telemetryTaskBuffer;
+static StackType_t telemetryStack[TELEMETRY_STACK_SIZE];
+
+/* ring slot of a sample is seq % TELEMETRY_RING_SAMPLES. only the telemetry task touches these */
+static TelemetrySample ring[TELEMETRY_RING_SAMPLES];
+static uint32_t headSeq; // next sample to write
+static uint32_t tailSeq; // oldest sample not yet accepted
+static AppMetrics lastMetrics;
+
+/* the batch in flight. the http worker reads batchBuf until upload_done runs */
+static uint8_t batchBuf[TELEMETRY_BATCH_BUF];
+static bool inFlight;
+static uint32_t batchSeq;
+static uint32_t batchCount;
+static uint32_t batchLen;
+
+/* written by upload_done on the worker task, read by the telemetry task */
+static portMUX_TYPE resultLock = portMUX_INITIALIZER_UNLOCKED;
+static bool resultReady;
+static bool resultOk;
+
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static TelemetryStats stats;
+
+static void take_sample(void)
+{
+    TelemetrySample *s = &ring[headSeq % TELEMETRY_RING_SAMPLES];
+    AppMetrics metrics;
+    GuiIpcStats ipc;
+    OledFlushStats flush;
+    HttpWorkerStats worker;
+    ServoBusStats bus;
+    bool dropped = false;
+
+    metrics_snapshot(&metrics);
+    gui_ipc_get_stats(&ipc);
+    oled_get_flush_stats(&flush);
+    http_worker_get_stats(&worker);
+    servo_pca9685_get_bus_stats(&bus);
+
+    s->uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    s->free_heap = esp_get_free_heap_size();
+    s->link_up = gui_ipc_link_up();
+    servo_command_get_angles(s->angles);
+    memcpy(s->counters, metrics.counters, sizeof(s->counters));
+    s->health[TELEMETRY_HEALTH_IPC_DROPPED] = ipc.dropped;
+    s->health[TELEMETRY_HEALTH_OLED_ERRORS] = flush.errors;
+    s->health[TELEMETRY_HEALTH_HTTP_REJECTED] = worker.rejected;
+    s->health[TELEMETRY_HEALTH_PCA_DEGRADED] = bus.degraded;
+    s->health[TELEMETRY_HEALTH_I2C_RECOVERIES] = bus.recoveries;
+
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            uint32_t n = metrics.histograms[h].buckets[b] - lastMetrics.histograms[h].buckets[b];
+            s->latency[h][b] = n > UINT16_MAX ? UINT16_MAX : n;
+        }
+    }
+    lastMetrics = metrics;
+
+    headSeq++;
+    if (headSeq - tailSeq > TELEMETRY_RING_SAMPLES) {
+        /* full - the oldest unsent sample was just overwritten */
+        tailSeq = headSeq - TELEMETRY_RING_SAMPLES;
+        dropped = true;
+    }
+
+    portENTER_CRITICAL(&statsLock);
+    stats.samples++;
+    if (dropped) {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&statsLock);
+}
+
+static void sample_fields(const TelemetrySample *s, uint32_t *f)
+{
+    f[TELEMETRY_FIELD_UPTIME_MS] = s->uptime_ms;
+    f[TELEMETRY_FIELD_LINK_UP] = s->link_up;
+    f[TELEMETRY_FIELD_FREE_HEAP] = s->free_heap;
+    for (int i = 0; i < kServoChannelCount; i++) {
+        f[TELEMETRY_FIELD_ANGLES + i] = (uint32_t)(int32_t) s->angles[i];
+    }
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        f[TELEMETRY_FIELD_COUNTERS + i] = s->counters[i];
+    }
+    for (int i = 0; i < TELEMETRY_HEALTH_COUNT; i++) {
+        f[TELEMETRY_FIELD_HEALTH + i] = s->health[i];
+    }
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+            f[TELEMETRY_FIELD_LATENCY + h * METRICS_HIST_BUCKETS + b] = s->latency[h][b];
+        }
+    }
+}
+
+static int put_varint(uint8_t *p, uint32_t v)
+{
+    int n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/*
+ * encode up to TELEMETRY_BATCH_MAX samples from tailSeq into batchBuf.
+ */
+static void encode_batch(uint32_t dropped)
+{
+    uint32_t prev[TELEMETRY_FIELD_COUNT] = {0};
+    uint32_t cur[TELEMETRY_FIELD_COUNT];
+    uint32_t pending = headSeq - tailSeq;
+    uint32_t pos = BATCH_HEADER_LEN;
+    uint32_t count = 0;
+
+    while (count < pending && count < TELEMETRY_BATCH_MAX) {
+        uint32_t start = pos;
+        bool full = false;
+
+        sample_fields(&ring[(tailSeq + count) % TELEMETRY_RING_SAMPLES], cur);
+        for (int k = 0; k < TELEMETRY_FIELD_COUNT; k++) {
+            if (pos + VARINT_MAX_LEN > sizeof(batchBuf)) {
+                full = true;
+                break;
+            }
+            /* zigzag so small negative differences stay short */
+            int32_t delta = (int32_t)(cur[k] - prev[k]);
+            pos += put_varint(&batchBuf[pos], ((uint32_t) delta << 1) ^ (uint32_t)(delta >> 31));
+        }
+        if (full) {
+            /* the rest goes in the next batch */
+            pos = start;
+            break;
+        }
+        memcpy(prev, cur, sizeof(prev));
+        count++;
+    }
+
+    memcpy(batchBuf, "TLM1", 4);
+    batchBuf[4] = TELEMETRY_VERSION;
+    batchBuf[5] = TELEMETRY_FIELD_COUNT;
+    batchBuf[6] = count;
+    batchBuf[7] = count >> 8;
+    put_u32(&batchBuf[8], tailSeq);
+    put_u32(&batchBuf[12], dropped);
+
+    batchSeq = tailSeq;
+    batchCount = count;
+    batchLen = pos;
+}
+
+/*
+ * runs on the http worker task.
+ */
+static void upload_done(const HttpWorkerResult *result, void *arg)
+{
+    (void) arg;
+
+    portENTER_CRITICAL(&resultLock);
+    resultOk = result->err == ESP_OK && result->status >= 200 && result->status < 300;
+    resultReady = true;
+    portEXIT_CRITICAL(&resultLock);
+}
+
+static void telemetry_task(void *pvParameter)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t backoff_ms = TELEMETRY_UPLOAD_MS;
+    int64_t next_upload_us = esp_timer_get_time() + TELEMETRY_UPLOAD_MS * 1000LL;
+
+    (void) pvParameter;
+
+    while (1) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(TELEMETRY_SAMPLE_MS));
+        take_sample();
+
+        bool ready, ok;
+        portENTER_CRITICAL(&resultLock);
+        ready = resultReady;
+        ok = resultOk;
+        resultReady = false;
+        portEXIT_CRITICAL(&resultLock);
+
+        if (ready) {
+            inFlight = false;
+            if (ok) {
+                /* samples overwritten while the batch was out are already past the tail */
+                if ((int32_t)(batchSeq + batchCount - tailSeq) > 0) {
+                    tailSeq = batchSeq + batchCount;
+                }
+                backoff_ms = TELEMETRY_UPLOAD_MS;
+                /* catch up straight away if one batch did not cover the backlog */
+                next_upload_us = (headSeq - tailSeq > TELEMETRY_BATCH_MAX) ? 0
+                                 : esp_timer_get_time() + backoff_ms * 1000LL;
+            } else {
+                backoff_ms = backoff_ms * 2 > TELEMETRY_BACKOFF_MAX_MS ? TELEMETRY_BACKOFF_MAX_MS : backoff_ms * 2;
+                next_upload_us = esp_timer_get_time() + backoff_ms * 1000LL;
+                ESP_LOGW(TAG, "upload failed, next try in %ums", backoff_ms);
+            }
+
+            portENTER_CRITICAL(&statsLock);
+            if (ok) {
+                stats.batches++;
+                stats.uploaded += batchCount;
+                stats.bytes += batchLen;
+            } else {
+                stats.failures++;
+            }
+            stats.backoff_ms = backoff_ms;
+            portEXIT_CRITICAL(&statsLock);
+        }
+
+        if (inFlight || headSeq == tailSeq || esp_timer_get_time() < next_upload_us) {
+            continue;
+        }
+
+        uint32_t dropped;
+        portENTER_CRITICAL(&statsLock);
+        dropped = stats.dropped;
+        portEXIT_CRITICAL(&statsLock);
+
+        encode_batch(dropped);
+        if (http_worker_submit(collectorUrl, HTTP_METHOD_POST, (const char *) batchBuf, batchLen,
+                               NULL, upload_done, NULL) == ESP_OK) {
+            inFlight = true;
+            ESP_LOGD(TAG, "queued %u samples in %u bytes", batchCount, batchLen);
+        } else {
+            /* worker busy - try again next sample */
+            ESP_LOGD(TAG, "worker queue full, batch deferred");
+        }
+    }
+}
+
+esp_err_t telemetry_start(const char *collector_url)
+{
+    static TaskHandle_t task;
+
+    if (task != NULL) {
+        return ESP_OK;
+    }
+    if (strlen(collector_url) >= sizeof(collectorUrl)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    strcpy(collectorUrl, collector_url);
+
+    esp_err_t err = http_worker_start();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    metrics_snapshot(&lastMetrics);
+    stats.backoff_ms = TELEMETRY_UPLOAD_MS;
+
+    task = xTaskCreateStatic(telemetry_task, "telemetry", TELEMETRY_STACK_SIZE,
+                             NULL, TELEMETRY_PRIORITY, telemetryStack, &telemetryTaskBuffer);
+    app_ram_reserve(APP_RAM_TELEMETRY, sizeof(telemetryTaskBuffer) + sizeof(telemetryStack)
+                    + sizeof(ring) + sizeof(batchBuf));
+
+    ESP_LOGI(TAG, "sampling every %dms, uploading to %s", TELEMETRY_SAMPLE_MS, collectorUrl);
+    return ESP_OK;
+}
+
+void telemetry_get_stats(TelemetryStats *out)
+{
+    portENTER_CRITICAL(&statsLock);
+    *out = stats;
+    portEXIT_CRITICAL(&statsLock);
+}
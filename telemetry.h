@@ -0,0 +1,82 @@
+/*
+ * telemetry - samples servo state, latency and health into a RAM ring and
+ * uploads it to a collector in batches.
+ *
+ * one sample every TELEMETRY_SAMPLE_MS, one POST every TELEMETRY_UPLOAD_MS.
+ * if the collector is down the upload interval doubles up to TELEMETRY_BACKOFF_MAX_MS;
+ * once the ring is full the oldest samples are overwritten and counted as dropped.
+ *
+ * batch format (application/octet-stream, little endian):
+ *   "TLM1" | u8 version | u8 field count | u16 sample count | u32 first sample seq | u32 samples dropped
+ *   then one record per sample of `field count` zigzag varints. the first record holds the
+ *   field values, every later record the difference from the record before it, so
+ *   slowly moving values cost a byte each. fields are listed by TELEMETRY_FIELD_*.
+ *
+ * tools/telemetry_collector.py decodes batches on a host.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "app.h"
+#include "app_metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_SAMPLE_MS 2000
+#define TELEMETRY_UPLOAD_MS 20000
+#define TELEMETRY_BACKOFF_MAX_MS 64000
+#define TELEMETRY_RING_SAMPLES 48   // ~12.7KB at 264 bytes a sample, 96 seconds of history, longer than the largest backoff
+#define TELEMETRY_BATCH_MAX 16      // samples per POST
+#define TELEMETRY_BATCH_BUF 2048    // encoded batch, samples that do not fit wait for the next one
+#define TELEMETRY_STACK_SIZE (3 * 1024)
+#define TELEMETRY_PRIORITY 1
+
+#define TELEMETRY_VERSION 1
+
+/* health counters carried in every sample */
+#define TELEMETRY_HEALTH_IPC_DROPPED 0
+#define TELEMETRY_HEALTH_OLED_ERRORS 1
+#define TELEMETRY_HEALTH_HTTP_REJECTED 2
+#define TELEMETRY_HEALTH_PCA_DEGRADED 3
+#define TELEMETRY_HEALTH_I2C_RECOVERIES 4
+#define TELEMETRY_HEALTH_COUNT 5
+
+/* field order of an encoded record */
+#define TELEMETRY_FIELD_UPTIME_MS 0
+#define TELEMETRY_FIELD_LINK_UP 1
+#define TELEMETRY_FIELD_FREE_HEAP 2
+#define TELEMETRY_FIELD_ANGLES 3                                               // kServoChannelCount angles
+#define TELEMETRY_FIELD_COUNTERS (TELEMETRY_FIELD_ANGLES + kServoChannelCount) // MetricCounter totals
+#define TELEMETRY_FIELD_HEALTH (TELEMETRY_FIELD_COUNTERS + METRIC_COUNTER_COUNT)
+#define TELEMETRY_FIELD_LATENCY (TELEMETRY_FIELD_HEALTH + TELEMETRY_HEALTH_COUNT) // per histogram, bucket counts for the interval
+#define TELEMETRY_FIELD_COUNT (TELEMETRY_FIELD_LATENCY + METRIC_HIST_COUNT * METRICS_HIST_BUCKETS)
+
+typedef struct TelemetryStats {
+    uint32_t samples;        // samples taken
+    uint32_t dropped;        // samples overwritten before they were uploaded
+    uint32_t batches;        // batches the collector accepted
+    uint32_t failures;       // batches that failed or were refused
+    uint32_t bytes;          // encoded bytes accepted
+    uint32_t uploaded;       // samples accepted
+    uint32_t backoff_ms;     // current upload interval
+} TelemetryStats;
+
+/**
+ * @brief start sampling and uploading. starts the http worker if it is not running.
+ *
+ * @param collector_url - POST target, copied
+ */
+esp_err_t telemetry_start(const char *collector_url);
+
+/**
+ * @brief copy out the uploader counters. safe from any task.
+ */
+void telemetry_get_stats(TelemetryStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
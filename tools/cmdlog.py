@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""
+Decode and replay the servo command log written by cmd_recorder.c.
+
+The input is the raw "cmdlog" partition, fetched from the device's http control
+server or read with esptool:
+
+    curl -o cmdlog.bin http://192.168.1.50/cmdlog
+    esptool.py read_flash <partition offset> <partition size> cmdlog.bin
+
+    python3 tools/cmdlog.py cmdlog.bin                     # list sessions
+    python3 tools/cmdlog.py cmdlog.bin --dump --csv out.csv
+    python3 tools/cmdlog.py cmdlog.bin --replay 192.168.1.50 --speed 4
+
+--replay plays a session (the newest unless --session is given) against POST /servos
+with the recorded timing divided by --speed (0 sends back to back), and reports the
+request latency, so a captured field session doubles as a regression benchmark. It
+works against tools/http_standin.py as well as a board.
+"""
+import argparse
+import csv
+import http.client
+import json
+import socket
+import struct
+import time
+
+# mirrors cmd_recorder.h
+SECTOR_SIZE = 4096
+MAGIC = 0x324C4D43               # "CML2"
+HEADER = struct.Struct("<IIII")   # magic, seq, session, reserved
+RECORD = struct.Struct("<IBBH")   # t_ms, channel, flags, low 16 bits of the value
+RECORD_END = 0xFFFFFFFF
+SOURCES = ["ros", "http", "replay", "sequence"]
+UNITS = ["deg", "mdeg", "us", "ticks"]
+
+
+def record_value(flags, low):
+    """flags bits 5-7 are value bits 16-18 of a 19 bit signed value."""
+    value = ((flags >> 5) << 16) | low
+    return value - (1 << 19) if value & (1 << 18) else value
+
+
+def read_sectors(data):
+    """yield (seq, session, records) for every valid sector, oldest first."""
+    sectors = []
+    for offset in range(0, len(data) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        magic, seq, session, _ = HEADER.unpack_from(data, offset)
+        if magic != MAGIC:
+            continue
+        records = []
+        for pos in range(offset + HEADER.size, offset + SECTOR_SIZE, RECORD.size):
+            t_ms, channel, flags, low = RECORD.unpack_from(data, pos)
+            if t_ms == RECORD_END:
+                break
+            source = flags & 0x07
+            records.append({"t_ms": t_ms, "channel": channel,
+                            "source": SOURCES[source] if source < len(SOURCES) else source,
+                            "unit": UNITS[(flags >> 3) & 0x03], "value": record_value(flags, low)})
+        sectors.append((seq, session, records))
+    sectors.sort(key=lambda s: s[0])
+    return sectors
+
+
+def sessions(data):
+    """group consecutive sectors by session, in recording order."""
+    grouped = []
+    for seq, session, records in read_sectors(data):
+        if grouped and grouped[-1]["session"] == session and grouped[-1]["last_seq"] + 1 == seq:
+            grouped[-1]["records"].extend(records)
+            grouped[-1]["last_seq"] = seq
+        else:
+            grouped.append({"session": session, "first_seq": seq, "last_seq": seq, "records": list(records)})
+    return grouped
+
+
+def percentile(samples, pct):
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+def replay(records, host, port, speed):
+    conn = http.client.HTTPConnection(host, port, timeout=5)
+    conn.connect()
+    conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+    latencies = []
+    failures = 0
+    late = 0
+    t0 = records[0]["t_ms"]
+    start = time.perf_counter()
+
+    for rec in records:
+        if speed > 0:
+            due = start + (rec["t_ms"] - t0) / 1000 / speed
+            wait = due - time.perf_counter()
+            if wait > 0:
+                time.sleep(wait)
+            elif wait < -0.01:
+                late += 1
+        if rec["unit"] == "mdeg":
+            # milli-degrees do not fit the binary records, json takes fractional degrees
+            path = "/servos"
+            body = json.dumps({str(rec["channel"]): rec["value"] / 1000}).encode()
+            content_type = "application/json"
+        else:
+            path = f"/servos?unit={rec['unit']}"
+            body = struct.pack("<BH", rec["channel"], rec["value"] & 0xFFFF)
+            content_type = "application/octet-stream"
+        sent = time.perf_counter()
+        conn.request("POST", path, body, {"Content-Type": content_type})
+        resp = conn.getresponse()
+        resp.read()
+        if resp.status != 200:
+            failures += 1
+        latencies.append((time.perf_counter() - sent) * 1e6)
+
+    elapsed = time.perf_counter() - start
+    conn.close()
+
+    recorded = (records[-1]["t_ms"] - t0) / 1000
+    print(f"replayed {len(records)} commands in {elapsed:.2f}s (recorded over {recorded:.2f}s), "
+          f"{failures} failed, {late} more than 10ms late")
+    print(f"latency us: p50 {percentile(latencies, 50):.0f}  p90 {percentile(latencies, 90):.0f}  "
+          f"p99 {percentile(latencies, 99):.0f}  max {max(latencies):.0f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="raw cmdlog partition image")
+    parser.add_argument("--session", type=lambda s: int(s, 16), help="session id in hex, default the newest")
+    parser.add_argument("--dump", action="store_true", help="print every record of the session")
+    parser.add_argument("--csv", help="write the session's records to a CSV file")
+    parser.add_argument("--replay", metavar="HOST", help="replay the session against POST /servos on HOST")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--speed", type=float, default=1, help="timing divisor, 0 for back to back")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as f:
+        data = f.read()
+
+    found = sessions(data)
+    for s in found:
+        records = s["records"]
+        span = (records[-1]["t_ms"] - records[0]["t_ms"]) / 1000 if records else 0
+        print(f"session {s['session']:08x}: sectors {s['first_seq']}..{s['last_seq']}, "
+              f"{len(records)} commands over {span:.1f}s")
+    if not found:
+        print("no recorded sectors")
+        return
+
+    chosen = found[-1] if args.session is None else next((s for s in found if s["session"] == args.session), None)
+    if chosen is None:
+        raise SystemExit(f"no session {args.session:08x}")
+    records = chosen["records"]
+
+    if args.dump:
+        for rec in records:
+            print(f"{rec['t_ms']:10d} ms  ch {rec['channel']:2d}  {rec['value']:6d} {rec['unit']}  {rec['source']}")
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=["t_ms", "channel", "value", "unit", "source"])
+            writer.writeheader()
+            writer.writerows(records)
+    if args.replay and records:
+        replay(records, args.replay, args.port, args.speed)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Cut the display snapshot out of a serial capture and compare it with a golden image.
+
+With GUI_BENCHMARK (gui_benchmark.h) the board prints the last committed frame as a
+plain text PBM between the PBM BEGIN / PBM END markers. Capture the console and:
+
+    idf.py monitor | tee capture.log        # or any terminal that logs to a file
+    python3 tools/gui_snapshot.py capture.log --out frame.pbm
+    python3 tools/gui_snapshot.py capture.log --golden tools/golden/benchmark.pbm
+    python3 tools/gui_snapshot.py capture.log --golden tools/golden/benchmark.pbm --update
+
+The last snapshot in the capture is used. CR LF line endings, terminal colour codes
+and log lines from other tasks that land between pixel rows are skipped. A comparison
+fails (exit 1) when more than --tolerance pixels differ; --diff writes an image with
+only the differing pixels lit. --update writes the snapshot as the new golden.
+
+Goldens are plain PBM (P1) files, so a change to one reads as a text diff in review.
+Check a new golden by eye before committing it. tools/golden/host_dashboard.pbm is the
+dashboard host_test/test_oled_snapshot.c renders from servo and link events; ctest checks
+it and this script against each other.
+"""
+import argparse
+import re
+import sys
+
+BEGIN = "----- PBM BEGIN -----"   # mirrors gui_benchmark.h
+END = "----- PBM END -----"
+ANSI = re.compile(r"\x1b\[[0-9;]*m")
+DIMENSIONS = re.compile(r"^(\d+) (\d+)$")
+PIXELS = re.compile(r"^[01]+$")
+
+
+def extract(text):
+    """return (width, height, rows, skipped lines) of the last snapshot in a capture."""
+    lines = [ANSI.sub("", line).strip() for line in text.splitlines()]
+    begins = [i for i, line in enumerate(lines) if line == BEGIN]
+    if not begins:
+        raise ValueError("no snapshot in the capture")
+    start = begins[-1] + 1
+    end = next((i for i in range(start, len(lines)) if lines[i] == END), None)
+    if end is None:
+        raise ValueError("the last snapshot has no end marker, the capture was cut short")
+
+    width = height = None
+    rows = []
+    skipped = 0
+    seen_magic = False
+    for line in lines[start:end]:
+        if not seen_magic:
+            seen_magic = line == "P1"
+            skipped += line != "" and not seen_magic
+            continue
+        if width is None:
+            m = DIMENSIONS.match(line)
+            if m:
+                width, height = int(m.group(1)), int(m.group(2))
+            else:
+                skipped += line != ""
+            continue
+        if PIXELS.match(line) and len(line) == width:
+            rows.append([int(c) for c in line])
+        else:
+            skipped += line != ""
+
+    if width is None:
+        raise ValueError("the snapshot has no P1 header")
+    if len(rows) != height:
+        raise ValueError(f"the snapshot has {len(rows)} of {height} rows")
+    return width, height, rows, skipped
+
+
+def read_pbm(path):
+    """read a plain PBM (P1) file, '#' comments allowed."""
+    with open(path) as f:
+        tokens = " ".join(line.split("#", 1)[0] for line in f).split()
+    if not tokens or tokens[0] != "P1":
+        raise ValueError(f"{path} is not a plain PBM (P1) file")
+    width, height = int(tokens[1]), int(tokens[2])
+    digits = "".join(tokens[3:])
+    if len(digits) != width * height:
+        raise ValueError(f"{path} holds {len(digits)} of {width * height} pixels")
+    return width, height, [[int(c) for c in digits[y * width:(y + 1) * width]] for y in range(height)]
+
+
+def write_pbm(path, width, height, rows):
+    with open(path, "w", newline="\n") as f:
+        f.write(f"P1\n{width} {height}\n")
+        for row in rows:
+            f.write("".join(str(p) for p in row) + "\n")
+
+
+def compare(snapshot, golden):
+    """return (differing pixel count, bounding box or None, diff rows)."""
+    _, _, rows = snapshot
+    _, _, golden_rows = golden
+    diff = [[a ^ b for a, b in zip(r, g)] for r, g in zip(rows, golden_rows)]
+    points = [(x, y) for y, row in enumerate(diff) for x, p in enumerate(row) if p]
+    if not points:
+        return 0, None, diff
+    xs = [x for x, _ in points]
+    ys = [y for _, y in points]
+    return len(points), (min(xs), min(ys), max(xs), max(ys)), diff
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", help="serial console capture")
+    parser.add_argument("--out", help="write the snapshot to a PBM file")
+    parser.add_argument("--golden", help="PBM file to compare the snapshot with")
+    parser.add_argument("--tolerance", type=int, default=0, help="differing pixels allowed, default 0")
+    parser.add_argument("--diff", help="write the differing pixels to a PBM file")
+    parser.add_argument("--update", action="store_true", help="write the snapshot as the golden instead")
+    args = parser.parse_args()
+
+    with open(args.capture, encoding="utf-8", errors="replace") as f:
+        try:
+            width, height, rows, skipped = extract(f.read())
+        except ValueError as e:
+            raise SystemExit(f"{args.capture}: {e}")
+    lit = sum(map(sum, rows))
+    print(f"snapshot {width}x{height}, {lit} pixels lit, {skipped} interleaved lines skipped")
+
+    if args.out:
+        write_pbm(args.out, width, height, rows)
+    if not args.golden:
+        return
+    if args.update:
+        write_pbm(args.golden, width, height, rows)
+        print(f"updated {args.golden}")
+        return
+
+    golden = read_pbm(args.golden)
+    if golden[:2] != (width, height):
+        raise SystemExit(f"snapshot is {width}x{height}, {args.golden} is {golden[0]}x{golden[1]}")
+    count, box, diff = compare((width, height, rows), golden)
+    if args.diff:
+        write_pbm(args.diff, width, height, diff)
+    if count == 0:
+        print(f"matches {args.golden}")
+        return
+    print(f"{count} pixels differ from {args.golden}, within x {box[0]}..{box[2]} y {box[1]}..{box[3]}")
+    if count > args.tolerance:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+Benchmark the device's http control endpoint from a Linux host.
+
+Sends batches of servo commands to POST /servos and reports request latency
+and throughput, then prints the device's own view from GET /metrics.
+
+    python3 tools/http_bench.py 192.168.1.50 --count 500 --channels 2 --format binary
+    python3 tools/http_bench.py 192.168.1.50 --no-keepalive     # a new connection per request
+
+Without a board, tools/http_standin.py answers the same endpoints:
+
+    python3 tools/http_standin.py --port 8080 &
+    python3 tools/http_bench.py localhost --port 8080
+"""
+import argparse
+import http.client
+import json
+import socket
+import struct
+import time
+
+
+def encode(fmt, channels, angle):
+    if fmt == "binary":
+        return b"".join(struct.pack("<BH", ch, angle) for ch in range(channels)), "application/octet-stream"
+    return json.dumps({str(ch): angle for ch in range(channels)}).encode(), "application/json"
+
+
+def percentile(samples, pct):
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--count", type=int, default=200, help="requests to send")
+    parser.add_argument("--channels", type=int, default=2, help="servo channels per request")
+    parser.add_argument("--format", choices=["json", "binary"], default="json")
+    parser.add_argument("--no-keepalive", action="store_true", help="open a new connection for every request")
+    args = parser.parse_args()
+
+    conn = None
+    latencies = []
+    failures = 0
+    start = time.perf_counter()
+
+    for i in range(args.count):
+        # sweep 0..180 and back so the servos visibly move
+        angle = abs((i * 10) % 360 - 180)
+        body, content_type = encode(args.format, args.channels, angle)
+
+        if conn is None:
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=5)
+            conn.connect()
+            conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        t0 = time.perf_counter()
+        try:
+            conn.request("POST", "/servos", body, {"Content-Type": content_type})
+            resp = conn.getresponse()
+            resp.read()
+            if resp.status != 200:
+                failures += 1
+        except (OSError, http.client.HTTPException):
+            failures += 1
+            conn.close()
+            conn = None
+            continue
+        latencies.append((time.perf_counter() - t0) * 1e6)
+
+        if args.no_keepalive:
+            conn.close()
+            conn = None
+
+    elapsed = time.perf_counter() - start
+    if conn is not None:
+        conn.close()
+
+    if latencies:
+        print(f"{len(latencies)} requests in {elapsed:.2f}s, {len(latencies) / elapsed:.1f} req/s, {failures} failed")
+        print(f"latency us: p50 {percentile(latencies, 50):.0f}  p90 {percentile(latencies, 90):.0f}  "
+              f"p99 {percentile(latencies, 99):.0f}  max {max(latencies):.0f}")
+    else:
+        print(f"all {failures} requests failed")
+
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=5)
+    conn.request("GET", "/metrics")
+    resp = conn.getresponse()
+    print("\ndevice metrics:")
+    for line in resp.read().decode().splitlines():
+        # the per bucket lines are for scrapers, the totals are enough here
+        if line.startswith("#") or "_bucket{" in line:
+            continue
+        print(f"  {line}")
+    conn.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for httpbin.org, to exercise the device's keep-alive HTTP client.
+
+Speaks HTTP/1.1 with persistent connections and logs every new connection and
+request, so connection reuse by the device is visible on the console.
+
+    python3 tools/http_standin.py --port 8080
+
+then set HTTP_HEARTBEAT_URL in uros_task.c to http://<this machine>:8080/get
+
+also answers POST /servos and GET /metrics like the device, so tools/http_bench.py
+can be tried without a board.
+"""
+import argparse
+import json
+import socket
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+lock = threading.Lock()
+counters = {"connections": 0, "requests": 0}
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # keep connections open between requests
+
+    def setup(self):
+        super().setup()
+        # headers and body go out as separate writes, don't let nagle hold the body back
+        self.connection.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        with lock:
+            counters["connections"] += 1
+            self.connection_id = counters["connections"]
+        print(f"connection {self.connection_id} from {self.client_address[0]}:{self.client_address[1]}")
+
+    def reply(self, body):
+        data = json.dumps(body).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def handle_request(self):
+        length = int(self.headers.get("Content-Length", 0))
+        payload = self.rfile.read(length) if length else b""
+        with lock:
+            counters["requests"] += 1
+            requests = counters["requests"]
+        print(f"  {self.command} {self.path} on connection {self.connection_id}, "
+              f"{len(payload)} byte body ({requests} requests / {counters['connections']} connections)")
+        if self.command == "POST" and self.path.split("?")[0] == "/servos":
+            # same reply shape as the device's http control endpoint
+            if self.headers.get("Content-Type", "").startswith("application/octet-stream"):
+                applied = len(payload) // 3
+            else:
+                applied = len(json.loads(payload or b"{}"))
+            self.reply({"applied": applied})
+        elif self.path == "/metrics":
+            text = "".join(f"{name} {value}\n" for name, value in counters.items()).encode()
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Content-Length", str(len(text)))
+            self.end_headers()
+            self.wfile.write(text)
+        else:
+            self.reply({"url": self.path, "connection": self.connection_id, "requests": requests})
+
+    do_GET = handle_request
+    do_POST = handle_request
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    print(f"listening on {args.host}:{args.port}")
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
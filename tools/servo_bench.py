@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""
+End-to-end servo command benchmark over micro-ROS.
+
+Publishes tagged Int32 commands on the /servoN topics at a controlled rate and
+pattern, and times each one until the device acknowledges it on /servo_ack - which
+it does only after the PCA9685 write completed. Both timestamps come from this host,
+so no clock sync is needed. The latency is command to ack, transport both ways included.
+
+Build the firmware with SERVO_BENCH (uros_task.c), run the micro-ROS agent, then:
+
+    python3 tools/servo_bench.py --pattern single --rate 20 --duration 10
+    python3 tools/servo_bench.py --pattern all --rate 50 --json results/$(git rev-parse --short HEAD).json
+    python3 tools/servo_bench.py --pattern burst --burst 10 --rate 5 --metrics-url http://<device>/metrics
+
+A command's data is tag << 8 | angle. The device moves the servo to `angle` and echoes the data back.
+Reports are JSON with --json, so runs on different commits can be compared.
+"""
+import argparse
+import json
+import statistics
+import subprocess
+import time
+import urllib.request
+
+import rclpy
+from rclpy.node import Node
+from rclpy.qos import QoSProfile, ReliabilityPolicy
+from std_msgs.msg import Int32
+
+SERVO_TOPICS = ["/servo0/int32_subscriber", "/servo1/int32_subscriber"]
+ACK_TOPIC = "/servo_ack"
+TAG_LIMIT = 1 << 23  # data stays a positive int32
+
+
+class Bench(Node):
+    def __init__(self, args):
+        super().__init__("servo_bench")
+        qos = QoSProfile(depth=10, reliability=ReliabilityPolicy.BEST_EFFORT if args.best_effort
+                         else ReliabilityPolicy.RELIABLE)
+        self.pubs = [self.create_publisher(Int32, t, qos) for t in SERVO_TOPICS[:args.channels]]
+        self.create_subscription(Int32, ACK_TOPIC, self.on_ack, qos)
+        self.sent = {}      # tag -> publish time
+        self.latency = {}   # tag -> seconds
+        self.unknown = 0
+
+    def publish(self, channel, tag, angle):
+        msg = Int32()
+        msg.data = (tag << 8) | angle
+        self.sent[tag] = time.perf_counter()
+        self.pubs[channel].publish(msg)
+
+    def on_ack(self, msg):
+        now = time.perf_counter()
+        tag = msg.data >> 8
+        if tag in self.sent and tag not in self.latency:
+            self.latency[tag] = now - self.sent[tag]
+        else:
+            self.unknown += 1
+
+
+def schedule(args):
+    """
+    yield (offset seconds, channel) for every command of the run.
+    single - one channel at the rate; all - every channel each tick; burst - `burst` back to back each tick.
+    """
+    period = 1.0 / args.rate
+    ticks = int(args.duration * args.rate)
+    for tick in range(ticks):
+        t = tick * period
+        if args.pattern == "single":
+            yield t, 0
+        elif args.pattern == "all":
+            for ch in range(args.channels):
+                yield t, ch
+        else:
+            for i in range(args.burst):
+                yield t, i % args.channels
+
+
+def percentile(ordered, pct):
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+def device_metrics(url):
+    try:
+        with urllib.request.urlopen(url, timeout=3) as resp:
+            lines = resp.read().decode().splitlines()
+    except OSError as e:
+        return {"error": str(e)}
+    out = {}
+    for line in lines:
+        if line.startswith("#") or "_bucket{" in line:
+            continue
+        name, _, value = line.partition(" ")
+        out[name] = int(value)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--pattern", choices=["single", "all", "burst"], default="single")
+    parser.add_argument("--rate", type=float, default=10.0, help="ticks per second")
+    parser.add_argument("--burst", type=int, default=8, help="commands per tick for --pattern burst")
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds of publishing")
+    parser.add_argument("--channels", type=int, default=len(SERVO_TOPICS), choices=range(1, len(SERVO_TOPICS) + 1))
+    parser.add_argument("--settle", type=float, default=2.0, help="seconds to wait for late acks")
+    parser.add_argument("--best-effort", action="store_true", help="best effort qos instead of reliable")
+    parser.add_argument("--metrics-url", help="device /metrics to include (HTTP_CONTROL build)")
+    parser.add_argument("--label", help="name for the run, default git describe")
+    parser.add_argument("--json", help="write the report here")
+    args = parser.parse_args()
+
+    rclpy.init()
+    bench = Bench(args)
+
+    # let discovery finish before the clock starts
+    wait_until = time.perf_counter() + 2.0
+    while time.perf_counter() < wait_until:
+        rclpy.spin_once(bench, timeout_sec=0.05)
+
+    start = time.perf_counter()
+    for tag, (offset, channel) in enumerate(schedule(args), start=1):
+        while time.perf_counter() < start + offset:
+            rclpy.spin_once(bench, timeout_sec=max(0.0, min(0.005, start + offset - time.perf_counter())))
+        angle = 30 + (tag * 7) % 120
+        bench.publish(channel, tag % TAG_LIMIT, angle)
+    send_end = time.perf_counter()
+
+    settle_until = send_end + args.settle
+    while time.perf_counter() < settle_until and len(bench.latency) < len(bench.sent):
+        rclpy.spin_once(bench, timeout_sec=0.05)
+
+    acked_times = sorted(bench.sent[t] + l for t, l in bench.latency.items())
+    lat_us = sorted(l * 1e6 for l in bench.latency.values())
+    sent = len(bench.sent)
+    acked = len(lat_us)
+    span = (acked_times[-1] - acked_times[0]) if acked > 1 else 0.0
+
+    label = args.label
+    if label is None:
+        try:
+            label = subprocess.run(["git", "describe", "--always", "--dirty"], capture_output=True,
+                                   text=True, check=True).stdout.strip()
+        except (OSError, subprocess.CalledProcessError):
+            label = "unknown"
+
+    report = {
+        "label": label,
+        "pattern": args.pattern,
+        "offered_rate": sent / (send_end - start) if send_end > start else 0.0,
+        "sustained_rate": (acked - 1) / span if span > 0 else 0.0,
+        "sent": sent,
+        "acked": acked,
+        "dropped": sent - acked,
+        "unexpected_acks": bench.unknown,
+    }
+    if lat_us:
+        report["latency_us"] = {
+            "p50": percentile(lat_us, 50), "p90": percentile(lat_us, 90), "p99": percentile(lat_us, 99),
+            "max": lat_us[-1], "mean": statistics.fmean(lat_us),
+        }
+    if args.metrics_url:
+        report["device"] = device_metrics(args.metrics_url)
+
+    print(f"{label} {args.pattern}: sent {sent} at {report['offered_rate']:.1f}/s, "
+          f"acked {acked} at {report['sustained_rate']:.1f}/s, dropped {report['dropped']}")
+    if lat_us:
+        l = report["latency_us"]
+        print(f"command to ack us: p50 {l['p50']:.0f}  p90 {l['p90']:.0f}  p99 {l['p99']:.0f}  max {l['max']:.0f}")
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+            f.write("\n")
+
+    bench.destroy_node()
+    rclpy.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""
+Report per-component flash and RAM use of a firmware build and the boot phase times
+of a running board, and fail when either is over the budget in tools/size_budget.json.
+
+Sizes come from the linker map through ESP-IDF's idf_size.py (per archive, i.e. per
+component); the totals and any listed archive are checked.
+
+    python3 tools/size_budget.py build/micro-ros_app.map
+    python3 tools/size_budget.py build/micro-ros_app.map --update --pin libmain.a --pin liblvgl.a
+
+Boot times come from the boot_phase_ms lines of the board's /metrics (HTTP_CONTROL
+build), read from the board or from a saved copy; phases listed under "boot_ms" are
+checked, and a listed phase the board has not reached fails.
+
+    python3 tools/size_budget.py --boot http://<device>/metrics
+    python3 tools/size_budget.py build/micro-ros_app.map --boot metrics.txt
+
+flash counts what goes into the image: code, rodata, IRAM code and initialised data.
+ram counts DRAM data, bss and IRAM. exits 1 when over budget, so it can gate CI.
+
+The totals are set by hand: flash is the 1 MB factory partition, ram leaves the
+rest of the ESP32's 320K of internal SRAM to the heap that wi-fi, lwip and the
+http server allocate from at run time. No archive is listed until one is pinned
+from a known-good build: --update rewrites every listed archive, --pin adds one.
+An archive listed with no numbers is an error rather than a pass.
+
+The boot limits are the start up waits in boot_profile.h: i2c_ready within
+BOOT_I2C_WAIT_MS, network_ready within BOOT_NET_WAIT_MS, and the phases that depend
+on them half a second after. Phases after servers_ready wait on the micro-ROS
+agent and an operator, so they are not budgeted.
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import urllib.request
+
+DEFAULT_BUDGET = os.path.join(os.path.dirname(os.path.abspath(__file__)), "size_budget.json")
+BOOT_PHASE = re.compile(r'^boot_phase_ms\{phase="([a-z0-9_]+)"\} (\d+)$')
+
+
+def archive_sizes(args):
+    if args.json:
+        with open(args.json) as f:
+            return json.load(f)
+    idf_size = args.idf_size or os.path.join(os.environ.get("IDF_PATH", ""), "tools", "idf_size.py")
+    if not os.path.exists(idf_size):
+        sys.exit("idf_size.py not found - source the ESP-IDF environment or pass --idf-size")
+    out = subprocess.run([sys.executable, idf_size, "--archives", "--json", args.map],
+                         check=True, capture_output=True, text=True).stdout
+    return json.loads(out)
+
+
+def classify(sections):
+    """
+    fold idf_size section names, which vary between IDF releases
+    (".dram0.bss", "dram0.bss", "flash_text"...), into flash and ram bytes.
+    """
+    flash = ram = 0
+    for name, size in sections.items():
+        if not isinstance(size, int):
+            continue
+        key = name.lstrip(".").lower()
+        if key.startswith("total"):
+            continue
+        if "bss" in key:
+            ram += size
+        elif "iram" in key or ("dram" in key and "data" in key):
+            ram += size
+            flash += size
+        elif "flash" in key:
+            flash += size
+    return flash, ram
+
+
+def boot_phases(source):
+    """boot_phase_ms per phase from /metrics, a url or a saved copy."""
+    if source.startswith(("http://", "https://")):
+        with urllib.request.urlopen(source, timeout=5) as resp:
+            text = resp.read().decode()
+    else:
+        with open(source) as f:
+            text = f.read()
+    phases = {}
+    for line in text.splitlines():
+        m = BOOT_PHASE.match(line.strip())
+        if m:
+            phases[m.group(1)] = int(m.group(2))
+    return phases
+
+
+def check_sizes(args, budget, over):
+    sizes = {name: classify(sections) for name, sections in archive_sizes(args).items()}
+    total_flash = sum(f for f, _ in sizes.values())
+    total_ram = sum(r for _, r in sizes.values())
+
+    print(f"{'archive':<36} {'flash':>9} {'ram':>9}")
+    for name, (flash, ram) in sorted(sizes.items(), key=lambda kv: -kv[1][0])[:args.top]:
+        print(f"{name:<36} {flash:>9} {ram:>9}")
+    print(f"{'total':<36} {total_flash:>9} {total_ram:>9}")
+
+    limits = budget.get("total", {})
+    for kind, used in (("flash", total_flash), ("ram", total_ram)):
+        if kind in limits and used > limits[kind]:
+            over.append(f"total {kind} {used} > {limits[kind]}")
+    for name, limits in budget.get("archives", {}).items():
+        flash, ram = sizes.get(name, (0, 0))
+        if "flash" not in limits and "ram" not in limits:
+            over.append(f"{name} has no budget - pin it with --update on a known-good build")
+            continue
+        for kind, used in (("flash", flash), ("ram", ram)):
+            if kind in limits and used > limits[kind]:
+                over.append(f"{name} {kind} {used} > {limits[kind]}")
+
+
+def check_boot(source, budget, over):
+    phases = boot_phases(source)
+
+    print(f"\n{'boot phase':<36} {'ms':>9} {'budget':>9}")
+    for name, limit in budget.get("boot_ms", {}).items():
+        ms = phases.get(name)
+        print(f"{name:<36} {'-' if ms is None else ms:>9} {limit:>9}")
+        if ms is None:
+            over.append(f"boot phase {name} not reached")
+        elif ms > limit:
+            over.append(f"boot phase {name} {ms} ms > {limit}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", nargs="?", help="linker map of the firmware build")
+    parser.add_argument("--json", help="use saved `idf_size.py --archives --json` output instead of a map")
+    parser.add_argument("--idf-size", help="path to idf_size.py, default $IDF_PATH/tools/idf_size.py")
+    parser.add_argument("--budget", default=DEFAULT_BUDGET)
+    parser.add_argument("--top", type=int, default=15, help="archives to list")
+    parser.add_argument("--update", action="store_true", help="rewrite the archive budgets from this build")
+    parser.add_argument("--pin", action="append", default=[], metavar="ARCHIVE",
+                        help="with --update, add an archive to the budget, repeatable")
+    parser.add_argument("--headroom", type=float, default=0.05, help="margin added by --update")
+    parser.add_argument("--boot", metavar="METRICS", help="check boot_phase_ms from a /metrics url or saved file")
+    args = parser.parse_args()
+    if not args.map and not args.json and not args.boot:
+        parser.error("give a map file, --json or --boot")
+    if args.update and not args.map and not args.json:
+        parser.error("--update needs a map file or --json")
+
+    with open(args.budget) as f:
+        budget = json.load(f)
+
+    if args.update:
+        sizes = {name: classify(sections) for name, sections in archive_sizes(args).items()}
+        archives = budget.setdefault("archives", {})
+        for name in args.pin:
+            if name not in sizes:
+                sys.exit(f"{name} is not in this build")
+            archives.setdefault(name, {})
+        grow = 1.0 + args.headroom
+        for name in archives:
+            if name in sizes:
+                archives[name] = {"flash": int(sizes[name][0] * grow), "ram": int(sizes[name][1] * grow)}
+        with open(args.budget, "w") as f:
+            json.dump(budget, f, indent=4)
+            f.write("\n")
+        print(f"budget for {len(archives)} archives written to {args.budget}")
+        return 0
+
+    over = []
+    if args.map or args.json:
+        check_sizes(args, budget, over)
+    if args.boot:
+        check_boot(args.boot, budget, over)
+
+    if over:
+        print("\nbudget check failed:")
+        for line in over:
+            print(f"  {line}")
+        return 1
+    print("\nwithin budget")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
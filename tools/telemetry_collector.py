@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Collector stub for the device's telemetry uploader (telemetry.c).
+
+Accepts POSTed TLM1 batches, decodes the delta/varint records and prints one
+line per sample, optionally appending every field to a CSV file.
+
+    python3 tools/telemetry_collector.py --port 8081 --csv telemetry.csv
+
+then set TELEMETRY_URL in uros_task.c to http://<this machine>:8081/telemetry.
+--down makes it answer 503 for the first N batches, to watch the device back off
+and then catch up from its ring.
+"""
+import argparse
+import csv
+import struct
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+# mirrors the TELEMETRY_FIELD_* layout in telemetry.h
+SERVO_CHANNELS = 16
+COUNTERS = ["servo_commands_ros", "servo_commands_http", "servo_commands_rejected", "servo_commands_failed",
+            "http_server_requests", "http_server_errors", "bench_acks", "bench_ack_errors",
+            "servo_commands_replay", "servo_commands_sequence"]
+HEALTH = ["gui_ipc_dropped", "oled_errors", "http_worker_rejected", "pca9685_degraded", "i2c_bus_recoveries"]
+HISTOGRAMS = ["actuate_ros_us", "actuate_http_us", "http_servos_request_us", "ros_command_us"]
+HIST_BUCKETS = 20
+FIELDS = (["uptime_ms", "link_up", "free_heap"]
+          + [f"angle{ch}" for ch in range(SERVO_CHANNELS)]
+          + COUNTERS + HEALTH
+          + [f"{h}_le{(1 << b) - 1 if b < HIST_BUCKETS - 1 else 'inf'}" for h in HISTOGRAMS for b in range(HIST_BUCKETS)])
+SIGNED = {f"angle{ch}" for ch in range(SERVO_CHANNELS)}
+
+
+def varints(data, pos):
+    while pos < len(data):
+        value = shift = 0
+        while True:
+            byte = data[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        yield value
+
+
+def decode(data):
+    magic, version, field_count, count, first_seq, dropped = struct.unpack_from("<4sBBHII", data)
+    if magic != b"TLM1" or version != 1:
+        raise ValueError(f"not a version 1 batch: {magic!r} v{version}")
+    if field_count != len(FIELDS):
+        raise ValueError(f"device sends {field_count} fields, collector knows {len(FIELDS)}")
+
+    values = varints(data, 16)
+    current = [0] * field_count
+    samples = []
+    for _ in range(count):
+        for k in range(field_count):
+            zz = next(values)
+            delta = (zz >> 1) ^ -(zz & 1)
+            current[k] = (current[k] + delta) & 0xFFFFFFFF
+        samples.append({name: (v - (1 << 32) if name in SIGNED and v & 0x80000000 else v)
+                        for name, v in zip(FIELDS, current)})
+    return first_seq, dropped, samples
+
+
+class Collector(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    lock = threading.Lock()
+    refuse = 0
+    writer = None
+    csv_file = None
+    last_seq = None
+
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        with Collector.lock:
+            if Collector.refuse > 0:
+                Collector.refuse -= 1
+                print(f"refusing {len(body)} byte batch ({Collector.refuse} more)")
+                self.respond(503)
+                return
+            try:
+                first_seq, dropped, samples = decode(body)
+            except (ValueError, struct.error, StopIteration) as e:
+                print(f"bad batch: {e}")
+                self.respond(400)
+                return
+
+            if Collector.last_seq is not None and first_seq > Collector.last_seq + 1:
+                print(f"gap: samples {Collector.last_seq + 1}..{first_seq - 1} lost on the device")
+            print(f"batch: {len(samples)} samples from #{first_seq} in {len(body)} bytes "
+                  f"({len(body) / max(len(samples), 1):.1f} bytes/sample), {dropped} dropped on device")
+            for i, s in enumerate(samples):
+                angles = " ".join(str(s[f"angle{ch}"]) for ch in range(SERVO_CHANNELS) if s[f"angle{ch}"])
+                print(f"  #{first_seq + i} t={s['uptime_ms']}ms link={s['link_up']} heap={s['free_heap']} "
+                      f"ros={s['servo_commands_ros']} http={s['servo_commands_http']} angles=[{angles}]"
+                      + (" PCA9685 DEGRADED" if s["pca9685_degraded"] else ""))
+                if Collector.writer:
+                    Collector.writer.writerow([first_seq + i] + [s[name] for name in FIELDS])
+            if Collector.csv_file:
+                Collector.csv_file.flush()
+            Collector.last_seq = first_seq + len(samples) - 1
+        self.respond(204)
+
+    def respond(self, status):
+        self.send_response(status)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8081)
+    parser.add_argument("--csv", help="append decoded samples to this file")
+    parser.add_argument("--down", type=int, default=0, metavar="N", help="refuse the first N batches with 503")
+    args = parser.parse_args()
+
+    Collector.refuse = args.down
+    if args.csv:
+        Collector.csv_file = open(args.csv, "a", newline="")
+        Collector.writer = csv.writer(Collector.csv_file)
+        if Collector.csv_file.tell() == 0:
+            Collector.writer.writerow(["seq"] + FIELDS)
+
+    server = ThreadingHTTPServer((args.host, args.port), Collector)
+    print(f"listening on {args.host}:{args.port}")
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+Convert a trace dump from the device (trace.c) into Chrome trace event JSON,
+which ui.perfetto.dev and chrome://tracing open directly.
+
+The dump is the text between "----- TRACE BEGIN -----" and "----- TRACE END -----",
+captured from the serial monitor or fetched from the http control server:
+
+    idf.py monitor | tee serial.log
+    python3 tools/trace_to_perfetto.py serial.log -o trace.json
+
+    curl http://<device>/trace > dump.txt
+    python3 tools/trace_to_perfetto.py dump.txt -o trace.json
+
+Spans become slices on the thread of the task that recorded them. Sampled task
+switches become a "cpu N" track per core showing which task was running.
+A serial log holding several dumps converts the last one unless --index is given.
+"""
+import argparse
+import json
+import sys
+
+BEGIN = "----- TRACE BEGIN -----"
+END = "----- TRACE END -----"
+PID = 1
+CPU_TID_BASE = 1000
+
+
+def dumps(lines):
+    current = None
+    for line in lines:
+        # serial monitor lines may carry a log prefix or colour codes before the marker
+        if BEGIN in line:
+            current = []
+        elif END in line and current is not None:
+            yield current
+            current = None
+        elif current is not None:
+            current.append(line.strip())
+
+
+def parse(dump):
+    spans, tasks, events = {}, {}, []
+    for line in dump:
+        parts = line.split()
+        if not parts:
+            continue
+        if parts[0] == "trace":
+            continue
+        if parts[0] == "span":
+            spans[int(parts[1])] = parts[2]
+        elif parts[0] == "task":
+            tasks[int(parts[1])] = " ".join(parts[2:])
+        else:
+            ts, kind, ident, core, task = parts
+            events.append((int(ts), kind, int(ident), int(core), int(task)))
+    return spans, tasks, events
+
+
+def unwrap(events):
+    """device timestamps are the low 32 bits of esp_timer, about 71 minutes before wrapping"""
+    offset, last = 0, None
+    for ts, *rest in events:
+        if last is not None and ts + offset < last - (1 << 31):
+            offset += 1 << 32
+        last = ts + offset
+        yield (last, *rest)
+
+
+def convert(spans, tasks, events):
+    out = [{"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "esp32"}}]
+    for slot, name in tasks.items():
+        out.append({"ph": "M", "pid": PID, "tid": slot, "name": "thread_name", "args": {"name": name}})
+
+    running = {}  # core -> (task slot, since)
+    cores = set()
+    for ts, kind, ident, core, task in unwrap(events):
+        if kind == "S":
+            cores.add(core)
+            if core in running:
+                slot, since = running[core]
+                out.append({"ph": "X", "pid": PID, "tid": CPU_TID_BASE + core, "ts": since, "dur": ts - since,
+                            "name": tasks.get(slot, f"task {slot}")})
+            running[core] = (ident, ts)
+        elif kind in ("B", "E"):
+            out.append({"ph": kind, "pid": PID, "tid": task, "ts": ts, "name": spans.get(ident, f"span {ident}"),
+                        "args": {"core": core}})
+
+    for core in sorted(cores):
+        out.append({"ph": "M", "pid": PID, "tid": CPU_TID_BASE + core, "name": "thread_name",
+                    "args": {"name": f"cpu {core}"}})
+        out.append({"ph": "M", "pid": PID, "tid": CPU_TID_BASE + core, "name": "thread_sort_index",
+                    "args": {"sort_index": -10 + core}})
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="serial log or dump text, - for stdin")
+    parser.add_argument("-o", "--output", default="trace.json")
+    parser.add_argument("--index", type=int, default=-1, help="which dump in the log, default the last")
+    args = parser.parse_args()
+
+    with (sys.stdin if args.input == "-" else open(args.input, errors="replace")) as f:
+        found = list(dumps(f))
+    if not found:
+        sys.exit("no trace dump found")
+
+    spans, tasks, events = parse(found[args.index])
+    trace = convert(spans, tasks, events)
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, f)
+    print(f"{len(events)} events from {len(tasks)} tasks -> {args.output}")
+
+
+if __name__ == "__main__":
+    main()
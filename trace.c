@@ -0,0 +1,211 @@
+/*
+ * trace ring and dump.
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_freertos_hooks.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "app_ram.h"
+#include "trace.h"
+
+#define TAG "trace"
+
+#define TRACE_NO_TASK 0xFF
+
+typedef struct TraceEvent {
+    uint32_t ts_us;
+    char kind;
+    uint8_t id;   // span, or the task slot switched in
+    uint8_t core;
+    uint8_t task; // task slot that recorded it
+} TraceEvent;
+
+typedef struct TraceTask {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+} TraceTask;
+
+static const char *spanNames[TRACE_SPAN_COUNT] = {
+    [TRACE_SPAN_EXECUTOR_SPIN] = "executor_spin",
+    [TRACE_SPAN_SPIN_SLEEP] = "spin_sleep",
+    [TRACE_SPAN_SERVO_COMMAND] = "servo_command",
+    [TRACE_SPAN_PCA9685_WRITE] = "pca9685_write",
+    [TRACE_SPAN_GUI_LOCK] = "gui_lock",
+    [TRACE_SPAN_LVGL] = "lvgl",
+    [TRACE_SPAN_OLED_FLUSH] = "oled_flush",
+    [TRACE_SPAN_HTTP_REQUEST] = "http_request",
+    [TRACE_SPAN_HTTP_SERVE] = "http_serve",
+};
+
+/***************************
+ * globals
+ ***************************/
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+static TraceEvent ring[TRACE_RING_EVENTS];
+static uint32_t head;             // events ever recorded, the next slot is head % TRACE_RING_EVENTS
+static volatile bool paused;
+static TraceTask tasks[TRACE_MAX_TASKS];
+static uint8_t taskCount;
+static TaskHandle_t lastTask[portNUM_PROCESSORS];
+
+static volatile bool dumpRequested;
+static int64_t lastDumpUs = -TRACE_DUMP_MIN_INTERVAL_US;
+
+/*
+ * slot for a task, registering it on first sight. caller holds traceLock.
+ */
+static uint8_t task_slot(TaskHandle_t handle)
+{
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if (tasks[i].handle == handle) {
+            return i;
+        }
+    }
+    if (handle == NULL || taskCount == TRACE_MAX_TASKS) {
+        return TRACE_NO_TASK;
+    }
+    tasks[taskCount].handle = handle;
+    strlcpy(tasks[taskCount].name, pcTaskGetTaskName(handle), sizeof(tasks[taskCount].name));
+    return taskCount++;
+}
+
+/*
+ * caller holds traceLock.
+ */
+static void put_event(char kind, uint8_t id, uint8_t core, uint8_t task)
+{
+    TraceEvent *e = &ring[head % TRACE_RING_EVENTS];
+
+    e->ts_us = (uint32_t) esp_timer_get_time();
+    e->kind = kind;
+    e->id = id;
+    e->core = core;
+    e->task = task;
+    head++;
+}
+
+void trace_record(char kind, uint8_t id)
+{
+    if (paused) {
+        return;
+    }
+
+    portENTER_CRITICAL_SAFE(&traceLock);
+    put_event(kind, id, xPortGetCoreID(), task_slot(xTaskGetCurrentTaskHandle()));
+    portEXIT_CRITICAL_SAFE(&traceLock);
+}
+
+/*
+ * tick hook, interrupt context - note which task this core is running when it changes.
+ */
+static void trace_tick_hook(void)
+{
+    int core = xPortGetCoreID();
+    TaskHandle_t current = xTaskGetCurrentTaskHandleForCPU(core);
+
+    if (paused || current == lastTask[core]) {
+        return;
+    }
+    lastTask[core] = current;
+
+    portENTER_CRITICAL_ISR(&traceLock);
+    uint8_t slot = task_slot(current);
+    put_event(TRACE_KIND_SWITCH, slot, core, slot);
+    portEXIT_CRITICAL_ISR(&traceLock);
+}
+
+esp_err_t trace_start(void)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        esp_err_t err = esp_register_freertos_tick_hook_for_cpu(trace_tick_hook, core);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Couldn't register tick hook on core %d: %s", core, esp_err_to_name(err));
+            return err;
+        }
+    }
+    app_ram_reserve(APP_RAM_TRACE, sizeof(ring) + sizeof(tasks));
+    ESP_LOGI(TAG, "recording, %d event ring", TRACE_RING_EVENTS);
+    return ESP_OK;
+}
+
+void trace_dump(trace_write_t write, void *arg)
+{
+    char line[64];
+    int len;
+
+    paused = true;
+    /* a record that got past the paused check just before may still land - at worst it replaces the oldest event */
+    portENTER_CRITICAL(&traceLock);
+    uint32_t end = head;
+    uint8_t count = taskCount;
+    portEXIT_CRITICAL(&traceLock);
+
+    uint32_t start = end > TRACE_RING_EVENTS ? end - TRACE_RING_EVENTS : 0;
+
+    len = snprintf(line, sizeof(line), "----- TRACE BEGIN -----\ntrace 1 %u %u %u\n",
+                   (uint32_t) esp_timer_get_time(), end - start, start);
+    write(line, len, arg);
+    for (int i = 0; i < TRACE_SPAN_COUNT; i++) {
+        len = snprintf(line, sizeof(line), "span %d %s\n", i, spanNames[i]);
+        write(line, len, arg);
+    }
+    for (int i = 0; i < count; i++) {
+        len = snprintf(line, sizeof(line), "task %d %s\n", i, tasks[i].name);
+        write(line, len, arg);
+    }
+    for (uint32_t n = start; n < end; n++) {
+        const TraceEvent *e = &ring[n % TRACE_RING_EVENTS];
+        len = snprintf(line, sizeof(line), "%u %c %u %u %u\n", e->ts_us, e->kind, e->id, e->core, e->task);
+        write(line, len, arg);
+    }
+    write("----- TRACE END -----\n", strlen("----- TRACE END -----\n"), arg);
+
+    paused = false;
+}
+
+static void write_stdout(const char *buf, size_t len, void *arg)
+{
+    (void) arg;
+    fwrite(buf, 1, len, stdout);
+}
+
+void trace_dump_serial(void)
+{
+    trace_dump(write_stdout, NULL);
+    fflush(stdout);
+}
+
+void trace_request_dump(void)
+{
+    int64_t now = esp_timer_get_time();
+    bool accepted = false;
+
+    portENTER_CRITICAL(&traceLock);
+    if (now - lastDumpUs >= TRACE_DUMP_MIN_INTERVAL_US) {
+        lastDumpUs = now;
+        accepted = true;
+    }
+    portEXIT_CRITICAL(&traceLock);
+
+    if (accepted) {
+        dumpRequested = true;
+    }
+}
+
+bool trace_take_dump_request(void)
+{
+    if (!dumpRequested) {
+        return false;
+    }
+    dumpRequested = false;
+    return true;
+}
@@ -0,0 +1,95 @@
+/*
+ * trace - named spans and task switches recorded into a RAM ring, for finding
+ * out what held things up when servo motion stutters.
+ *
+ * spans are TRACE_BEGIN / TRACE_END pairs around the interesting work. task switches
+ * are sampled from the FreeRTOS tick hook on each core, so they are seen at tick
+ * resolution; a task that runs for less than a tick between two others is missed.
+ * everything compiles away unless TRACE_ENABLED is defined.
+ *
+ * the ring is dumped as text between "----- TRACE BEGIN/END -----" markers over
+ * serial, or from GET /trace on the http control server.
+ * tools/trace_to_perfetto.py turns a dump into a Chrome / Perfetto trace.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// uncomment to record traces. costs TRACE_RING_EVENTS * 8 bytes of RAM.
+// #define TRACE_ENABLED 1
+
+#define TRACE_RING_EVENTS 2048
+#define TRACE_MAX_TASKS 16
+#define TRACE_DUMP_MIN_INTERVAL_US (10 * 1000 * 1000) // automatic dumps are at most this often
+
+typedef enum TraceSpan {
+    TRACE_SPAN_EXECUTOR_SPIN,   // rclc_executor_spin_some, transport and callbacks
+    TRACE_SPAN_SPIN_SLEEP,      // the usleep between spins
+    TRACE_SPAN_SERVO_COMMAND,   // ros callback, entry to I2C write complete
+    TRACE_SPAN_PCA9685_WRITE,   // the PCA9685 I2C transaction
+    TRACE_SPAN_GUI_LOCK,        // xGuiSemaphore held by the gui task
+    TRACE_SPAN_LVGL,            // lvgl timers and refresh
+    TRACE_SPAN_OLED_FLUSH,      // diffed windows sent to the SSD1306
+    TRACE_SPAN_HTTP_REQUEST,    // http worker request on the pooled client
+    TRACE_SPAN_HTTP_SERVE,      // http control server handler
+    TRACE_SPAN_COUNT
+} TraceSpan;
+
+#define TRACE_KIND_BEGIN 'B'
+#define TRACE_KIND_END 'E'
+#define TRACE_KIND_SWITCH 'S'
+
+#ifdef TRACE_ENABLED
+#define TRACE_BEGIN(span) trace_record(TRACE_KIND_BEGIN, (span))
+#define TRACE_END(span) trace_record(TRACE_KIND_END, (span))
+#else
+#define TRACE_BEGIN(span) do { } while (0)
+#define TRACE_END(span) do { } while (0)
+#endif
+
+/**
+ * @brief receives the dump text, a line or less at a time.
+ */
+typedef void (*trace_write_t)(const char *buf, size_t len, void *arg);
+
+/**
+ * @brief register the tick hooks that sample task switches. spans record without it.
+ */
+esp_err_t trace_start(void);
+
+/**
+ * @brief record one event. safe from tasks and interrupts. use the TRACE_ macros.
+ */
+void trace_record(char kind, uint8_t id);
+
+/**
+ * @brief write the ring as text. recording pauses while it runs.
+ */
+void trace_dump(trace_write_t write, void *arg);
+
+/**
+ * @brief trace_dump to stdout, e.g. to capture over the serial monitor.
+ */
+void trace_dump_serial(void);
+
+/**
+ * @brief ask for a serial dump, e.g. after a slow command. ignored within
+ * TRACE_DUMP_MIN_INTERVAL_US of the last one. safe from any task.
+ */
+void trace_request_dump(void);
+
+/**
+ * @brief true once per trace_request_dump that was accepted.
+ */
+bool trace_take_dump_request(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,19 +16,68 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "uros_task.h"
 #include "app.h"
 #include "http_calls.h"
+#include "http_worker.h"
+#include "http_control.h"
+#include "servo_command.h"
+#include "app_metrics.h"
+#include "app_ram.h"
+#include "boot_profile.h"
+#include "cmd_recorder.h"
+#include "seq_player.h"
+#include "supervisor.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "ros_arena.h"
 #define TAG "UROS"
 
 //	#include "servo_driver.h"
 //	#define SERVO_PIN 18	
 #include "servo_pca9685.h"
 #define I2C_ADDRESS 0x40
+// pwm frequency of the board's PCA9685, SERVO_PWM_DIGITAL_HZ or SERVO_PWM_DIGITAL_FAST_HZ
+// when every servo on it is a digital one rated for it - cuts the wait for the next period.
+#define SERVO_PWM_HZ SERVO_PWM_ANALOG_HZ
+
+// consecutive executor errors before the link is reported down on the display
+#define LINK_DOWN_ERRORS 10
+
+// supervisor stall time for the executor loop, which spins every 100ms
+#define ROS_STALL_MS 5000
+
+// uncomment for the http server for batch servo commands and /metrics, beside the ros
+// subscriptions. it has no authentication and can drive every servo, so only enable it on
+// a trusted network.
+// #define HTTP_CONTROL 1
+
+// uncomment to echo bench tagged servo commands on SERVO_BENCH_ACK_TOPIC once the PCA9685 write
+// completes, for tools/servo_bench.py. needs RMW_UXRCE_MAX_PUBLISHERS=2 (app-colcon.meta).
+// #define SERVO_BENCH 1
+#define SERVO_BENCH_ACK_TOPIC "/servo_ack"
+
+// unit of the Int32 on the servo topics: SERVO_UNIT_DEGREES, SERVO_UNIT_MILLIDEGREES or SERVO_UNIT_US.
+// SERVO_BENCH tags need SERVO_UNIT_DEGREES.
+#define ROS_SERVO_UNIT SERVO_UNIT_DEGREES
+
+// a servo message above this carries a bench tag in the upper bits: data = tag << 8 | angle
+#define SERVO_BENCH_ANGLE_MASK 0xFF
+
+// with TRACE_ENABLED (trace.h), a servo command slower than this dumps the trace over serial
+#define TRACE_STALL_US 50000
+
+// uncomment to sample servo state, latency and health and upload it in batches.
+// #define TELEMETRY 1
+// tools/telemetry_collector.py on the dev machine
+#define TELEMETRY_URL "http://192.168.1.10:8081/telemetry"
 
 // uncomment if we need to do http calls for heartbeats.
 // #define HTTP_HEARTBEAT 1
+// point at tools/http_standin.py on the dev machine to test without internet access
+#define HTTP_HEARTBEAT_URL "http://httpbin.org/get"
 
 #define RCCHECK(fn) { rcl_ret_t temp_rc = fn; if((temp_rc != RCL_RET_OK)){printf("Failed status in %s on line %d: %d. Aborting.\n",__FILE__, __LINE__,(int)temp_rc);vTaskDelete(NULL);}}
 #define RCSOFTCHECK(fn) { rcl_ret_t temp_rc = fn; if((temp_rc != RCL_RET_OK)){printf("Failed status %s on line %d: %d. Continuing.\n",__FILE__, __LINE__,(int)temp_rc);}}
@@ -38,20 +87,24 @@
  *************************/
 rcl_subscription_t subscriber, subscriber0, subscriber1;
 std_msgs__msg__Int32 servo0_msg, servo1_msg;
-QueueHandle_t xDataQueue;
 rcl_node_t node;
 rcl_publisher_t publisher;
+#ifdef SERVO_BENCH
+rcl_publisher_t ack_publisher;
+std_msgs__msg__Int32 ack_msg;
+#endif
 std_msgs__msg__Int32 publish_msg;
 int count_seconds;
 rcl_timer_t timer;
+static rclc_support_t support;
+static rclc_executor_t executor;
 bool do_http_heartbeat = false;
 bool do_report = false;
 
 /*****************************
 Prototypes
 ******************************/
-void send_queue_servo_angle(int servo_num, int32_t data);
-void process_servo_msg(int servo_num, const std_msgs__msg__Int32 *msg);
+void process_servo_msg(int servo_num, const std_msgs__msg__Int32 *msg, int64_t rx_us);
 
 
 
@@ -82,15 +135,14 @@ void timer_callback(rcl_timer_t * timer, int64_t last_call_time)
  */
 void servo_control_initialise() {
 
-	// assuming that the i2c master is set up on the UI task
-	// we need to wait until it's ready.
-	ESP_LOGI(TAG, "waiting for i2c master to be setup by GUI");
-	vTaskDelay(100);
-	ESP_LOGI(TAG, "assume it's done by now.");
+	// the i2c master is set up by the display driver on the GUI task.
+	if (!boot_wait(BOOT_PHASE_I2C_READY, BOOT_I2C_WAIT_MS)) {
+		ESP_LOGW(TAG, "i2c master not set up by GUI after %dms, carrying on", BOOT_I2C_WAIT_MS);
+	}
 
 	// set up servo on pin 18
 	// servo_driver_initialize(SERVO_PIN);
-	servo_pca9685_initialise(I2C_ADDRESS);
+	servo_pca9685_initialise(I2C_ADDRESS, SERVO_PWM_HZ);
 	set_channel_min_max_pulse_us(0, 500, 2500, 180); // Channel 0 - CSPower DS-S006M 500us -> 2500us), 180 degrees
 	set_channel_min_max_pulse_us(1, 1000, 2000, 180); // Channel 1 - Tower Pro SG 90 - 1000us -> 2000 us, 180 degrees
 
@@ -99,83 +151,147 @@ void servo_control_initialise() {
 
 
 /*
- * Send a message to the UI to display the angle requested and the servo requested
+ * process the ros message for the given servo.
+ * rx_us is when the executor handed the message over, for the command latency.
  */
-void send_queue_servo_angle(int servo_num, int32_t data) {
-	BufferDataType txData;
-  BaseType_t queueResult;
-        
-  sprintf(txData.msg,"Servo:%d\n%d",servo_num, data); // TODO: risky copy, as we may overflow allowed msg size. 
-  /* send the message to the gui to display */
-  queueResult = xQueueSend( xDataQueue,
-                            ( void * ) &txData,
-                              xBlockTime );
-
-  if( pdPASS != queueResult)
-  {
-      ESP_LOGI(TAG, "couldn't send data to gui.");
-  }
-}
-
-/*
- * process the ros message for the given servo
- */
-void process_servo_msg(int servo_num, const std_msgs__msg__Int32 *msg) {
-	
-	ESP_LOGI(TAG, "setting servo angle: %d", msg->data);
+void process_servo_msg(int servo_num, const std_msgs__msg__Int32 *msg, int64_t rx_us) {
+	int32_t value = msg->data;
 
-	send_queue_servo_angle(servo_num,msg->data);
+#ifdef SERVO_BENCH
+	if (value > SERVO_BENCH_ANGLE_MASK) {
+		// bench tagged - the tag only identifies the command, the low byte is the angle
+		value &= SERVO_BENCH_ANGLE_MASK;
+	}
+#endif
+	ESP_LOGI(TAG, "setting servo position: %d", value);
 
 	// set_servo_angle(msg->data);
-	set_pca9685_servo_angle (servo_num, msg->data);
+	// same path as the http control endpoint - display, PCA9685 and metrics.
+	TRACE_BEGIN(TRACE_SPAN_SERVO_COMMAND);
+	esp_err_t err = servo_command_set_position(SERVO_SOURCE_ROS, servo_num, ROS_SERVO_UNIT, value);
+	TRACE_END(TRACE_SPAN_SERVO_COMMAND);
+	uint32_t command_us = (uint32_t)(esp_timer_get_time() - rx_us);
+	metrics_record_us(METRIC_HIST_ROS_COMMAND_US, command_us);
+#ifdef TRACE_ENABLED
+	if (command_us > TRACE_STALL_US) {
+		trace_request_dump();
+	}
+#endif
+
+#ifdef SERVO_BENCH
+	if (err == ESP_OK && msg->data > SERVO_BENCH_ANGLE_MASK) {
+		ack_msg.data = msg->data;
+		if (rcl_publish(&ack_publisher, &ack_msg, NULL) == RCL_RET_OK) {
+			metrics_count(METRIC_BENCH_ACKS, 1);
+		} else {
+			metrics_count(METRIC_BENCH_ACK_ERRORS, 1);
+		}
+	}
+#else
+	(void) err;
+#endif
 }
 
 
 void servo0_callback(const void * msgin)
 {
+	int64_t rx_us = esp_timer_get_time();
 	const std_msgs__msg__Int32 * msg = (const std_msgs__msg__Int32 *)msgin;
 	
 	ESP_LOGI(TAG, "servo 0 received msg: %d", msg->data);
 
-	process_servo_msg(0,msg); // in this configuration there is only 1 servo 
+	process_servo_msg(0, msg, rx_us);
 }
 
 void servo1_callback(const void * msgin)
 {
+	int64_t rx_us = esp_timer_get_time();
 	const std_msgs__msg__Int32 * msg = (const std_msgs__msg__Int32 *)msgin;
 	
 	ESP_LOGI(TAG, "servo 1 received msg: %d", msg->data);
 
-	process_servo_msg(1,msg); // in this configuration there is only 1 servo 
+	process_servo_msg(1, msg, rx_us);
 }
 
-void do_http_call()
+/*
+ * heartbeat callbacks - these run on the http worker task, not the executor.
+ */
+static esp_err_t heartbeat_data(const char *data, int len, void *arg)
 {
-	char http_buffer[500] = {0};
-	int http_buf_len = 500;
-	esp_err_t err = http_rest_get("http://httpbin.org/get", (char *)http_buffer, http_buf_len); // simple http method.
-	if (err != ESP_OK) {
-		ESP_LOGE(TAG, "Could not retrieve data %s", esp_err_to_name(err));
+	(void) data;
+	*(int *)arg += len;
+	return ESP_OK;
+}
+
+static void heartbeat_done(const HttpWorkerResult *result, void *arg)
+{
+	int *body_len = (int *)arg;
+
+	if (result->err != ESP_OK) {
+		ESP_LOGE(TAG, "Could not retrieve data %s", esp_err_to_name(result->err));
 	} else {
-		ESP_LOGI(TAG, "retreieved: length: %d, data: %s", strlen((char *)http_buffer), (char *)http_buffer);	
+		ESP_LOGI(TAG, "retrieved: status %d, length: %d, queued %uus, took %uus",
+			result->status, *body_len, result->queue_wait_us, result->run_us);
 	}
+	*body_len = 0;
 }
 
-void uros_start(QueueHandle_t inQueueHandle)
+/*
+ * queue the heartbeat request. never blocks - if the previous heartbeat is still
+ * waiting for the network the worker queue absorbs it, or it is dropped and counted.
+ */
+void do_http_call()
 {
-	xDataQueue = inQueueHandle;
-	rcl_allocator_t allocator = rcl_get_default_allocator();
-	rclc_support_t support;
+	static int heartbeat_len;
 
+	esp_err_t err = http_worker_submit(HTTP_HEARTBEAT_URL, HTTP_METHOD_GET, NULL, 0,
+		heartbeat_data, heartbeat_done, &heartbeat_len);
+	if (err != ESP_OK) {
+		ESP_LOGW(TAG, "heartbeat not queued: %s", esp_err_to_name(err));
+	}
+}
 
+void uros_start(void)
+{
+	// support, node, entities and executor are built in the static arena, not the heap
+	rcl_allocator_t allocator = ros_arena_allocator();
+	RosArenaStats arena;
+
+#ifdef TRACE_ENABLED
+	trace_start();
+#endif
 	servo_control_initialise();
+	servo_command_init();
+	boot_mark(BOOT_PHASE_SERVO_READY);
+#ifdef CMD_RECORDER
+	cmd_recorder_start();
+#endif
 
-	i2c_scan();
+	// nvs and netif come up on the boot_net task (app.c) alongside the servo set up
+	while (!boot_wait(BOOT_PHASE_NETWORK_READY, BOOT_NET_WAIT_MS)) {
+		ESP_LOGW(TAG, "still waiting for nvs and netif");
+	}
+#ifdef HTTP_HEARTBEAT
+	http_worker_start();
+#endif
+#ifdef HTTP_CONTROL
+	http_control_start();
+#endif
+#ifdef SEQ_PLAYER
+	seq_player_start();
+#endif
+#ifdef TELEMETRY
+	telemetry_start(TELEMETRY_URL);
+#endif
+	boot_mark(BOOT_PHASE_SERVERS_READY);
 
-	http_calls_init();
+	// diagnostics only, after everything that can take a servo command is up
+	i2c_scan();
 
 	// create init_options
 	RCCHECK(rclc_support_init(&support, 0, NULL, &allocator));
+	boot_mark(BOOT_PHASE_AGENT_CONNECTED);
+	gui_ipc_post_link_state(true);
 
 	
 	// create node
@@ -213,6 +329,15 @@ void uros_start(QueueHandle_t inQueueHandle)
 		ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, Int32),
 		"freertos_int32_publisher"));
 
+#ifdef SERVO_BENCH
+	RCCHECK(rclc_publisher_init_default(
+		&ack_publisher,
+		&node,
+		ROSIDL_GET_MSG_TYPE_SUPPORT(std_msgs, msg, Int32),
+		SERVO_BENCH_ACK_TOPIC));
+	ESP_LOGI(TAG, "bench acks published on: %s", SERVO_BENCH_ACK_TOPIC);
+#endif
+
 	// create timer for publishing a message. 
 	
 	const unsigned int timer_timeout = 1000; // publish every 1 second. 
@@ -226,7 +351,6 @@ void uros_start(QueueHandle_t inQueueHandle)
 
 
 	// create executor
-	rclc_executor_t executor;
 	int num_handles = 3; // subscription, publisher, timer.
 	RCCHECK(rclc_executor_init(&executor, &support.context, num_handles, &allocator));
 	// RCCHECK(rclc_executor_add_subscription(&executor, &subscriber, &msg, &subscription_callback, ON_NEW_DATA));
@@ -235,38 +359,104 @@ void uros_start(QueueHandle_t inQueueHandle)
 	RCCHECK(rclc_executor_add_subscription(&executor, &subscriber1, &servo1_msg, &servo1_callback, ON_NEW_DATA));
 	RCCHECK(rclc_executor_add_timer(&executor, &timer));
 
+	boot_mark(BOOT_PHASE_ROS_READY);
+	boot_report();
+	app_ram_reserve(APP_RAM_ROS, ROS_ARENA_SIZE + sizeof(support) + sizeof(executor));
+	app_ram_report();
+	ros_arena_get_stats(&arena);
+	ESP_LOGI(TAG, "ros arena: %u of %u bytes used, %u peak, %u heap fallbacks",
+		arena.used, arena.size, arena.peak, arena.heap_fallbacks);
+	bool boot_command_reported = boot_phase_ms(BOOT_PHASE_FIRST_COMMAND) != 0;
+	int supervisor_slot = supervisor_register(ROS_STALL_MS);
+
 	ESP_LOGI(TAG, "executor spinning");
 	
 	int no_data = 0;
 	int error_count = 0;
+	int error_streak = 0; // consecutive spin errors, the link is shown down past LINK_DOWN_ERRORS
 	rcl_ret_t ret;
 
 	while(1){
+			supervisor_feed(supervisor_slot);
+			TRACE_BEGIN(TRACE_SPAN_EXECUTOR_SPIN);
 			ret = rclc_executor_spin_some(&executor, RCL_MS_TO_NS(100));
+			TRACE_END(TRACE_SPAN_EXECUTOR_SPIN);
 			if (ret == RCL_RET_TIMEOUT) {
 				no_data = no_data + 1;
 			}
 			if (ret == RCL_RET_ERROR) {
 				error_count = error_count + 1;
+				error_streak = error_streak + 1;
+				if (error_streak >= LINK_DOWN_ERRORS) {
+					gui_ipc_post_link_state(false);
+				}
+			} else {
+				error_streak = 0;
+				gui_ipc_post_link_state(true);
 			}
 
 			// every 50 seconds summarise rclc returns		
 			if (do_report  == true) {
 				ESP_LOGI(TAG, "%d seconds passed, no data returned %d times, errors %d times.",count_seconds, no_data, error_count);
+				GuiIpcStats ipc_stats;
+				gui_ipc_get_stats(&ipc_stats);
+				ESP_LOGI(TAG, "gui updates: posted %u, coalesced %u, dropped %u",
+					ipc_stats.posted, ipc_stats.coalesced, ipc_stats.dropped);
+#ifdef HTTP_HEARTBEAT
+				HttpPoolStats pool_stats;
+				http_pool_get_stats(&pool_stats);
+				ESP_LOGI(TAG, "http: %u requests, %u reused, %u connects (avg %uus, max %uus), %u reconnects, %u failures",
+					pool_stats.requests, pool_stats.reused, pool_stats.connects,
+					pool_stats.connects ? (uint32_t)(pool_stats.connect_us / pool_stats.connects) : 0,
+					pool_stats.max_connect_us, pool_stats.reconnects, pool_stats.failures);
+				HttpWorkerStats worker_stats;
+				http_worker_get_stats(&worker_stats);
+				ESP_LOGI(TAG, "http worker: %u queued, %u rejected, %u failed, depth %u (max %u), wait avg %uus max %uus, run avg %uus max %uus",
+					worker_stats.submitted, worker_stats.rejected, worker_stats.failed,
+					worker_stats.depth, worker_stats.max_depth,
+					worker_stats.completed ? (uint32_t)(worker_stats.queue_wait_us / worker_stats.completed) : 0,
+					worker_stats.max_queue_wait_us,
+					worker_stats.completed ? (uint32_t)(worker_stats.run_us / worker_stats.completed) : 0,
+					worker_stats.max_run_us);
+#endif
+#ifdef TELEMETRY
+				TelemetryStats tlm_stats;
+				telemetry_get_stats(&tlm_stats);
+				ESP_LOGI(TAG, "telemetry: %u samples, %u uploaded in %u batches (%u bytes), %u failed, %u dropped, interval %ums",
+					tlm_stats.samples, tlm_stats.uploaded, tlm_stats.batches, tlm_stats.bytes,
+					tlm_stats.failures, tlm_stats.dropped, tlm_stats.backoff_ms);
+#endif
+				SupervisorStats sup_stats;
+				supervisor_get_stats(&sup_stats);
+				ESP_LOGI(TAG, "supervisor: %u tasks, %u stalls, %u low stack warnings",
+					sup_stats.task_count, sup_stats.stalls, sup_stats.stack_warnings);
+				if (!boot_command_reported && boot_phase_ms(BOOT_PHASE_FIRST_COMMAND) != 0) {
+					ESP_LOGI(TAG, "first servo command %ums after start up", boot_phase_ms(BOOT_PHASE_FIRST_COMMAND));
+					boot_command_reported = true;
+				}
 				no_data = 0;
 				error_count = 0;
 				do_report = false;
 			}
 
 #ifdef HTTP_HEARTBEAT 
-			// every 10 seconds do an http_call to keep it awake.
+			// every 10 seconds queue an http_call to keep it awake. the worker task performs it.
 			if (do_http_heartbeat == true) {
 					do_http_call();
 					do_http_heartbeat = false;
 			}
 #endif
 
+#ifdef TRACE_ENABLED
+			if (trace_take_dump_request()) {
+				ESP_LOGW(TAG, "slow servo command, dumping trace");
+				trace_dump_serial();
+			}
+#endif
+
+			TRACE_BEGIN(TRACE_SPAN_SPIN_SLEEP);
 			usleep(10000);
+			TRACE_END(TRACE_SPAN_SPIN_SLEEP);
 	}
 
 	ESP_LOGI(TAG, "executor exited? cleaning up and dying (shouldnt happen)");
@@ -1,7 +1,2 @@
-/*********************
- *      DEFINES
- *********************/
-#define LV_TICK_PERIOD_MS 1
-
 void subscription_callback(const void * msgin);
-void uros_start(QueueHandle_t inQueueHandle);
\ No newline at end of file
+void uros_start(void);
\ No newline at end of file